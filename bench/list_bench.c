@@ -0,0 +1,192 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Iteration benchmark of the list, list_head and array
+ *              containers.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "memory.h"
+#include "list.h"
+#include "list_head.h"
+#include "array.h"
+
+#define BENCH_ELEMENTS	10000
+#define BENCH_PASSES	1000
+
+/* Same payload in every container */
+typedef struct _bench_item {
+	int			value;
+	list_head_t		e_list;
+} bench_item_t;
+
+/* Keeps the compiler from dropping the walks */
+static volatile long bench_sink;
+
+/* Containers under test. All of them are filled before any walk is
+ * timed, so that none runs on memory recycled from another one.
+ */
+static list bench_l;
+static list_head_t bench_head = LIST_HEAD_INITIALIZER(bench_head);
+static array_t *bench_a;
+
+static double
+bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_report(const char *name, double elapsed, int elements, int passes)
+{
+	printf("%-10s %8.2f ns/element  (%d elements, %d passes)\n"
+	       , name, elapsed * 1e9 / ((double) elements * passes)
+	       , elements, passes);
+}
+
+static void
+bench_fill(int elements)
+{
+	bench_item_t *item;
+	int i;
+
+	/* Generic list, one element allocated per item */
+	bench_l = alloc_list(NULL, NULL);
+	for (i = 0; i < elements; i++) {
+		item = (bench_item_t *) MALLOC(sizeof(bench_item_t));
+		item->value = i;
+		list_add(bench_l, item);
+	}
+
+	/* Intrusive list, link embedded in each item */
+	for (i = 0; i < elements; i++) {
+		item = (bench_item_t *) MALLOC(sizeof(bench_item_t));
+		item->value = i;
+		list_head_add_tail(&item->e_list, &bench_head);
+	}
+
+	/* Contiguous array, items stored by value */
+	bench_a = alloc_array(sizeof(bench_item_t), NULL, NULL);
+	for (i = 0; i < elements; i++) {
+		item = array_add(bench_a);
+		item->value = i;
+	}
+}
+
+static void
+bench_release(void)
+{
+	bench_item_t *item, *n;
+	element e;
+
+	/* No free handler, release the items ourselves */
+	for (e = LIST_HEAD(bench_l); e; ELEMENT_NEXT(e))
+		FREE(ELEMENT_DATA(e));
+	free_list(bench_l);
+
+	list_head_for_each_entry_safe(item, n, &bench_head, e_list) {
+		list_head_del(&item->e_list);
+		FREE(item);
+	}
+
+	free_array(bench_a);
+}
+
+static void
+bench_list(int elements, int passes)
+{
+	bench_item_t *item;
+	element e;
+	double start;
+	long sum = 0;
+	int i;
+
+	start = bench_now();
+	for (i = 0; i < passes; i++)
+		for (e = LIST_HEAD(bench_l); e; ELEMENT_NEXT(e)) {
+			item = ELEMENT_DATA(e);
+			sum += item->value;
+		}
+	bench_report("list", bench_now() - start, elements, passes);
+	bench_sink = sum;
+}
+
+static void
+bench_list_head(int elements, int passes)
+{
+	bench_item_t *item;
+	double start;
+	long sum = 0;
+	int i;
+
+	start = bench_now();
+	for (i = 0; i < passes; i++)
+		list_head_for_each_entry(item, &bench_head, e_list)
+			sum += item->value;
+	bench_report("list_head", bench_now() - start, elements, passes);
+	bench_sink = sum;
+}
+
+static void
+bench_array(int elements, int passes)
+{
+	bench_item_t *item;
+	double start;
+	long sum = 0;
+	unsigned int j;
+	int i;
+
+	start = bench_now();
+	for (i = 0; i < passes; i++)
+		for (j = 0; j < bench_a->count; j++) {
+			item = ARRAY_ITEM(bench_a, j);
+			sum += item->value;
+		}
+	bench_report("array", bench_now() - start, elements, passes);
+	bench_sink = sum;
+}
+
+int
+main(int argc, char **argv)
+{
+	int elements = BENCH_ELEMENTS;
+	int passes = BENCH_PASSES;
+
+	if (argc > 1)
+		elements = atoi(argv[1]);
+	if (argc > 2)
+		passes = atoi(argv[2]);
+	if (elements <= 0 || passes <= 0) {
+		fprintf(stderr, "Usage: %s [elements [passes]]\n", argv[0]);
+		exit(1);
+	}
+
+	bench_fill(elements);
+	bench_list(elements, passes);
+	bench_list_head(elements, passes);
+	bench_array(elements, passes);
+	bench_release();
+
+	exit(0);
+}
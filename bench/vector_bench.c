@@ -0,0 +1,91 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Append benchmark of the vector container.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "memory.h"
+#include "vector.h"
+
+/* Appends per size, about constant total work per size */
+#define BENCH_APPENDS	10000000
+#define BENCH_MIN_SIZE	100
+#define BENCH_MAX_SIZE	1000000
+
+static double
+bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Build vectors of size slots, the way the parser does, until
+ * total slots are appended. With geometric growth the cost per
+ * append stays flat whatever the vector size, so the cost of
+ * building one vector is linear in its size.
+ */
+static double
+bench_append(unsigned int size, unsigned int total, int reserve)
+{
+	vector_t *v;
+	double start;
+	unsigned int i, n;
+
+	start = bench_now();
+	for (n = 0; n < total; n += size) {
+		v = vector_alloc();
+		if (reserve)
+			vector_reserve(v, size);
+		for (i = 0; i < size; i++) {
+			vector_alloc_slot(v);
+			vector_set_slot(v, v);
+		}
+		vector_free(v);
+	}
+
+	return (bench_now() - start) * 1e9 / n;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int total = BENCH_APPENDS;
+	unsigned int size;
+
+	if (argc > 1)
+		total = atoi(argv[1]);
+	if (total < BENCH_MAX_SIZE) {
+		fprintf(stderr, "Usage: %s [appends, at least %d]\n"
+			      , argv[0], BENCH_MAX_SIZE);
+		exit(1);
+	}
+
+	printf("%10s %16s %16s\n", "size", "append ns/slot", "reserved ns/slot");
+	for (size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size *= 10)
+		printf("%10u %16.2f %16.2f\n", size
+		       , bench_append(size, total, 0)
+		       , bench_append(size, total, 1));
+
+	exit(0);
+}
@@ -207,7 +207,7 @@ int
 main(int argc, char **argv)
 {
 	thread_t thread;
-	char *url_default = malloc(2);
+	char *url_default = MALLOC(2);
 	url_default[0] = '/';
 	url_default[1] = '\0';
 
@@ -248,6 +248,7 @@ main(int argc, char **argv)
 
 	/* Create the master thread */
 	master = thread_make_master();
+	signal_thread_add(master);
 
 	/* Register the GET request */
 	init_sock();
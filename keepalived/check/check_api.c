@@ -35,10 +35,12 @@
 #include "check_tcp.h"
 #include "check_http.h"
 #include "check_ssl.h"
+#include "ipwrapper.h"
 
 /* Global vars */
 static checker_id_t ncheckers = 0;
 list checkers_queue;
+list old_checkers_queue;
 
 /* free checker data */
 static void
@@ -70,9 +72,25 @@ dump_conn_opts (conn_opts_t *conn)
 	log_message(LOG_INFO, "   Connection timeout = %f", ((double) conn->connection_to)/TIMER_HZ);
 }
 
+/* Compare connection options */
+int
+conn_opts_equal(conn_opts_t *co1, conn_opts_t *co2)
+{
+	if (!co1 || !co2)
+		return co1 == co2;
+
+	return sockstorage_equal(&co1->dst, &co2->dst) &&
+	       sockstorage_equal(&co1->bindto, &co2->bindto) &&
+#ifdef _WITH_SO_MARK_
+	       co1->fwmark == co2->fwmark &&
+#endif
+	       co1->connection_to == co2->connection_to;
+}
+
 /* Queue a checker into the checkers_queue */
 void
 queue_checker(void (*free_func) (void *), void (*dump_func) (void *)
+	      , int (*compare_func) (void *, void *)
 	      , int (*launch) (thread_t *)
 	      , void *data
 	      , conn_opts_t *co)
@@ -89,6 +107,7 @@ queue_checker(void (*free_func) (void *), void (*dump_func) (void *)
 
 	checker->free_func = free_func;
 	checker->dump_func = dump_func;
+	checker->compare_func = compare_func;
 	checker->launch = launch;
 	checker->vs = vs;
 	checker->rs = rs;
@@ -224,6 +243,7 @@ void
 init_checkers_queue(void)
 {
 	checkers_queue = alloc_list(free_checker, dump_checker);
+	ncheckers = 0;
 }
 
 /* release the checkers_queue */
@@ -235,16 +255,137 @@ free_checkers_queue(void)
 	ncheckers = 0;
 }
 
+/* release checkers left over from previous configuration. Unchanged
+ * checkers have been swapped with their unused parsed copy, remaining
+ * ones were removed or modified and their pending threads are stopped.
+ */
+void
+free_old_checkers_queue(void)
+{
+	element e;
+
+	for (e = LIST_HEAD(old_checkers_queue); e; ELEMENT_NEXT(e))
+		thread_destroy_arg(master, ELEMENT_DATA(e));
+	free_list(old_checkers_queue);
+	old_checkers_queue = NULL;
+}
+
+/* Test if a checker is unchanged by reload : same service, same
+ * real server, same check type and same parameters.
+ */
+static int
+checker_equal(checker_t *old, checker_t *new)
+{
+	if (old->launch != new->launch ||
+	    old->compare_func != new->compare_func ||
+	    old->warmup != new->warmup)
+		return 0;
+	if (!VS_ISEQ(old->vs, new->vs) || !RS_ISEQ(old->rs, new->rs))
+		return 0;
+	if (!conn_opts_equal(old->co, new->co))
+		return 0;
+
+	return !new->compare_func || (*new->compare_func) (old, new);
+}
+
+/* Old checkers are indexed on their vs and rs addresses */
+static list
+checker_hashbucket(list index, unsigned int size, checker_t *checker)
+{
+	uint32_t hash = sockstorage_hash(&checker->vs->addr, HASH_FNV1A_INIT);
+
+	hash = hash_fnv1a(&checker->vs->vfwmark, sizeof(checker->vs->vfwmark), hash);
+	hash = sockstorage_hash(&checker->rs->addr, hash);
+	return &index[hash & (size - 1)];
+}
+
+/* Check if a checker exist in previous conf data. Bucket elements
+ * hold the old checkers_queue element of each checker.
+ */
+static element
+checker_exist(checker_t *new, list bucket)
+{
+	element e;
+	element old;
+
+	for (e = LIST_HEAD(bucket); e; ELEMENT_NEXT(e)) {
+		old = ELEMENT_DATA(e);
+		if (checker_equal(ELEMENT_DATA(old), new))
+			return e;
+	}
+
+	return NULL;
+}
+
+/* Substitute the running old checker for the newly parsed one, keeping
+ * its state and pending threads. The failed state is carried over to
+ * the new realserver. The parsed one takes the old one's place in the
+ * old queue and is released along with it.
+ */
+static void
+migrate_checker(element e, element old_e)
+{
+	checker_t *new = ELEMENT_DATA(e);
+	checker_t *old = ELEMENT_DATA(old_e);
+	list l = new->rs->failed_checkers;
+	checker_id_t *id;
+	element f;
+	int up = svr_checker_up(old->id, old->rs);
+
+	for (f = LIST_HEAD(l); f; ELEMENT_NEXT(f)) {
+		id = ELEMENT_DATA(f);
+		if (*id == new->id)
+			break;
+	}
+
+	if (up && f)
+		free_list_element(l, f);
+	else if (!up && !f) {
+		id = (checker_id_t *) MALLOC(sizeof(checker_id_t));
+		*id = new->id;
+		list_add(l, id);
+	}
+
+	old->vs = new->vs;
+	old->rs = new->rs;
+	old->id = new->id;
+	ELEMENT_DATA(e) = old;
+	ELEMENT_DATA(old_e) = new;
+}
+
 /* register checkers to the global I/O scheduler */
 void
 register_checkers_thread(void)
 {
 	checker_t *checker;
-	element e;
+	element e, f;
 	long warmup;
+	list index = NULL, bucket;
+	unsigned int size = 0;
+	int kept = 0;
+
+	/* Index previous checkers */
+	if (reload && !LIST_ISEMPTY(old_checkers_queue)) {
+		size = hash_index_size(LIST_SIZE(old_checkers_queue));
+		index = alloc_mlist(NULL, NULL, size);
+		for (e = LIST_HEAD(old_checkers_queue); e; ELEMENT_NEXT(e))
+			list_add(checker_hashbucket(index, size, ELEMENT_DATA(e)), e);
+	}
 
 	for (e = LIST_HEAD(checkers_queue); e; ELEMENT_NEXT(e)) {
 		checker = ELEMENT_DATA(e);
+
+		/* Unchanged checkers keep running on their own schedule */
+		if (index) {
+			bucket = checker_hashbucket(index, size, checker);
+			if ((f = checker_exist(checker, bucket))) {
+				migrate_checker(e, ELEMENT_DATA(f));
+				free_list_element(bucket, f);
+				kept++;
+				continue;
+			}
+		}
+
 		log_message(LOG_INFO, "Activating healthchecker for service %s"
 				    , FMT_CHK(checker));
 		CHECKER_ENABLE(checker);
@@ -261,6 +402,11 @@ register_checkers_thread(void)
 					 BOOTSTRAP_DELAY + warmup);
 		}
 	}
+
+	if (reload) {
+		free_mlist(index, size);
+		log_message(LOG_INFO, "Kept %d unchanged healthcheckers running", kept);
+	}
 }
 
 /* Sync checkers activity with netlink kernel reflection */
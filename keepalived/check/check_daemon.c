@@ -28,11 +28,13 @@
 #include "check_ssl.h"
 #include "check_api.h"
 #include "global_data.h"
+#include "journal.h"
 #include "ipwrapper.h"
 #include "ipvswrapper.h"
 #include "pidfile.h"
 #include "daemon.h"
 #include "signals.h"
+#include "notify.h"
 #include "logger.h"
 #include "list.h"
 #include "main.h"
@@ -59,6 +61,8 @@ stop_check(void)
 	if (!__test_bit(DONT_RELEASE_IPVS_BIT, &debug))
 		clear_services();
 	ipvs_stop();
+	journal_close();
+	script_helper_close();
 #ifdef _WITH_SNMP_
 	if (snmp)
 		check_snmp_agent_close();
@@ -82,6 +86,7 @@ stop_check(void)
 	 * Reached when terminate signal catched.
 	 * finally return to parent process.
 	 */
+	log_helper_close();
 	closelog();
 	exit(0);
 }
@@ -90,6 +95,12 @@ stop_check(void)
 static void
 start_check(void)
 {
+	unsigned long mem_base = mem_in_use();
+
+	/* Spawn scripts from a small helper rather than forking ourself */
+	if (!reload)
+		script_helper_init(master);
+
 	/* Initialize sub-system */
 	if (ipvs_start() != IPVS_SUCCESS) {
 		stop_check();
@@ -97,8 +108,10 @@ start_check(void)
 	}
 	init_checkers_queue();
 #ifdef _WITH_VRRP_
-	init_interface_queue();
-	kernel_netlink_init();
+	if (!reload) {
+		init_interface_queue();
+		kernel_netlink_init();
+	}
 #endif
 #ifdef _WITH_SNMP_
 	if (!reload && snmp)
@@ -114,9 +127,14 @@ start_check(void)
 		return;
 	}
 	init_global_data(global_data);
+	log_rate_set(global_data->log_rate_burst, global_data->log_rate_interval);
+
+	/* Binary event journal, if configured */
+	journal_open(global_data->event_journal, global_data->event_journal_size);
 
 	/* Post initializations */
-	log_message(LOG_INFO, "Configuration is using : %lu Bytes", mem_allocated);
+	log_message(LOG_INFO, "Configuration is using : %lu Bytes"
+			    , (mem_in_use() > mem_base) ? mem_in_use() - mem_base : 0);
 
 	/* SSL load static data & initialize common ctx context */
 	if (!init_ssl_ctx()) {
@@ -163,6 +181,23 @@ sighup_check(void *v, int sig)
 	thread_add_event(master, reload_check_thread, NULL, 0);
 }
 
+/* Memory accounting dump handler */
+static int
+print_check_stats(thread_t * thread)
+{
+	dump_mem_stats();
+	dump_log_stats();
+	return 0;
+}
+
+void
+sigusr2_check(void *v, int sig)
+{
+	log_message(LOG_INFO, "Printing checker stats for process(%d) on signal",
+		    getpid());
+	thread_add_event(master, print_check_stats, NULL, 0);
+}
+
 /* Terminate handler */
 void
 sigend_check(void *v, int sig)
@@ -179,6 +214,7 @@ check_signal_init(void)
 	signal_set(SIGHUP, sighup_check, NULL);
 	signal_set(SIGINT, sigend_check, NULL);
 	signal_set(SIGTERM, sigend_check, NULL);
+	signal_set(SIGUSR2, sigusr2_check, NULL);
 	signal_ignore(SIGPIPE);
 }
 
@@ -186,40 +222,37 @@ check_signal_init(void)
 int
 reload_check_thread(thread_t * thread)
 {
+	unsigned long mem;
+
 	/* set the reloading flag */
 	SET_RELOAD;
 
 	log_message(LOG_INFO, "Got SIGHUP, reloading checker configuration");
 
-	/* Signals handling */
-	signal_handler_reset();
-
-	/* Destroy master thread */
-#ifdef _WITH_VRRP_
-	kernel_netlink_close();
-#endif
-	thread_destroy_master(master);
-	master = thread_make_master();
+	/* The scheduler, netlink channels and interface queue are kept
+	 * running. Unchanged checkers are taken over by the new
+	 * configuration with their pending threads.
+	 */
 	free_global_data(global_data);
-	free_checkers_queue();
-#ifdef _WITH_VRRP_
-	free_interface_queue();
-#endif
 	free_ssl();
 	ipvs_stop();
 
 	/* Save previous conf data */
 	old_check_data = check_data;
 	check_data = NULL;
+	old_checkers_queue = checkers_queue;
+	checkers_queue = NULL;
 
 	/* Reload the conf */
-	mem_allocated = 0;
-	check_signal_init();
-	signal_set(SIGCHLD, thread_child_handler, master);
 	start_check();
 
 	/* free backup data */
+	mem = mem_in_use();
+	free_old_checkers_queue();
 	free_check_data(old_check_data);
+	log_message(LOG_INFO, "Previous configuration released : %lu Bytes"
+			    , (mem > mem_in_use()) ? mem - mem_in_use() : 0);
+	mem_release();
 	UNSET_RELOAD;
 
 	return 0;
@@ -258,6 +291,7 @@ start_check_child(void)
 {
 #ifndef _DEBUG_
 	pid_t pid;
+	int facility;
 	int ret;
 
 	/* Initialize child process */
@@ -279,8 +313,10 @@ start_check_child(void)
 	}
 
 	/* Opening local CHECK syslog channel */
+	facility = (log_facility==LOG_DAEMON) ? LOG_LOCAL2 : log_facility;
 	openlog(PROG_CHECK, LOG_PID | ((__test_bit(LOG_CONSOLE_BIT, &debug)) ? LOG_CONS : 0)
-			  , (log_facility==LOG_DAEMON) ? LOG_LOCAL2 : log_facility);
+			  , facility);
+	log_helper_init(PROG_CHECK, facility);
 
 	/* Child process part, write pidfile */
 	if (!pidfile_write(checkers_pidfile, getpid())) {
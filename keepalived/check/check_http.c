@@ -40,7 +40,6 @@ free_url(void *data)
 	url_t *url = data;
 	FREE(url->path);
 	FREE(url->digest);
-	FREE(url);
 }
 
 void
@@ -60,8 +59,19 @@ void
 free_http_get_check(void *data)
 {
 	http_checker_t *http_get_chk = CHECKER_DATA(data);
+	request_t *req = HTTP_REQ(HTTP_ARG(http_get_chk));
 
-	free_list(http_get_chk->url);
+	/* A checker removed by reload may have a request in flight,
+	 * its socket is closed by thread_destroy_arg() */
+	if (req) {
+		if (req->ssl)
+			SSL_free(req->ssl);
+		if (req->buffer)
+			FREE(req->buffer);
+		FREE(req);
+	}
+
+	free_array(http_get_chk->url);
 	FREE(http_get_chk->arg);
 	FREE(http_get_chk);
 	FREE(CHECKER_CO(data));
@@ -81,8 +91,34 @@ dump_http_get_check(void *data)
 	log_message(LOG_INFO, "   Nb get retry = %d", http_get_chk->nb_get_retry);
 	log_message(LOG_INFO, "   Delay before retry = %lu",
 	       http_get_chk->delay_before_retry/TIMER_HZ);
-	dump_list(http_get_chk->url);
+	dump_array(http_get_chk->url);
+}
+int
+compare_http_get_check(void *a, void *b)
+{
+	http_checker_t *old = CHECKER_DATA(a);
+	http_checker_t *new = CHECKER_DATA(b);
+	url_t *u1, *u2;
+	unsigned int i;
+
+	if (old->proto != new->proto ||
+	    old->nb_get_retry != new->nb_get_retry ||
+	    old->delay_before_retry != new->delay_before_retry ||
+	    ARRAY_COUNT(old->url) != ARRAY_COUNT(new->url))
+		return 0;
+
+	for (i = 0; i < ARRAY_COUNT(old->url); i++) {
+		u1 = ARRAY_ITEM(old->url, i);
+		u2 = ARRAY_ITEM(new->url, i);
+		if (!string_equal(u1->path, u2->path) ||
+		    !string_equal(u1->digest, u2->digest) ||
+		    u1->status_code != u2->status_code)
+			return 0;
+	}
+
+	return 1;
 }
+
 static http_checker_t *
 alloc_http_get(char *proto)
 {
@@ -92,7 +128,7 @@ alloc_http_get(char *proto)
 	http_get_chk->arg = (http_t *) MALLOC(sizeof (http_t));
 	http_get_chk->proto =
 	    (!strcmp(proto, "HTTP_GET")) ? PROTO_HTTP : PROTO_SSL;
-	http_get_chk->url = alloc_list(free_url, dump_url);
+	http_get_chk->url = alloc_array(sizeof (url_t), free_url, dump_url);
 	http_get_chk->nb_get_retry = 1;
 	http_get_chk->delay_before_retry = 3 * TIMER_HZ;
 
@@ -108,7 +144,7 @@ http_get_handler(vector_t *strvec)
 	/* queue new checker */
 	http_get_chk = alloc_http_get(str);
 	queue_checker(free_http_get_check, dump_http_get_check,
-		      http_connect_thread, http_get_chk, CHECKER_NEW_CO());
+		      compare_http_get_check, http_connect_thread, http_get_chk, CHECKER_NEW_CO());
 }
 
 void
@@ -129,19 +165,16 @@ void
 url_handler(vector_t *strvec)
 {
 	http_checker_t *http_get_chk = CHECKER_GET();
-	url_t *new;
 
 	/* allocate the new URL */
-	new = (url_t *) MALLOC(sizeof (url_t));
-
-	list_add(http_get_chk->url, new);
+	array_add(http_get_chk->url);
 }
 
 void
 path_handler(vector_t *strvec)
 {
 	http_checker_t *http_get_chk = CHECKER_GET();
-	url_t *url = LIST_TAIL_DATA(http_get_chk->url);
+	url_t *url = ARRAY_TAIL(http_get_chk->url);
 
 	url->path = CHECKER_VALUE_STRING(strvec);
 }
@@ -150,7 +183,7 @@ void
 digest_handler(vector_t *strvec)
 {
 	http_checker_t *http_get_chk = CHECKER_GET();
-	url_t *url = LIST_TAIL_DATA(http_get_chk->url);
+	url_t *url = ARRAY_TAIL(http_get_chk->url);
 
 	url->digest = CHECKER_VALUE_STRING(strvec);
 }
@@ -159,7 +192,7 @@ void
 status_code_handler(vector_t *strvec)
 {
 	http_checker_t *http_get_chk = CHECKER_GET();
-	url_t *url = LIST_TAIL_DATA(http_get_chk->url);
+	url_t *url = ARRAY_TAIL(http_get_chk->url);
 
 	url->status_code = CHECKER_VALUE_INT(strvec);
 }
@@ -249,7 +282,7 @@ epilog(thread_t * thread, int method, int t, int c)
 		http->retry_it += c ? c : -http->retry_it;
 	}
 
-	if (method == 1 && http->url_it >= LIST_SIZE(http_get_check->url)) {
+	if (method == 1 && http->url_it >= ARRAY_COUNT(http_get_check->url)) {
 		/* All the url have been successfully checked.
 		 * Check completed.
 		 * check if server is currently alive.
@@ -347,7 +380,7 @@ fetch_next_url(http_checker_t * http_get_check)
 {
 	http_t *http = HTTP_ARG(http_get_check);
 
-	return list_element(http_get_check->url, http->url_it);
+	return array_item(http_get_check->url, http->url_it);
 }
 
 /* Handle response */
@@ -452,7 +485,7 @@ http_read_thread(thread_t * thread)
 	http_checker_t *http_get_check = CHECKER_ARG(checker);
 	http_t *http = HTTP_ARG(http_get_check);
 	request_t *req = HTTP_REQ(http);
-	url_t *url = list_element(http_get_check->url, http->url_it);
+	url_t *url = array_item(http_get_check->url, http->url_it);
 	unsigned timeout = checker->co->connection_to;
 	unsigned char digest[16];
 	int r = 0;
@@ -524,7 +557,7 @@ http_response_thread(thread_t * thread)
 	http_checker_t *http_get_check = CHECKER_ARG(checker);
 	http_t *http = HTTP_ARG(http_get_check);
 	request_t *req = HTTP_REQ(http);
-	url_t *url = list_element(http_get_check->url, http->url_it);
+	url_t *url = array_item(http_get_check->url, http->url_it);
 	unsigned timeout = checker->co->connection_to;
 
 	/* Handle read timeout */
@@ -60,14 +60,25 @@ dump_misc_check(void *data)
 	log_message(LOG_INFO, "   dynamic = %s", misck_checker->dynamic ? "YES" : "NO");
 }
 
+int
+compare_misc_check(void *a, void *b)
+{
+	misc_checker_t *old = CHECKER_DATA(a);
+	misc_checker_t *new = CHECKER_DATA(b);
+
+	return string_equal(old->path, new->path) &&
+	       old->timeout == new->timeout &&
+	       old->dynamic == new->dynamic;
+}
+
 void
 misc_check_handler(vector_t *strvec)
 {
 	misc_checker_t *misck_checker = (misc_checker_t *) MALLOC(sizeof (misc_checker_t));
 
 	/* queue new checker */
-	queue_checker(free_misc_check, dump_misc_check, misc_check_thread,
-		      misck_checker, NULL);
+	queue_checker(free_misc_check, dump_misc_check, compare_misc_check,
+		      misc_check_thread, misck_checker, NULL);
 }
 
 void
@@ -161,7 +172,7 @@ misc_check_child_thread(thread_t * thread)
 						     , checker->rs);
 		}
 
-		kill(pid, SIGTERM);
+		script_kill(thread->master, pid, SIGTERM);
 		thread_add_child(thread->master, misc_check_child_timeout_thread,
 				 checker, pid, 2);
 		return 0;
@@ -216,21 +227,11 @@ misc_check_child_thread(thread_t * thread)
 int
 misc_check_child_timeout_thread(thread_t * thread)
 {
-	pid_t pid;
-
 	if (thread->type != THREAD_CHILD_TIMEOUT)
 		return 0;
 
 	/* OK, it still hasn't exited. Now really kill it off. */
-	pid = THREAD_CHILD_PID(thread);
-	if (kill(pid, SIGKILL) < 0) {
-		/* Its possible it finished while we're handing this */
-		if (errno != ESRCH)
-			DBG("kill error: %s", strerror(errno));
-		return 0;
-	}
-
-	log_message(LOG_WARNING, "Process [%d] didn't respond to SIGTERM", pid);
+	script_kill(thread->master, THREAD_CHILD_PID(thread), SIGKILL);
 
 	return 0;
 }
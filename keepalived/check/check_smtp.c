@@ -86,6 +86,31 @@ dump_smtp_check(void *data)
 	dump_list(smtp_checker->host);
 }
 
+/*
+ * Used as a callback from the checker api on reload, to tell
+ * whether a checker entry is unchanged.
+ */
+int
+compare_smtp_check(void *a, void *b)
+{
+	smtp_checker_t *old = CHECKER_DATA(a);
+	smtp_checker_t *new = CHECKER_DATA(b);
+	element e1, e2;
+
+	if (!string_equal(old->helo_name, new->helo_name) ||
+	    old->retry != new->retry ||
+	    old->db_retry != new->db_retry ||
+	    LIST_SIZE(old->host) != LIST_SIZE(new->host))
+		return 0;
+
+	for (e1 = LIST_HEAD(old->host), e2 = LIST_HEAD(new->host);
+	     e1 && e2; ELEMENT_NEXT(e1), ELEMENT_NEXT(e2))
+		if (!conn_opts_equal(ELEMENT_DATA(e1), ELEMENT_DATA(e2)))
+			return 0;
+
+	return 1;
+}
+
 /* Allocates a default host structure */
 smtp_host_t *
 smtp_alloc_host(void)
@@ -136,11 +161,12 @@ smtp_check_handler(vector_t *strvec)
 	 * list.
 	 *
 	 * queue_checker(void (*free) (void *), void (*dump) (void *),
+	 *               int (*compare) (void *, void *),
 	 *               int (*launch) (thread_t *),
 	 *               void *data, conn_opts_t *)
 	 */
-	queue_checker(free_smtp_check, dump_smtp_check, smtp_connect_thread,
-		      smtp_checker, smtp_checker->default_co);
+	queue_checker(free_smtp_check, dump_smtp_check, compare_smtp_check,
+		      smtp_connect_thread, smtp_checker, smtp_checker->default_co);
 
 	/*
 	 * Last, allocate the list that will hold all the per host
@@ -857,6 +857,11 @@ static struct variable8 check_vars[] = {
 	{CHECK_SNMP_RSRATEOUTBPS, ASN_GAUGE, RONLY,
 	 check_snmp_realserver, 3, {4, 1, 26}},
 #endif
+	/* checkMemoryTable */
+	{SNMP_MEMORY_CATEGORY, ASN_OCTET_STR, RONLY, snmp_memory, 3, {6, 1, 2}},
+	{SNMP_MEMORY_BYTES, ASN_GAUGE, RONLY, snmp_memory, 3, {6, 1, 3}},
+	{SNMP_MEMORY_BLOCKS, ASN_GAUGE, RONLY, snmp_memory, 3, {6, 1, 4}},
+	{SNMP_MEMORY_ALLOCS, ASN_COUNTER, RONLY, snmp_memory, 3, {6, 1, 5}},
 };
 
 void
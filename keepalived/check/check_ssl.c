@@ -24,6 +24,7 @@
  */
 
 #include <openssl/err.h>
+#include <openssl/crypto.h>
 #include "check_ssl.h"
 #include "check_api.h"
 #include "logger.h"
@@ -33,6 +34,9 @@
 #include "utils.h"
 #include "html.h"
 
+#undef MEM_CATEGORY
+#define MEM_CATEGORY MEM_CAT_SSL
+
 /* SSL primitives */
 /* Free an SSL context */
 void
@@ -57,6 +61,44 @@ password_cb(char *buf, int num, int rwflag, void *userdata)
 	return (plen);
 }
 
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+/* OpenSSL allocation hooks */
+static void *
+ssl_malloc(size_t size, const char *file, int line)
+{
+	return mem_malloc(size, MEM_CAT_SSL);
+}
+
+static void *
+ssl_realloc(void *ptr, size_t size, const char *file, int line)
+{
+	return mem_realloc(ptr, size, MEM_CAT_SSL);
+}
+
+static void
+ssl_free(void *ptr, const char *file, int line)
+{
+	mem_free(ptr);
+}
+#endif
+
+/* Charge the library own allocations to the SSL accounting category.
+ * OpenSSL only accepts this before its first allocation, so it is done
+ * once per process ahead of the library initialization. */
+static void
+ssl_mem_init(void)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	static int done = 0;
+
+	if (done)
+		return;
+	done = 1;
+	if (!CRYPTO_set_mem_functions(ssl_malloc, ssl_realloc, ssl_free))
+		log_message(LOG_INFO, "SSL memory is not accounted, library already in use");
+#endif
+}
+
 /* Inititalize global SSL context */
 static BIO *bio_err = 0;
 static int
@@ -65,6 +107,7 @@ build_ssl_ctx(void)
 	ssl_data_t *ssl;
 
 	/* Library initialization */
+	ssl_mem_init();
 	SSL_library_init();
 
 	SSL_load_error_strings();
@@ -247,7 +290,7 @@ ssl_read_thread(thread_t * thread)
 	http_checker_t *http_get_check = CHECKER_ARG(checker);
 	http_t *http = HTTP_ARG(http_get_check);
 	request_t *req = HTTP_REQ(http);
-	url_t *url = list_element(http_get_check->url, http->url_it);
+	url_t *url = array_item(http_get_check->url, http->url_it);
 	unsigned timeout = checker->co->connection_to;
 	unsigned char digest[16];
 	int r = 0;
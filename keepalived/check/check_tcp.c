@@ -56,6 +56,16 @@ dump_tcp_check(void *data)
 	}
 }
 
+int
+compare_tcp_check(void *a, void *b)
+{
+	tcp_check_t *old = CHECKER_DATA(a);
+	tcp_check_t *new = CHECKER_DATA(b);
+
+	return old->n_retry == new->n_retry &&
+	       old->delay_before_retry == new->delay_before_retry;
+}
+
 void
 tcp_check_handler(vector_t *strvec)
 {
@@ -66,8 +76,8 @@ tcp_check_handler(vector_t *strvec)
 	tcp_check->delay_before_retry = 1 * TIMER_HZ;
 
 	/* queue new checker */
-	queue_checker(free_tcp_check, dump_tcp_check, tcp_connect_thread
-		      ,tcp_check, CHECKER_NEW_CO());
+	queue_checker(free_tcp_check, dump_tcp_check, compare_tcp_check
+		      ,tcp_connect_thread, tcp_check, CHECKER_NEW_CO());
 }
 
 void
@@ -27,6 +27,7 @@
 #include "utils.h"
 #include "memory.h"
 #include "logger.h"
+#include "signals.h"
 
 /* local helpers functions */
 static int parse_timeout(char *, unsigned *);
@@ -963,7 +964,7 @@ ipvs_update_stats(virtual_server_t *vs)
 		/* Get real servers */
 		dests = ipvs_get_dests(serv);
 		if (!dests) {
-			FREE(serv);
+			free(serv);
 			return;
 		}
 		for (i = 0; i < dests->num_dests; i++) {
@@ -1008,8 +1009,8 @@ ipvs_update_stats(virtual_server_t *vs)
 				ADD_TO_RSSTATS(stats.outbps);
 			}
 		}
-		FREE(dests);
-		FREE(serv);
+		free(dests);
+		free(serv);
 	}
 }
 #endif /* _WITH_SNMP_ */
@@ -1083,6 +1084,7 @@ modprobe_ipvs(void)
 	int rc;
 
 	if (!(child = fork())) {
+		signal_handler_script();
 		execv(argv[0], argv);
 		exit(1);
 	}
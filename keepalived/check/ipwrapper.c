@@ -22,6 +22,7 @@
 
 #include "ipwrapper.h"
 #include "ipvswrapper.h"
+#include "journal.h"
 #include "logger.h"
 #include "memory.h"
 #include "utils.h"
@@ -294,7 +295,7 @@ update_quorum_state(virtual_server_t * vs)
 	if (vs->quorum_state == DOWN &&
 	    weight_sum >= up_threshold) {
 		vs->quorum_state = UP;
-		log_message(LOG_INFO, "Gained quorum %lu+%lu=%li <= %li for VS %s"
+		log_message_nolimit(LOG_INFO, "Gained quorum %lu+%lu=%li <= %li for VS %s"
 				    , vs->quorum
 				    , vs->hysteresis
 				    , up_threshold
@@ -331,7 +332,7 @@ update_quorum_state(virtual_server_t * vs)
 	    (!weight_sum || weight_sum < down_threshold)
 	) {
 		vs->quorum_state = DOWN;
-		log_message(LOG_INFO, "Lost quorum %lu-%lu=%li > %li for VS %s"
+		log_message_nolimit(LOG_INFO, "Lost quorum %lu-%lu=%li > %li for VS %s"
 				    , vs->quorum
 				    , vs->hysteresis
 				    , down_threshold
@@ -363,6 +364,18 @@ update_quorum_state(virtual_server_t * vs)
 	}
 }
 
+/* FMT_VS() formats through the FMT_RS() buffer */
+static void
+journal_svr_state(virtual_server_t * vs, real_server_t * rs, int alive)
+{
+	char rs_name[JOURNAL_NAME_MAX];
+
+	strncpy(rs_name, FMT_RS(rs), sizeof(rs_name) - 1);
+	rs_name[sizeof(rs_name) - 1] = '\0';
+	journal_record(JOURNAL_RS_STATE, !alive, alive, JOURNAL_REASON_CHECK, rs->weight, 0, 0
+			 , FMT_VS(vs), rs_name);
+}
+
 /* manipulate add/remove rs according to alive state */
 int
 perform_svr_state(int alive, virtual_server_t * vs, real_server_t * rs)
@@ -375,7 +388,7 @@ perform_svr_state(int alive, virtual_server_t * vs, real_server_t * rs)
 	 * | 1           | 1     | first check succeeded w/o alpha mode, unreachable here
 	 */
 	if (!ISALIVE(rs) && alive) {
-		log_message(LOG_INFO, "%s service %s to VS %s"
+		log_message_nolimit(LOG_INFO, "%s service %s to VS %s"
 				    , (rs->inhibit) ? "Enabling" : "Adding"
 				    , FMT_RS(rs)
 				    , FMT_VS(vs));
@@ -385,6 +398,7 @@ perform_svr_state(int alive, virtual_server_t * vs, real_server_t * rs)
 				return -1;
 		}
 		rs->alive = alive;
+		journal_svr_state(vs, rs, 1);
 		if (rs->notify_up) {
 			log_message(LOG_INFO, "Executing [%s] for service %s in VS %s"
 					    , rs->notify_up
@@ -401,7 +415,7 @@ perform_svr_state(int alive, virtual_server_t * vs, real_server_t * rs)
 	}
 
 	if (ISALIVE(rs) && !alive) {
-		log_message(LOG_INFO, "%s service %s from VS %s"
+		log_message_nolimit(LOG_INFO, "%s service %s from VS %s"
 				    , (rs->inhibit) ? "Disabling" : "Removing"
 				    , FMT_RS(rs)
 				    , FMT_VS(vs));
@@ -414,6 +428,7 @@ perform_svr_state(int alive, virtual_server_t * vs, real_server_t * rs)
 				return -1;
 		}
 		rs->alive = alive;
+		journal_svr_state(vs, rs, 0);
 		if (rs->notify_down) {
 			log_message(LOG_INFO, "Executing [%s] for service %s in VS %s"
 					    , rs->notify_down
@@ -529,6 +544,43 @@ update_svr_checker_state(int alive, checker_id_t cid, virtual_server_t *vs, real
 	}
 }
 
+/*
+ * Reload diffing. Entries of the new conf are indexed in hash buckets
+ * on their identity key, so that looking up each previous entry is
+ * O(1) and the whole diff stays linear in the conf size. Buckets keep
+ * the list order, so the first match is the same as a list walk.
+ */
+
+static list
+vsge_hashbucket(list index, unsigned int size, virtual_server_group_entry_t *vsge)
+{
+	uint32_t hash = sockstorage_hash(&vsge->addr, HASH_FNV1A_INIT);
+
+	hash = hash_fnv1a(&vsge->range, sizeof(vsge->range), hash);
+	hash = hash_fnv1a(&vsge->vfwmark, sizeof(vsge->vfwmark), hash);
+	return &index[hash & (size - 1)];
+}
+
+/* VS are hashed on part of the VS_ISEQ key, the bucket walk does
+ * the full compare */
+static list
+vs_hashbucket(list index, unsigned int size, virtual_server_t *vs)
+{
+	uint32_t hash = sockstorage_hash(&vs->addr, HASH_FNV1A_INIT);
+
+	hash = hash_fnv1a(&vs->vfwmark, sizeof(vs->vfwmark), hash);
+	hash = hash_string(vs->vsgname, hash);
+	return &index[hash & (size - 1)];
+}
+
+static list
+rs_hashbucket(list index, unsigned int size, real_server_t *rs)
+{
+	uint32_t hash = sockstorage_hash(&rs->addr, HASH_FNV1A_INIT);
+
+	return &index[hash & (size - 1)];
+}
+
 /* Check if a vsg entry is in new data */
 static virtual_server_group_entry_t *
 vsge_exist(virtual_server_group_entry_t *vsg_entry, list l)
@@ -550,11 +602,26 @@ static int
 clear_diff_vsge(list old, list new, virtual_server_t * old_vs)
 {
 	virtual_server_group_entry_t *vsge, *new_vsge;
+	unsigned int size;
+	list index;
 	element e;
 
+	if (LIST_ISEMPTY(old))
+		return 1;
+
+	/* Index the new group entries */
+	size = hash_index_size(LIST_ISEMPTY(new) ? 0 : LIST_SIZE(new));
+	index = alloc_mlist(NULL, NULL, size);
+	if (!LIST_ISEMPTY(new)) {
+		for (e = LIST_HEAD(new); e; ELEMENT_NEXT(e)) {
+			vsge = ELEMENT_DATA(e);
+			list_add(vsge_hashbucket(index, size, vsge), vsge);
+		}
+	}
+
 	for (e = LIST_HEAD(old); e; ELEMENT_NEXT(e)) {
 		vsge = ELEMENT_DATA(e);
-		new_vsge = vsge_exist(vsge, new);
+		new_vsge = vsge_exist(vsge, vsge_hashbucket(index, size, vsge));
 		if (new_vsge) {
 			new_vsge->alive = vsge->alive;
 			new_vsge->reloaded = 1;
@@ -570,6 +637,7 @@ clear_diff_vsge(list old, list new, virtual_server_t * old_vs)
 		}
 	}
 
+	free_mlist(index, size);
 	return 1;
 }
 
@@ -593,15 +661,11 @@ clear_diff_vsg(virtual_server_t * old_vs, virtual_server_t * new_vs)
 
 /* Check if a vs exist in new data and returns pointer to it */
 static virtual_server_t*
-vs_exist(virtual_server_t * old_vs)
+vs_exist(virtual_server_t * old_vs, list l)
 {
 	element e;
-	list l = check_data->vs;
 	virtual_server_t *vs;
 
-	if (LIST_ISEMPTY(l))
-		return NULL;
-
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		vs = ELEMENT_DATA(e);
 		if (VS_ISEQ(old_vs, vs))
@@ -618,9 +682,6 @@ rs_exist(real_server_t * old_rs, list l)
 	element e;
 	real_server_t *rs;
 
-	if (LIST_ISEMPTY(l))
-		return NULL;
-
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		rs = ELEMENT_DATA(e);
 		if (RS_ISEQ(rs, old_rs))
@@ -637,16 +698,28 @@ clear_diff_rs(virtual_server_t * old_vs, list new_rs_list)
 	element e;
 	list l = old_vs->rs;
 	real_server_t *rs, *new_rs;
+	unsigned int size;
+	list index;
 
 	/* If old vs didn't own rs then nothing return */
 	if (LIST_ISEMPTY(l))
 		return 1;
 
+	/* Index the new rs */
+	size = hash_index_size(LIST_ISEMPTY(new_rs_list) ? 0 : LIST_SIZE(new_rs_list));
+	index = alloc_mlist(NULL, NULL, size);
+	if (!LIST_ISEMPTY(new_rs_list)) {
+		for (e = LIST_HEAD(new_rs_list); e; ELEMENT_NEXT(e)) {
+			rs = ELEMENT_DATA(e);
+			list_add(rs_hashbucket(index, size, rs), rs);
+		}
+	}
+
 	/* remove RS from old vs which are not found in new vs */
 	list rs_to_remove = alloc_list (NULL, NULL);
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		rs = ELEMENT_DATA(e);
-		new_rs = rs_exist(rs, new_rs_list);
+		new_rs = rs_exist(rs, rs_hashbucket(index, size, rs));
 		if (!new_rs) {
 			/* Reset inhibit flag to delete inhibit entries */
 			log_message(LOG_INFO, "service %s no longer exist"
@@ -670,6 +743,8 @@ clear_diff_rs(virtual_server_t * old_vs, list new_rs_list)
 			}
 		}
 	}
+	free_mlist(index, size);
+
 	int ret = clear_service_rs (old_vs, rs_to_remove);
 	free_list (rs_to_remove);
 
@@ -683,12 +758,26 @@ clear_diff_services(void)
 {
 	element e;
 	list l = old_check_data->vs;
+	list n = check_data->vs;
 	virtual_server_t *vs, *new_vs;
+	unsigned int size;
+	list index;
+	int ret = 1;
 
 	/* If old config didn't own vs then nothing return */
 	if (LIST_ISEMPTY(l))
 		return 1;
 
+	/* Index the new vs */
+	size = hash_index_size(LIST_ISEMPTY(n) ? 0 : LIST_SIZE(n));
+	index = alloc_mlist(NULL, NULL, size);
+	if (!LIST_ISEMPTY(n)) {
+		for (e = LIST_HEAD(n); e; ELEMENT_NEXT(e)) {
+			vs = ELEMENT_DATA(e);
+			list_add(vs_hashbucket(index, size, vs), vs);
+		}
+	}
+
 	/* Remove diff entries from previous IPVS rules */
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		vs = ELEMENT_DATA(e);
@@ -697,7 +786,7 @@ clear_diff_services(void)
 		 * Try to find this vs into the new conf data
 		 * reloaded.
 		 */
-		new_vs = vs_exist(vs);
+		new_vs = vs_exist(vs, vs_hashbucket(index, size, vs));
 		if (!new_vs) {
 			if (vs->vsgname)
 				log_message(LOG_INFO, "Removing Virtual Server Group [%s]"
@@ -707,8 +796,10 @@ clear_diff_services(void)
 						    , FMT_VS(vs));
 
 			/* Clear VS entry */
-			if (!clear_service_vs(vs))
-				return 0;
+			if (!clear_service_vs(vs)) {
+				ret = 0;
+				break;
+			}
 		} else {
 			/* copy status fields from old VS */
 			SET_ALIVE(new_vs);
@@ -722,8 +813,10 @@ clear_diff_services(void)
 			/* omega = 0 must not prevent the notifiers from being called,
 			   because the VS still exists in new configuration */
 			vs->omega = 1;
-			if (!clear_diff_rs(vs, new_vs->rs))
-				return 0;
+			if (!clear_diff_rs(vs, new_vs->rs)) {
+				ret = 0;
+				break;
+			}
 			if (vs->s_svr && ISALIVE(vs->s_svr))
 				ipvs_cmd(LVS_CMD_DEL_DEST
 					      , vs
@@ -731,7 +824,8 @@ clear_diff_services(void)
 		}
 	}
 
-	return 1;
+	free_mlist(index, size);
+	return ret;
 }
 
 void
@@ -91,6 +91,7 @@ set_vrrp_defaults(data_t * data)
 	data->vrrp_garp_rep = VRRP_GARP_REP;
 	data->vrrp_garp_refresh_rep = VRRP_GARP_REFRESH_REP;
 	data->vrrp_garp_delay = VRRP_GARP_DELAY;
+	data->vrrp_garp_batch = VRRP_GARP_BATCH;
 	data->vrrp_version = VRRP_VERSION_2;
 }
 
@@ -130,6 +131,8 @@ alloc_global_data(void)
 
 	set_default_mcast_group(new);
 	set_vrrp_defaults(new);
+	new->log_rate_burst = LOG_RATE_BURST;
+	new->log_rate_interval = LOG_RATE_INTERVAL;
 
 	return new;
 }
@@ -157,6 +160,11 @@ free_global_data(data_t * data)
 	free_list(data->email);
 	FREE_PTR(data->router_id);
 	FREE_PTR(data->email_from);
+	FREE_PTR(data->vrrp_ipset_address);
+	FREE_PTR(data->vrrp_ipset_address6);
+	FREE_PTR(data->vrrp_notify_fifo);
+	FREE_PTR(data->vrrp_notify_socket);
+	FREE_PTR(data->event_journal);
 	FREE(data);
 }
 
@@ -198,7 +206,27 @@ dump_global_data(data_t * data)
 		       data->vrrp_garp_refresh.tv_sec);
 	log_message(LOG_INFO, " Gratuitous ARP repeat = %d", data->vrrp_garp_rep);
 	log_message(LOG_INFO, " Gratuitous ARP refresh repeat = %d", data->vrrp_garp_refresh_rep);
+	if (data->vrrp_garp_rate)
+		log_message(LOG_INFO, " Gratuitous ARP rate = %d pps", data->vrrp_garp_rate);
+	log_message(LOG_INFO, " Gratuitous ARP batch = %d", data->vrrp_garp_batch);
+	if (data->vrrp_garp_tx_ring)
+		log_message(LOG_INFO, " Gratuitous ARP TX ring enabled");
 	log_message(LOG_INFO, " VRRP default protocol version = %d", data->vrrp_version);
+	if (data->vrrp_ipsets)
+		log_message(LOG_INFO, " VRRP ipsets = %s, %s", data->vrrp_ipset_address
+				    , data->vrrp_ipset_address6);
+	if (data->vrrp_notify_fifo)
+		log_message(LOG_INFO, " VRRP notify FIFO = %s", data->vrrp_notify_fifo);
+	if (data->vrrp_notify_socket)
+		log_message(LOG_INFO, " VRRP notify socket = %s", data->vrrp_notify_socket);
+	if (data->event_journal)
+		log_message(LOG_INFO, " Event journal = %s, %u records", data->event_journal
+				    , data->event_journal_size);
+	if (data->log_rate_burst)
+		log_message(LOG_INFO, " Log rate limit = %d messages per %d seconds"
+				    , data->log_rate_burst, data->log_rate_interval);
+	else
+		log_message(LOG_INFO, " Log rate limit disabled");
 #ifdef _WITH_SNMP_
 	if (data->enable_traps)
 		log_message(LOG_INFO, " SNMP Trap enabled");
@@ -23,12 +23,15 @@
  */
 
 #include <netdb.h>
+#include <linux/netfilter/ipset/ip_set.h>
 #include "global_parser.h"
 #include "global_data.h"
 #include "check_data.h"
 #include "parser.h"
 #include "memory.h"
 #include "smtp.h"
+#include "journal.h"
+#include "vrrp_ipset.h"
 #include "utils.h"
 #include "logger.h"
 
@@ -128,6 +131,27 @@ vrrp_garp_refresh_rep_handler(vector_t *strvec)
 		global_data->vrrp_garp_refresh_rep = 1;
 }
 static void
+vrrp_garp_rate_handler(vector_t *strvec)
+{
+	global_data->vrrp_garp_rate = atoi(vector_slot(strvec, 1));
+	if (global_data->vrrp_garp_rate < 0)
+		global_data->vrrp_garp_rate = 0;
+}
+static void
+vrrp_garp_batch_handler(vector_t *strvec)
+{
+	global_data->vrrp_garp_batch = atoi(vector_slot(strvec, 1));
+	if (global_data->vrrp_garp_batch < 1)
+		global_data->vrrp_garp_batch = 1;
+	else if (global_data->vrrp_garp_batch > VRRP_GARP_BATCH_MAX)
+		global_data->vrrp_garp_batch = VRRP_GARP_BATCH_MAX;
+}
+static void
+vrrp_garp_tx_ring_handler(vector_t *strvec)
+{
+	global_data->vrrp_garp_tx_ring = 1;
+}
+static void
 vrrp_version_handler(vector_t *strvec)
 {
 	uint8_t version = atoi(vector_slot(strvec, 1));
@@ -138,6 +162,72 @@ vrrp_version_handler(vector_t *strvec)
 	}
 	global_data->vrrp_version = version;
 }
+static char *
+ipset_name_value(char *name)
+{
+	char *str;
+
+	if (strlen(name) >= IPSET_MAXNAMELEN)
+		log_message(LOG_INFO, "ipset name %s too long, truncated to %d chars"
+				    , name, IPSET_MAXNAMELEN - 1);
+	str = (char *) MALLOC(IPSET_MAXNAMELEN);
+	strncpy(str, name, IPSET_MAXNAMELEN - 1);
+	return str;
+}
+static void
+vrrp_ipsets_handler(vector_t *strvec)
+{
+	FREE_PTR(global_data->vrrp_ipset_address);
+	FREE_PTR(global_data->vrrp_ipset_address6);
+	global_data->vrrp_ipsets = 1;
+	global_data->vrrp_ipset_address = ipset_name_value((vector_size(strvec) >= 2) ?
+						vector_slot(strvec, 1) : IPSET_DEFAULT_NAME);
+	global_data->vrrp_ipset_address6 = ipset_name_value((vector_size(strvec) >= 3) ?
+						vector_slot(strvec, 2) : IPSET_DEFAULT_NAME6);
+}
+static void
+vrrp_notify_fifo_handler(vector_t *strvec)
+{
+	FREE_PTR(global_data->vrrp_notify_fifo);
+	global_data->vrrp_notify_fifo = set_value(strvec);
+}
+static void
+vrrp_notify_socket_handler(vector_t *strvec)
+{
+	FREE_PTR(global_data->vrrp_notify_socket);
+	global_data->vrrp_notify_socket = set_value(strvec);
+}
+static void
+event_journal_handler(vector_t *strvec)
+{
+	int size = JOURNAL_DEFAULT_SIZE;
+
+	if (vector_size(strvec) >= 3) {
+		size = atoi(vector_slot(strvec, 2));
+		if (size < JOURNAL_MIN_SIZE)
+			size = JOURNAL_MIN_SIZE;
+		else if (size > JOURNAL_MAX_SIZE)
+			size = JOURNAL_MAX_SIZE;
+	}
+
+	FREE_PTR(global_data->event_journal);
+	global_data->event_journal = set_value(strvec);
+	global_data->event_journal_size = size;
+}
+static void
+log_rate_burst_handler(vector_t *strvec)
+{
+	global_data->log_rate_burst = atoi(vector_slot(strvec, 1));
+	if (global_data->log_rate_burst < 0)
+		global_data->log_rate_burst = 0;
+}
+static void
+log_rate_interval_handler(vector_t *strvec)
+{
+	global_data->log_rate_interval = atoi(vector_slot(strvec, 1));
+	if (global_data->log_rate_interval < 1)
+		global_data->log_rate_interval = 1;
+}
 #ifdef _WITH_SNMP_
 static void
 trap_handler(vector_t *strvec)
@@ -163,7 +253,16 @@ global_init_keywords(void)
 	install_keyword("vrrp_garp_master_repeat", &vrrp_garp_rep_handler);
 	install_keyword("vrrp_garp_master_refresh", &vrrp_garp_refresh_handler);
 	install_keyword("vrrp_garp_master_refresh_repeat", &vrrp_garp_refresh_rep_handler);
+	install_keyword("vrrp_garp_rate", &vrrp_garp_rate_handler);
+	install_keyword("vrrp_garp_batch", &vrrp_garp_batch_handler);
+	install_keyword("vrrp_garp_tx_ring", &vrrp_garp_tx_ring_handler);
 	install_keyword("vrrp_version", &vrrp_version_handler);
+	install_keyword("vrrp_ipsets", &vrrp_ipsets_handler);
+	install_keyword("vrrp_notify_fifo", &vrrp_notify_fifo_handler);
+	install_keyword("vrrp_notify_socket", &vrrp_notify_socket_handler);
+	install_keyword("event_journal", &event_journal_handler);
+	install_keyword("log_rate_burst", &log_rate_burst_handler);
+	install_keyword("log_rate_interval", &log_rate_interval_handler);
 #ifdef _WITH_SNMP_
 	install_keyword("enable_traps", &trap_handler);
 #endif
@@ -0,0 +1,384 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Binary event journal.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "journal.h"
+#include "vrrp.h"
+#include "memory.h"
+#include "logger.h"
+
+#define NSEC_PER_SEC	1000000000ULL
+
+/*
+ * Postmortem record of VRRP transitions and real server state changes.
+ * The file is mapped shared by the VRRP and checker children, a slot
+ * is claimed by an atomic increment of the header sequence so logging
+ * an event costs a record copy and no system call. The ring wraps, the
+ * most recent nr_rec events are kept.
+ */
+static journal_hdr_t *journal_hdr = NULL;
+static journal_rec_t *journal_recs;
+static size_t journal_len;
+static char *journal_path;
+
+static uint64_t
+journal_clock(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return (uint64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int
+journal_hdr_valid(journal_hdr_t *hdr, size_t len)
+{
+	return !memcmp(hdr->magic, JOURNAL_MAGIC, sizeof(hdr->magic)) &&
+	       hdr->version == JOURNAL_VERSION &&
+	       hdr->rec_size == sizeof(journal_rec_t) &&
+	       len == sizeof(journal_hdr_t) + (size_t) hdr->nr_rec * sizeof(journal_rec_t);
+}
+
+/* Open path locked, making sure it is still the file path names */
+static int
+journal_lock(const char *path)
+{
+	struct stat st, pst;
+	int tries, fd;
+
+	for (tries = 0; tries < 3; tries++) {
+		fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+		if (fd < 0)
+			return -1;
+		if (!flock(fd, LOCK_EX) && !fstat(fd, &st) && !stat(path, &pst) &&
+		    st.st_dev == pst.st_dev && st.st_ino == pst.st_ino)
+			return fd;
+		close(fd);
+	}
+
+	errno = EBUSY;
+	return -1;
+}
+
+/* Initialize a new journal file and put it in place. A journal of
+ * another size or format is replaced rather than truncated, the other
+ * child may still have it mapped.
+ */
+static int
+journal_create(const char *path, int fd, unsigned int nr)
+{
+	journal_hdr_t hdr;
+	char *tmp;
+	int new_fd;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, JOURNAL_MAGIC, sizeof(hdr.magic));
+	hdr.version = JOURNAL_VERSION;
+	hdr.rec_size = sizeof(journal_rec_t);
+	hdr.nr_rec = nr;
+
+	tmp = MALLOC(strlen(path) + 8);
+	sprintf(tmp, "%s.XXXXXX", path);
+	new_fd = mkstemp(tmp);
+	if (new_fd < 0)
+		goto err;
+
+	if (ftruncate(new_fd, sizeof(hdr) + (off_t) nr * sizeof(journal_rec_t)) ||
+	    pwrite(new_fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+	    rename(tmp, path)) {
+		unlink(tmp);
+		close(new_fd);
+		goto err;
+	}
+
+	FREE(tmp);
+	close(fd);
+	return new_fd;
+
+err:
+	FREE(tmp);
+	return -1;
+}
+
+void
+journal_open(const char *path, unsigned int nr)
+{
+	struct stat st;
+	size_t len = sizeof(journal_hdr_t) + (size_t) nr * sizeof(journal_rec_t);
+	void *map;
+	int fd, new_fd;
+
+	if (journal_hdr) {
+		/* Kept across a reload if unchanged */
+		if (path && !strcmp(path, journal_path) && nr == journal_hdr->nr_rec)
+			return;
+		journal_close();
+	}
+
+	if (!path)
+		return;
+
+	fd = journal_lock(path);
+	if (fd < 0) {
+		log_message(LOG_INFO, "Journal: cannot open %s (%s)", path, strerror(errno));
+		return;
+	}
+
+	/* Reuse a journal of the same geometry, start afresh otherwise */
+	map = MAP_FAILED;
+	if (!fstat(fd, &st) && st.st_size == (off_t) len) {
+		map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (map != MAP_FAILED && !journal_hdr_valid(map, len)) {
+			munmap(map, len);
+			map = MAP_FAILED;
+		}
+	}
+
+	if (map == MAP_FAILED) {
+		new_fd = journal_create(path, fd, nr);
+		if (new_fd < 0) {
+			log_message(LOG_INFO, "Journal: cannot create %s (%s)", path, strerror(errno));
+			close(fd);
+			return;
+		}
+		fd = new_fd;
+		map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			log_message(LOG_INFO, "Journal: cannot map %s (%s)", path, strerror(errno));
+			close(fd);
+			return;
+		}
+	}
+
+	journal_hdr = map;
+	journal_recs = (journal_rec_t *) (journal_hdr + 1);
+	journal_len = len;
+	journal_path = MALLOC(strlen(path) + 1);
+	strcpy(journal_path, path);
+
+	/* The mapping outlives the descriptor */
+	close(fd);
+}
+
+void
+journal_close(void)
+{
+	if (!journal_hdr)
+		return;
+
+	munmap(journal_hdr, journal_len);
+	journal_hdr = NULL;
+	FREE(journal_path);
+	journal_path = NULL;
+}
+
+static void
+journal_strcpy(char *dst, const char *src)
+{
+	if (!src)
+		src = "";
+	strncpy(dst, src, JOURNAL_NAME_MAX - 1);
+	dst[JOURNAL_NAME_MAX - 1] = '\0';
+}
+
+void
+journal_record(int type, int from, int to, int reason, int prio, int peer_prio,
+	       unsigned int id, const char *name, const char *detail)
+{
+	journal_rec_t *rec;
+	uint64_t seq;
+
+	if (!journal_hdr)
+		return;
+
+	seq = __atomic_add_fetch(&journal_hdr->seq, 1, __ATOMIC_RELAXED);
+	rec = &journal_recs[(seq - 1) % journal_hdr->nr_rec];
+
+	/* Invalidate the slot while it is being written */
+	__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	rec->time = journal_clock(CLOCK_MONOTONIC);
+	rec->realtime = journal_clock(CLOCK_REALTIME);
+	rec->pid = getpid();
+	rec->id = id;
+	rec->type = type;
+	rec->from = from;
+	rec->to = to;
+	rec->reason = reason;
+	rec->prio = prio;
+	rec->peer_prio = peer_prio;
+	journal_strcpy(rec->name, name);
+	journal_strcpy(rec->detail, detail);
+
+	__atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+}
+
+/* Reader */
+static const char *journal_reason_str[JOURNAL_REASON_MAX] = {
+	[JOURNAL_REASON_NONE]		= "none",
+	[JOURNAL_REASON_STARTUP]	= "startup",
+	[JOURNAL_REASON_RELOAD]		= "reload",
+	[JOURNAL_REASON_ELECTION]	= "master election",
+	[JOURNAL_REASON_HIGHER_PRIO]	= "higher priority advert",
+	[JOURNAL_REASON_FAULT]		= "fault",
+	[JOURNAL_REASON_FAULT_CLEAR]	= "fault cleared",
+	[JOURNAL_REASON_SYNC_GROUP]	= "sync group",
+	[JOURNAL_REASON_CHECK]		= "health check",
+};
+
+static const char *
+journal_vrrp_state_str(int state)
+{
+	switch (state) {
+	case VRRP_STATE_INIT:
+		return "INIT";
+	case VRRP_STATE_BACK:
+		return "BACKUP";
+	case VRRP_STATE_MAST:
+		return "MASTER";
+	case VRRP_STATE_FAULT:
+		return "FAULT";
+	case VRRP_STATE_GOTO_MASTER:
+		return "GOTO_MASTER";
+	case VRRP_STATE_LEAVE_MASTER:
+		return "LEAVE_MASTER";
+	case VRRP_STATE_GOTO_FAULT:
+		return "GOTO_FAULT";
+	}
+	return "UNKNOWN";
+}
+
+static int
+journal_rec_cmp(const void *a, const void *b)
+{
+	const journal_rec_t *ra = a, *rb = b;
+
+	return (ra->seq > rb->seq) - (ra->seq < rb->seq);
+}
+
+static void
+journal_print(journal_rec_t *rec)
+{
+	time_t wall = rec->realtime / NSEC_PER_SEC;
+	const char *reason = (rec->reason < JOURNAL_REASON_MAX) ?
+			     journal_reason_str[rec->reason] : "unknown";
+	char stamp[32];
+	struct tm tm;
+
+	localtime_r(&wall, &tm);
+	strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+	printf("%8llu %s %6llu.%06llu %6u "
+	       , (unsigned long long) rec->seq, stamp
+	       , (unsigned long long) (rec->time / NSEC_PER_SEC)
+	       , (unsigned long long) (rec->time % NSEC_PER_SEC) / 1000
+	       , rec->pid);
+
+	switch (rec->type) {
+	case JOURNAL_VRRP_STATE:
+		printf("VRRP_Instance(%s) %s vrid %u %s -> %s (%s) prio %d master prio %d\n"
+		       , rec->name, rec->detail, rec->id
+		       , journal_vrrp_state_str(rec->from)
+		       , journal_vrrp_state_str(rec->to)
+		       , reason, rec->prio, rec->peer_prio);
+		break;
+	case JOURNAL_RS_STATE:
+		printf("RS %s of VS %s %s -> %s (%s) weight %d\n"
+		       , rec->detail, rec->name
+		       , rec->from ? "UP" : "DOWN", rec->to ? "UP" : "DOWN"
+		       , reason, rec->prio);
+		break;
+	default:
+		printf("unknown event type %u\n", rec->type);
+	}
+}
+
+/* Decode a journal to stdout, oldest event first. Returns the exit status */
+int
+journal_dump(const char *path)
+{
+	journal_hdr_t *hdr;
+	journal_rec_t *recs;
+	struct stat st;
+	unsigned int i, n = 0;
+	uint64_t seq;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0 || fstat(fd, &st)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	if (st.st_size < (off_t) sizeof(journal_hdr_t)) {
+		fprintf(stderr, "%s: not a keepalived journal\n", path);
+		close(fd);
+		return 1;
+	}
+
+	hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hdr == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	if (!journal_hdr_valid(hdr, st.st_size)) {
+		fprintf(stderr, "%s: not a keepalived journal\n", path);
+		munmap(hdr, st.st_size);
+		return 1;
+	}
+
+	/* Snapshot the valid slots, skipping those being written */
+	recs = MALLOC(hdr->nr_rec * sizeof(journal_rec_t));
+	for (i = 0; i < hdr->nr_rec; i++) {
+		journal_rec_t *rec = (journal_rec_t *) (hdr + 1) + i;
+
+		seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+		if (!seq)
+			continue;
+		memcpy(&recs[n], rec, sizeof(journal_rec_t));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&rec->seq, __ATOMIC_RELAXED) != seq)
+			continue;
+		n++;
+	}
+	qsort(recs, n, sizeof(journal_rec_t), journal_rec_cmp);
+
+	printf("%s: %u of %u records, %llu events logged\n", path, n, hdr->nr_rec
+	       , (unsigned long long) hdr->seq);
+	for (i = 0; i < n; i++)
+		journal_print(&recs[i]);
+
+	FREE(recs);
+	munmap(hdr, st.st_size);
+	return 0;
+}
@@ -24,8 +24,15 @@
 #include "config.h"
 #include "signals.h"
 #include "pidfile.h"
+#include "journal.h"
 #include "bitops.h"
 #include "logger.h"
+#ifdef _WITH_VRRP_
+#include "vrrp_parser.h"
+#endif
+#ifdef _WITH_LVS_
+#include "check_parser.h"
+#endif
 
 /* global var */
 char *conf_file = NULL;		/* Configuration file */
@@ -37,6 +44,7 @@ int linkwatch = 0;		/* Use linkwatch kernel netlink reflection */
 char *main_pidfile = KEEPALIVED_PID_FILE;	/* overrule default pidfile */
 char *checkers_pidfile = CHECKERS_PID_FILE;	/* overrule default pidfile */
 char *vrrp_pidfile = VRRP_PID_FILE;	/* overrule default pidfile */
+static int config_test = 0;		/* Check configuration and exit */
 #ifdef _WITH_SNMP_
 int snmp = 0;			/* Enable SNMP support */
 const char *snmp_socket = NULL;	/* Socket to use for SNMP agent */
@@ -88,14 +96,33 @@ start_keepalived(void)
 #endif
 }
 
+/* Keywords of every subsystem, for configuration checking */
+static vector_t *
+keepalived_init_keywords(void)
+{
+#ifdef _WITH_VRRP_
+	vrrp_init_keywords();
+#endif
+#ifdef _WITH_LVS_
+	check_init_keywords();
+#endif
+	return keywords;
+}
+
 /* SIGHUP/USR1/USR2 handler */
 static void
 propogate_signal(void *v, int sig)
 {
+	/* Children only reload a configuration that parses */
+	if (sig == SIGHUP && validate_data(conf_file, keepalived_init_keywords)) {
+		log_message(LOG_INFO, "Configuration check failed, keeping running configuration");
+		return;
+	}
+
 	/* Signal child process */
 	if (vrrp_child > 0)
 		kill(vrrp_child, sig);
-	if (checkers_child > 0 && sig == SIGHUP)
+	if (checkers_child > 0 && (sig == SIGHUP || sig == SIGUSR2))
 		kill(checkers_child, sig);
 }
 
@@ -148,6 +175,9 @@ usage(const char *prog)
 	fprintf(stderr, "  -R, --dont-respawn           Don't respawn child processes\n");
 	fprintf(stderr, "  -n, --dont-fork              Don't fork the daemon process\n");
 	fprintf(stderr, "  -d, --dump-conf              Dump the configuration data\n");
+	fprintf(stderr, "  -t, --config-test            Check the configuration file and exit\n");
+	fprintf(stderr, "  -k, --config-cache=FILE      Cache the parsed configuration in FILE\n");
+	fprintf(stderr, "  -J, --dump-journal=FILE      Decode the event journal FILE and exit\n");
 	fprintf(stderr, "  -p, --pid=FILE               Use specified pidfile for parent process\n");
 	fprintf(stderr, "  -r, --vrrp_pid=FILE          Use specified pidfile for VRRP child process\n");
 	fprintf(stderr, "  -c, --checkers_pid=FILE      Use specified pidfile for checkers child process\n");
@@ -178,6 +208,9 @@ parse_cmdline(int argc, char **argv)
 		{"dont-respawn",      no_argument,       0, 'R'},
 		{"dont-fork",         no_argument,       0, 'n'},
 		{"dump-conf",         no_argument,       0, 'd'},
+		{"config-test",       no_argument,       0, 't'},
+		{"config-cache",      required_argument, 0, 'k'},
+		{"dump-journal",      required_argument, 0, 'J'},
 		{"pid",               required_argument, 0, 'p'},
 		{"vrrp_pid",          required_argument, 0, 'r'},
 		{"checkers_pid",      required_argument, 0, 'c'},
@@ -191,9 +224,9 @@ parse_cmdline(int argc, char **argv)
 	};
 
 #ifdef _WITH_SNMP_
-	while ((c = getopt_long(argc, argv, "vhlndVIDRS:f:PCp:c:r:xA:", long_options, NULL)) != EOF) {
+	while ((c = getopt_long(argc, argv, "vhlndtVIDRS:f:k:J:PCp:c:r:xA:", long_options, NULL)) != EOF) {
 #else
-	while ((c = getopt_long(argc, argv, "vhlndVIDRS:f:PCp:c:r:", long_options, NULL)) != EOF) {
+	while ((c = getopt_long(argc, argv, "vhlndtVIDRS:f:k:J:PCp:c:r:", long_options, NULL)) != EOF) {
 #endif
 		switch (c) {
 		case 'v':
@@ -213,6 +246,9 @@ parse_cmdline(int argc, char **argv)
 		case 'd':
 			__set_bit(DUMP_CONF_BIT, &debug);
 			break;
+		case 't':
+			config_test = 1;
+			break;
 		case 'V':
 			__set_bit(DONT_RELEASE_VRRP_BIT, &debug);
 			break;
@@ -234,6 +270,12 @@ parse_cmdline(int argc, char **argv)
 		case 'f':
 			conf_file = optarg;
 			break;
+		case 'k':
+			conf_cache = optarg;
+			break;
+		case 'J':
+			exit(journal_dump(optarg));
+			break;
 		case 'P':
 			daemon_mode |= 1;
 			break;
@@ -287,6 +329,17 @@ main(int argc, char **argv)
 
 	openlog(PROG, LOG_PID | ((__test_bit(LOG_CONSOLE_BIT, &debug)) ? LOG_CONS : 0)
 		    , log_facility);
+	if (config_test) {
+		enable_console_log();
+		if (validate_data(conf_file, keepalived_init_keywords)) {
+			log_message(LOG_INFO, "Configuration check failed");
+			closelog();
+			exit(1);
+		}
+		closelog();
+		exit(0);
+	}
+
 	log_message(LOG_INFO, "Starting " VERSION_STRING);
 
 	/* Check if keepalived is already running */
@@ -24,6 +24,7 @@
 #include "logger.h"
 #include "config.h"
 #include "global_data.h"
+#include "memory.h"
 
 static int
 snmp_keepalived_log(int major, int minor, void *serverarg, void *clientarg)
@@ -85,6 +86,40 @@ snmp_header_list_table(struct variable *vp, oid *name, size_t *length,
 	return NULL;
 }
 
+/* Memory accounting of the process answering, one row per category */
+u_char*
+snmp_memory(struct variable *vp, oid *name, size_t *length,
+	    int exact, size_t *var_len, WriteMethod **write_method)
+{
+	static unsigned long long_ret;
+	mem_stat_t *stat;
+	int category;
+
+	if (header_simple_table(vp, name, length, exact, var_len, write_method, MEM_CAT_MAX))
+		return NULL;
+
+	category = name[*length - 1] - 1;
+	stat = &mem_stats[category];
+
+	switch (vp->magic) {
+	case SNMP_MEMORY_CATEGORY:
+		*var_len = strlen(mem_category_name[category]);
+		return (u_char *)mem_category_name[category];
+	case SNMP_MEMORY_BYTES:
+		long_ret = stat->bytes;
+		return (u_char *)&long_ret;
+	case SNMP_MEMORY_BLOCKS:
+		long_ret = stat->blocks;
+		return (u_char *)&long_ret;
+	case SNMP_MEMORY_ALLOCS:
+		long_ret = stat->allocs;
+		return (u_char *)&long_ret;
+	default:
+		break;
+	}
+	return NULL;
+}
+
 #define SNMP_KEEPALIVEDVERSION 1
 #define SNMP_ROUTERID 2
 #define SNMP_MAIL_SMTPSERVERADDRESSTYPE 3
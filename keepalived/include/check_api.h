@@ -41,6 +41,7 @@ typedef struct _conn_opts {
 typedef struct _checker {
 	void				(*free_func) (void *);
 	void				(*dump_func) (void *);
+	int				(*compare_func) (void *, void *);
 	int				(*launch) (struct _thread *);
 	virtual_server_t		*vs;	/* pointer to the checker thread virtualserver */
 	real_server_t			*rs;	/* pointer to the checker thread realserver */
@@ -53,6 +54,7 @@ typedef struct _checker {
 
 /* Checkers queue */
 extern list checkers_queue;
+extern list old_checkers_queue;
 
 /* utility macro */
 #define CHECKER_ARG(X) ((X)->data)
@@ -75,12 +77,15 @@ extern list checkers_queue;
 /* Prototypes definition */
 extern void init_checkers_queue(void);
 extern void dump_conn_opts (conn_opts_t *);
+extern int conn_opts_equal(conn_opts_t *, conn_opts_t *);
 extern void queue_checker(void (*free_func) (void *), void (*dump_func) (void *)
+			  , int (*compare_func) (void *, void *)
 			  , int (*launch) (thread_t *)
 			  , void *
 			  , conn_opts_t *);
 extern void dump_checkers_queue(void);
 extern void free_checkers_queue(void);
+extern void free_old_checkers_queue(void);
 extern void register_checkers_thread(void);
 extern void install_checkers_keyword(void);
 extern void install_connect_keywords(void);
@@ -46,6 +46,7 @@
 #include "list.h"
 #include "vector.h"
 #include "timer.h"
+#include "utils.h"
 
 /* Typedefs */
 typedef unsigned int checker_id_t;
@@ -190,6 +191,27 @@ static inline int sockstorage_equal(const struct sockaddr_storage *s1,
 	return 0;
 }
 
+/* Hash an address as compared by sockstorage_equal() */
+static inline uint32_t sockstorage_hash(const struct sockaddr_storage *addr,
+					uint32_t hash)
+{
+	if (addr->ss_family == AF_INET6) {
+		struct sockaddr_in6 *a6 = (struct sockaddr_in6 *) addr;
+
+		hash = hash_fnv1a(&a6->sin6_addr, sizeof(a6->sin6_addr), hash);
+		return hash_fnv1a(&a6->sin6_port, sizeof(a6->sin6_port), hash);
+	}
+
+	if (addr->ss_family == AF_INET) {
+		struct sockaddr_in *a4 = (struct sockaddr_in *) addr;
+
+		hash = hash_fnv1a(&a4->sin_addr, sizeof(a4->sin_addr), hash);
+		return hash_fnv1a(&a4->sin_port, sizeof(a4->sin_port), hash);
+	}
+
+	return hash;
+}
+
 static inline int inaddr_equal(sa_family_t family, void *addr1, void *addr2)
 {
 	if (family == AF_INET6) {
@@ -35,6 +35,7 @@
 #include "scheduler.h"
 #include "layer4.h"
 #include "list.h"
+#include "array.h"
 
 /* Checker argument structure  */
 /* ssl specific thread arguments defs */
@@ -66,7 +67,7 @@ typedef struct _http_checker {
 	int				proto;
 	int				nb_get_retry;
 	long				delay_before_retry;
-	list				url;
+	array_t				*url;
 	http_t				*arg;
 } http_checker_t;
 
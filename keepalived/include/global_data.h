@@ -56,7 +56,19 @@ typedef struct _data {
 	timeval_t			vrrp_garp_refresh;
 	int				vrrp_garp_rep;
 	int				vrrp_garp_refresh_rep;
+	int				vrrp_garp_rate;		/* gratuitous ARP pps, 0 = no pacing */
+	int				vrrp_garp_batch;	/* gratuitous ARP frames per batch */
+	int				vrrp_garp_tx_ring;	/* send gratuitous ARP through TX ring */
 	int				vrrp_version;            /* VRRP version (2 or 3) */
+	int				vrrp_ipsets;		/* accept mode drop rules via ipset */
+	char				*vrrp_ipset_address;	/* IPv4 set name */
+	char				*vrrp_ipset_address6;	/* IPv6 set name */
+	char				*vrrp_notify_fifo;	/* transition events FIFO */
+	char				*vrrp_notify_socket;	/* transition events unix socket */
+	char				*event_journal;		/* binary event journal file */
+	unsigned int			event_journal_size;	/* journal records */
+	int				log_rate_burst;		/* messages per call site, 0 = no limit */
+	int				log_rate_interval;	/* rate limiting interval, seconds */
 #ifdef _WITH_SNMP_
 	int				enable_traps;
 #endif
@@ -0,0 +1,92 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        journal.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+/* system includes */
+#include <stdint.h>
+
+/* local definitions */
+#define JOURNAL_MAGIC		"KAJRNL01"
+#define JOURNAL_VERSION		2
+#define JOURNAL_DEFAULT_SIZE	4096	/* Records */
+#define JOURNAL_MIN_SIZE	64
+#define JOURNAL_MAX_SIZE	(1024 * 1024)
+#define JOURNAL_NAME_MAX	44
+
+/* Event types */
+#define JOURNAL_VRRP_STATE	1	/* VRRP instance state transition */
+#define JOURNAL_RS_STATE	2	/* Real server up/down */
+
+/* Transition reasons */
+enum journal_reason {
+	JOURNAL_REASON_NONE,
+	JOURNAL_REASON_STARTUP,		/* Initial state */
+	JOURNAL_REASON_RELOAD,		/* State carried over a reload */
+	JOURNAL_REASON_ELECTION,	/* No advert from a better master */
+	JOURNAL_REASON_HIGHER_PRIO,	/* Advert from a better master */
+	JOURNAL_REASON_FAULT,		/* Interface or tracked object down */
+	JOURNAL_REASON_FAULT_CLEAR,	/* Interface and tracked objects up */
+	JOURNAL_REASON_SYNC_GROUP,	/* Following its sync group */
+	JOURNAL_REASON_CHECK,		/* Health check result */
+	JOURNAL_REASON_MAX
+};
+
+/*
+ * On disk layout: a header followed by a ring of fixed size records,
+ * shared by all the processes writing to the file. A record slot is
+ * valid once its seq is non zero, seq is written last.
+ */
+typedef struct _journal_hdr {
+	char			magic[8];
+	uint32_t		version;
+	uint32_t		rec_size;
+	uint32_t		nr_rec;
+	uint32_t		pad;
+	uint64_t		seq;		/* Last sequence number handed out */
+} __attribute__ ((aligned (128))) journal_hdr_t;
+
+typedef struct _journal_rec {
+	uint64_t		seq;
+	uint64_t		time;		/* CLOCK_MONOTONIC, nsec */
+	uint64_t		realtime;	/* CLOCK_REALTIME, nsec */
+	uint32_t		pid;
+	uint32_t		id;		/* VRID */
+	uint8_t			type;
+	uint8_t			from;		/* Old and new state */
+	uint8_t			to;
+	uint8_t			reason;
+	int16_t			prio;		/* Effective priority, RS weight */
+	int16_t			peer_prio;	/* Last received master priority */
+	char			name[JOURNAL_NAME_MAX];		/* Instance, VS */
+	char			detail[JOURNAL_NAME_MAX];	/* Interface, RS */
+} journal_rec_t;
+
+/* prototypes */
+extern void journal_open(const char *, unsigned int);
+extern void journal_close(void);
+extern void journal_record(int, int, int, int, int, int, unsigned int,
+			   const char *, const char *);
+extern int journal_dump(const char *);
+
+#endif
@@ -48,6 +48,12 @@ int header_generic(struct variable *, oid *, size_t *, int,
 #define SNMPTRAP_OID 1, 3, 6, 1, 6, 3, 1, 1, 4, 1, 0
 #define GLOBAL_OID {KEEPALIVED_OID, 1}
 
+/* Memory accounting table columns, shared by the VRRP and check MIBs */
+#define SNMP_MEMORY_CATEGORY 2
+#define SNMP_MEMORY_BYTES 3
+#define SNMP_MEMORY_BLOCKS 4
+#define SNMP_MEMORY_ALLOCS 5
+
 /* For net-snmp */
 extern int register_sysORTable(oid *, size_t, const char *);
 extern int unregister_sysORTable(oid *, size_t);
@@ -56,6 +62,8 @@ extern unsigned long snmp_scope(int scope);
 extern void* snmp_header_list_table(struct variable *vp, oid *name, size_t *length,
 				    int exact, size_t *var_len, WriteMethod **write_method,
 				    list dlist);
+extern u_char *snmp_memory(struct variable *vp, oid *name, size_t *length,
+			   int exact, size_t *var_len, WriteMethod **write_method);
 extern void snmp_agent_init(const char *snmp_socket);
 extern void snmp_register_mib(oid *myoid, int len,
 			      const char *name, struct variable *variables,
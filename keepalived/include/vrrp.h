@@ -83,6 +83,8 @@ typedef struct {
 #define VRRP_GARP_DELAY 	(5 * TIMER_HZ)	/* Default delay to launch gratuitous arp */
 #define VRRP_GARP_REP		5		/* Default repeat value for MASTER state gratuitous arp */
 #define VRRP_GARP_REFRESH_REP	1		/* Default repeat value for refresh gratuitous arp */
+#define VRRP_GARP_BATCH		64		/* Default gratuitous arp frames per sendmmsg() */
+#define VRRP_GARP_BATCH_MAX	1024		/* Max gratuitous arp frames per sendmmsg() */
 
 /*
  * parameters per vrrp sync group. A vrrp_sync_group is a set
@@ -97,8 +99,17 @@ typedef struct _vrrp_sgroup {
 							 * All VRRP must share same tracking conf
 							 */
 
+	/* Member counters, kept in sync by vrrp_set_state/wantstate() */
+	int			nr_members;		/* instances in index_list */
+	int			nr_up;			/* members with VRRP_ISUP() */
+	int			nr_master;		/* members in MASTER state */
+	int			nr_backup;		/* members in BACKUP state */
+	int			nr_fault;		/* members in FAULT state */
+	int			nr_want_master;		/* members wanting GOTO_MASTER/MASTER */
+
 	/* State transition notification */
 	int			notify_exec;
+	int			notify_state;		/* last state notified */
 	char			*script_backup;
 	char			*script_master;
 	char			*script_fault;
@@ -160,6 +171,9 @@ typedef struct _vrrp_t {
 	int			vrid;			/* virtual id. from 1(!) to 255 */
 	int			base_priority;		/* configured priority value */
 	int			effective_priority;	/* effective priority value */
+	int			prio_offset;		/* sum of tracked weights applied to base_priority */
+	int			prio_tracking;		/* prio_offset is live and follows tracked objects */
+	int			sync_up;		/* VRRP_ISUP() as accounted in sync->nr_up */
 	int			vipset;			/* All the vips are set ? */
 	list			vip;			/* list of virtual ip addresses */
 	list			evip;			/* list of protocol excluded VIPs.
@@ -187,6 +201,7 @@ typedef struct _vrrp_t {
 	int			state;			/* internal state (init/backup/master) */
 	int			init_state;		/* the initial state of the instance */
 	int			wantstate;		/* user explicitly wants a state (back/mast) */
+	int			reload_kept;		/* carried over a reload, keeps state & timers */
 	int			fd_in;			/* IN socket descriptor */
 	int			fd_out;			/* OUT socket descriptor */
 
@@ -203,6 +218,7 @@ typedef struct _vrrp_t {
 	/* State transition notification */
 	int			smtp_alert;
 	int			notify_exec;
+	int			notify_state;		/* last state notified */
 	char			*script_backup;
 	char			*script_master;
 	char			*script_fault;
@@ -273,6 +289,11 @@ typedef struct _vrrp_t {
 #define VRRP_TIMER_SKEW(svr)	((svr)->version == VRRP_VERSION_3 ? (((256-(svr)->base_priority) * (svr)->adver_int)/256) : ((256-(svr)->base_priority) * TIMER_HZ/256))
 #define VRRP_VIP_ISSET(V)	((V)->vipset)
 
+/* VIPs of a non accept mode instance get drop rules while MASTER */
+#define VRRP_DROP_VIP(V)	((V)->version == VRRP_VERSION_3 && \
+				 (V)->base_priority != VRRP_PRIO_OWNER && \
+				 !(V)->accept)
+
 #define VRRP_MIN(a, b)	((a) < (b)?(a):(b))
 #define VRRP_MAX(a, b)	((a) > (b)?(a):(b))
 
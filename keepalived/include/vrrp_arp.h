@@ -49,6 +49,8 @@ typedef struct _arphdr {
 	unsigned char		__ar_tip[4];		/* Target IP address.  */
 } arphdr_t;
 
+#define GARP_PKT_LEN		(ETHER_HDR_LEN + sizeof(arphdr_t))
+
 /* Global vars exported */
 extern char *garp_buffer;
 extern int garp_fd;
@@ -56,6 +58,7 @@ extern int garp_fd;
 /* prototypes */
 extern void gratuitous_arp_init(void);
 extern void gratuitous_arp_close(void);
+extern int build_gratuitous_arp(ip_address_t *, char *);
 extern int send_gratuitous_arp(ip_address_t *);
 
 #endif
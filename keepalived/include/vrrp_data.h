@@ -61,6 +61,7 @@ typedef struct _vrrp_data {
 	list			vrrp;
 	list			vrrp_index;
 	list			vrrp_index_fd;
+	list			vrrp_index_name;
 	list			vrrp_socket_pool;
 	list			vrrp_script;
 } vrrp_data_t;
@@ -0,0 +1,53 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        vrrp_garp.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#ifndef _VRRP_GARP_H
+#define _VRRP_GARP_H
+
+/* local includes */
+#include "vrrp_ipaddress.h"
+#include "list.h"
+
+/* local definitions */
+#define GARP_QUEUE_DEFAULT_SIZE	256
+#define GARP_RING_FRAME_SIZE	256	/* tpacket3_hdr + largest prebuilt frame */
+#define GARP_RING_BLOCK_SIZE	4096
+#define GARP_RING_BLOCK_NR	64	/* 1024 frames per interface */
+
+/* Per interface TX ring */
+typedef struct _garp_ring {
+	int			ifindex;	/* Interface the ring is bound to */
+	int			fd;		/* AF_PACKET socket, -1 if unusable */
+	char			*map;		/* mmap()ed ring */
+	size_t			map_len;
+	unsigned int		frame_nr;	/* Number of frame slots */
+	unsigned int		frame_idx;	/* Next slot to fill */
+} garp_ring_t;
+
+/* prototypes */
+extern void vrrp_garp_init(void);
+extern void vrrp_garp_close(void);
+extern void vrrp_garp_queue_add(ip_address_t *);
+extern void vrrp_garp_queue_run(void);
+extern void vrrp_garp_queue_purge(list);
+
+#endif
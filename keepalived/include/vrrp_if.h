@@ -34,6 +34,7 @@
 /* local includes */
 #include "scheduler.h"
 #include "list.h"
+#include "list_head.h"
 
 /* types definition */
 #ifndef SIOCETHTOOL
@@ -93,6 +94,8 @@ typedef struct _interface {
 	int			reset_arp_config;	/* Count of how many vrrps have changed arp parameters on interface */
 	uint32_t		reset_arp_ignore_value;	/* Original value of arp_ignore to be restored */
 	uint32_t		reset_arp_filter_value;	/* Original value of arp_filter to be restored */
+	list			tracking_vrrp;		/* Instances depending on this interface */
+	list_head_t		e_list;			/* Interface queue link */
 } interface_t;
 
 /* Tracked interface structure definition */
@@ -120,13 +123,17 @@ typedef struct _tracked_if {
 extern interface_t *if_get_by_ifindex(const int);
 extern interface_t *base_if_get_by_ifindex(const int);
 extern interface_t *if_get_by_ifname(const char *);
+extern void if_set_flags(interface_t *, const unsigned long);
 extern void if_vmac_reflect_flags(const int, const unsigned long);
 extern int if_linkbeat(const interface_t *);
 extern int if_mii_probe(const char *);
 extern int if_ethtool_probe(const char *);
 extern void if_add_queue(interface_t *);
+extern void if_del_queue(interface_t *);
+extern void if_reset(interface_t *);
 extern int if_monitor_thread(thread_t *);
 extern void init_interface_queue(void);
+extern void reset_interface_tracking(void);
 extern void init_interface_linkbeat(void);
 extern void free_interface_queue(void);
 extern void dump_if(void *);
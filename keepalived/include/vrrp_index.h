@@ -34,6 +34,7 @@
 #include "vrrp.h"
 
 /* Macro definition */
+#define VRRP_INDEX_NAME_SIZE	1024
 
 /* prototypes */
 extern void alloc_vrrp_bucket(vrrp_t *);
@@ -41,5 +42,7 @@ extern void alloc_vrrp_fd_bucket(vrrp_t *);
 extern void remove_vrrp_fd_bucket(vrrp_t *);
 extern void set_vrrp_fd_bucket(int, vrrp_t *);
 extern vrrp_t *vrrp_index_lookup(const int, const int);
+extern void alloc_vrrp_name_bucket(vrrp_t *);
+extern vrrp_t *vrrp_index_name_lookup(const char *);
 
 #endif
@@ -59,8 +59,24 @@ typedef struct _ip_address {
 	bool			iptable_rule_set;	/* TRUE if iptable drop rule
 							 * set to addr
 							 */
+	char			*garp_pkt;		/* Prebuilt GARP/NA frame */
+	int			garp_pkt_len;		/* Prebuilt frame length */
 } ip_address_t;
 
+/* Kernel address cache entry */
+typedef struct _kernel_ipaddr {
+	struct _kernel_ipaddr	*next;
+	int			family;
+	int			ifindex;
+	int			prefixlen;
+	union {
+		struct in_addr	sin_addr;
+		struct in6_addr	sin6_addr;
+	} u;
+} kernel_ipaddr_t;
+
+#define KERNEL_IPADDR_HASH_SIZE	256	/* Must be a power of 2 */
+
 #define IPADDRESS_DEL 0
 #define IPADDRESS_ADD 1
 #define DFLT_INT	"eth0"
@@ -89,6 +105,9 @@ typedef struct _ip_address {
 #define IP_ISEQ(X,Y)    (((X) && (Y)) ? ((IP_FAMILY(X) == IP_FAMILY(Y)) ? (IP_IS6(X) ? IP6_ISEQ(X, Y) : IP4_ISEQ(X, Y)) : 0) : (((!(X) && (Y))||((X) && !(Y))) ? 0 : 1))
 
 /* prototypes */
+extern void kernel_ipaddr_update(int, int, int, void *, int);
+extern void kernel_ipaddr_set_valid(void);
+extern void kernel_ipaddr_flush(void);
 extern void netlink_iplist(list, int);
 extern void handle_iptable_rule_to_iplist(list, int, char *);
 extern void free_ipaddress(void *);
@@ -0,0 +1,43 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        vrrp_ipset.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#ifndef _VRRP_IPSET_H
+#define _VRRP_IPSET_H
+
+/* local includes */
+#include "vrrp_ipaddress.h"
+#include "list.h"
+
+/* local definitions */
+#define IPSET_DEFAULT_NAME	"keepalived"
+#define IPSET_DEFAULT_NAME6	"keepalived6"
+#define IPSET_BATCH_SIZE	(32 * 1024)	/* Bytes of requests per sendmsg() */
+#define IPSET_MSG_MAX		256		/* Largest single request */
+
+/* prototypes */
+extern int vrrp_ipset_active(void);
+extern void vrrp_ipset_init(void);
+extern void vrrp_ipset_close(void);
+extern void vrrp_ipset_iplist(list, int, char *);
+extern void vrrp_ipset_ipaddress(ip_address_t *, int, char *);
+
+#endif
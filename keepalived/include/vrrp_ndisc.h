@@ -82,10 +82,18 @@ struct nd_opt_hdr {
 	__u8			nd_opt_len;
 } __attribute__((__packed__));
 
+/* Unsolicited Neighbour Advertisement frame length */
+#define NDISC_NA_PKT_LEN	(ETHER_HDR_LEN + sizeof(struct ip6hdr) + sizeof(struct ndhdr) + \
+				 sizeof(struct nd_opt_hdr) + ETH_ALEN)
+
+/* Global vars exported */
+extern char *ndisc_buffer;
+extern int ndisc_fd;
 
 /* prototypes */
 extern void ndisc_init(void);
 extern void ndisc_close(void);
+extern int ndisc_build_unsolicited_na(ip_address_t *, char *);
 extern int ndisc_send_unsolicited_na(ip_address_t *);
 
 #endif
@@ -57,6 +57,7 @@ typedef struct _nl_handle {
 
 /* Define types */
 #define NETLINK_TIMER (30 * TIMER_HZ)
+#define NETLINK_BATCH_MAX 256	/* Messages per netlink_talk_batch() sendmsg */
 #ifndef _HAVE_LIBNL3_
 #ifndef _HAVE_LIBNL1_
 #define NLMSG_TAIL(nmsg) ((struct rtattr *) (((void *) (nmsg)) + NLMSG_ALIGN((nmsg)->nlmsg_len)))
@@ -77,6 +78,7 @@ extern int netlink_scope_a2n(char *);
 extern int netlink_socket(nl_handle_t *, int, int, ...);
 extern int netlink_close(nl_handle_t *);
 extern int netlink_talk(nl_handle_t *, struct nlmsghdr *);
+extern int netlink_talk_batch(nl_handle_t *, struct nlmsghdr **, int, int *);
 extern int netlink_interface_lookup(void);
 extern int netlink_interface_refresh(void);
 extern void kernel_netlink_init(void);
@@ -27,6 +27,12 @@
 /* local include */
 #include "vrrp.h"
 
+/* local definitions */
+#define VRRP_NOTIFY_SINK_BUFSIZE	512
+
+/* prototypes */
+extern void vrrp_notify_sink_init(void);
+extern void vrrp_notify_sink_close(void);
 extern int notify_instance_exec(vrrp_t *, int);
 extern int notify_group_exec(vrrp_sgroup_t *, int);
 
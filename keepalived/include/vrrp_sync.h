@@ -44,6 +44,10 @@
 extern void vrrp_init_instance_sands(vrrp_t *);
 extern void vrrp_sync_smtp_notifier(vrrp_sgroup_t *);
 extern void vrrp_sync_set_group(vrrp_sgroup_t *);
+extern void vrrp_set_state(vrrp_t *, int);
+extern void vrrp_set_wantstate(vrrp_t *, int);
+extern void vrrp_sync_update_up(vrrp_t *);
+extern void vrrp_sync_init_group(vrrp_sgroup_t *);
 extern int vrrp_sync_group_up(vrrp_sgroup_t *);
 extern int vrrp_sync_leave_fault(vrrp_t *);
 extern int vrrp_sync_goto_master(vrrp_t *);
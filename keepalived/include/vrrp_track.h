@@ -27,12 +27,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
+#include <sys/socket.h>
 #include <string.h>
 #include <syslog.h>
 
 /* local includes */
 #include "vector.h"
 #include "list.h"
+#include "vrrp_if.h"
 
 /* Macro definition */
 #define TRACK_ISUP(L)	(vrrp_tracked_up((L)))
@@ -54,10 +56,34 @@
 #define VRRP_SCRIPT_STATUS_INIT_GOOD -2
 #define VRRP_SCRIPT_STATUS_INIT      -1
 
+/* Outcome of a single script run */
+#define VRRP_SCRIPT_RUN_SUCCESS	0
+#define VRRP_SCRIPT_RUN_FAILURE	1
+#define VRRP_SCRIPT_RUN_TIMEOUT	2
+
+/* Script types. Everything but EXEC is evaluated in process */
+#define VRRP_SCRIPT_TYPE_EXEC		0	/* external command */
+#define VRRP_SCRIPT_TYPE_PROCESS	1	/* process running, by name */
+#define VRRP_SCRIPT_TYPE_PIDFILE	2	/* process running, by pid file */
+#define VRRP_SCRIPT_TYPE_FILE		3	/* file exists */
+#define VRRP_SCRIPT_TYPE_NOFILE		4	/* file doesn't exist */
+#define VRRP_SCRIPT_TYPE_MTIME		5	/* file modified recently */
+#define VRRP_SCRIPT_TYPE_TCP		6	/* TCP connect */
+#define VRRP_SCRIPT_TYPE_UDP		7	/* UDP port not unreachable */
+#define VRRP_SCRIPT_TYPE_HTTP		8	/* HTTP GET status */
+
 /* external script we call to track local processes */
 typedef struct _vrrp_script {
 	char			*sname;		/* instance name */
 	char			*script;	/* the command to be called */
+	int			type;		/* VRRP_SCRIPT_TYPE_* */
+	char			*path;		/* process name, pid file, file or URL path */
+	long			max_age;	/* file_mtime: max age in seconds */
+	struct sockaddr_storage	addr;		/* connect/HTTP target */
+	int			http_status;	/* expected HTTP status, 0 for any 2xx */
+	int			fd;		/* in progress connect/HTTP check, -1 if none */
+	char			resp[16];	/* HTTP status line received so far */
+	int			resp_len;
 	long			interval;	/* interval between script calls */
 	long			timeout;	/* seconds before script timeout */
 	int			weight;		/* weight associated to this script */
@@ -65,6 +91,7 @@ typedef struct _vrrp_script {
 	int			inuse;		/* how many users have weight>0 ? */
 	int			rise;		/* R: how many successes before OK */
 	int			fall;		/* F: how many failures before KO */
+	list			tracking_vrrp;	/* instances depending on this script */
 } vrrp_script_t;
 
 /* Tracked script structure definition */
@@ -73,6 +100,12 @@ typedef struct _tracked_sc {
 	vrrp_script_t		*scr;		/* script pointer, cannot be NULL */
 } tracked_sc_t;
 
+/* Reverse link from a tracked interface or script to a weighted user */
+typedef struct _tracking_vrrp {
+	int			weight;		/* tracking weight, 0 for sync health only */
+	struct _vrrp_t		*vrrp;		/* instance to update */
+} tracking_vrrp_t;
+
 /* prototypes */
 extern void dump_track(void *);
 extern void alloc_track(list, vector_t *);
@@ -83,6 +116,10 @@ extern void vrrp_log_tracked_down(list);
 extern int vrrp_tracked_weight(list);
 extern int vrrp_script_up(list);
 extern int vrrp_script_weight(list);
+extern void vrrp_script_result(vrrp_script_t *, int);
 extern vrrp_script_t *find_script_by_name(char *);
+extern void vrrp_track_link(struct _vrrp_t *);
+extern void vrrp_track_if_changed(interface_t *, int);
+extern void vrrp_set_effective_priority(struct _vrrp_t *);
 
 #endif
@@ -0,0 +1,40 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        vrrp_track_native.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+
+#ifndef _VRRP_TRACK_NATIVE_H
+#define _VRRP_TRACK_NATIVE_H
+
+/* local includes */
+#include "vrrp_track.h"
+#include "scheduler.h"
+#include "vector.h"
+
+/* local definitions */
+#define VRRP_NATIVE_UDP_WAIT	(TIMER_HZ / 10)	/* Wait for port unreachable */
+#define VRRP_NATIVE_COMM_LEN	15		/* TASK_COMM_LEN - 1 */
+
+/* prototypes */
+extern void vrrp_native_parse(vrrp_script_t *, int, vector_t *);
+extern int vrrp_native_check(thread_master_t *, vrrp_script_t *);
+
+#endif
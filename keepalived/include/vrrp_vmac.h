@@ -30,6 +30,8 @@
 #include <string.h>
 #include <syslog.h>
 #include <net/ethernet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
 /* local includes */
 #include "vrrp.h"
@@ -42,8 +44,23 @@ enum vrrp_vmac_bits {
 	VRRP_VMAC_XMITBASE_BIT = 2,
 };
 
+/* VMAC netlink request */
+typedef struct _vmac_req {
+	struct nlmsghdr		n;
+	struct ifinfomsg	ifi;
+	char			buf[256];
+} vmac_req_t;
+
+/* VMAC interface waiting for batched creation */
+typedef struct _vmac_pending {
+	vrrp_t			*vrrp;
+	interface_t		*base_ifp;	/* Interface the VMAC sits on */
+	vmac_req_t		req;		/* RTM_NEWLINK creation request */
+} vmac_pending_t;
+
 /* prototypes */
 extern int netlink_link_add_vmac(vrrp_t *);
+extern void netlink_link_vmac_commit(void);
 extern int netlink_link_del_vmac(vrrp_t *);
 
 #endif
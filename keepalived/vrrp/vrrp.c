@@ -28,6 +28,7 @@
 #include <sys/uio.h>
 #include "vrrp_arp.h"
 #include "vrrp_ndisc.h"
+#include "vrrp_garp.h"
 #include "vrrp_scheduler.h"
 #include "vrrp_notify.h"
 #include "ipvswrapper.h"
@@ -87,9 +88,7 @@ vrrp_handle_iprules(vrrp_t * vrrp, int cmd)
 static void
 vrrp_handle_accept_mode(vrrp_t *vrrp, int cmd)
 {
-	if ((vrrp->version == VRRP_VERSION_3) &&
-	    (vrrp->base_priority != VRRP_PRIO_OWNER) &&
-	    !vrrp->accept) {
+	if (VRRP_DROP_VIP(vrrp)) {
 		if (debug & 32)
 			log_message(LOG_INFO, "VRRP_Instance(%s) %s protocol %s", vrrp->iname,
 				(cmd == IPADDRESS_ADD) ? "setting" : "removing", " iptable drop rule to VIP");
@@ -977,24 +976,24 @@ vrrp_check_packet(vrrp_t * vrrp, char *buf, int buflen)
 	return VRRP_PACKET_NULL;
 }
 
-/* Gratuitous ARP on each VIP */
+/* Queue gratuitous ARP on each VIP */
 static void
 vrrp_send_update(vrrp_t * vrrp, ip_address_t * ipaddress, int idx)
 {
 	char *msg;
 	char addr_str[41];
 
-	if (!IP_IS6(ipaddress)) {
-		msg = "gratuitous ARPs";
-		inet_ntop(AF_INET, &ipaddress->u.sin.sin_addr, addr_str, sizeof(addr_str));
-		send_gratuitous_arp(ipaddress);
-	} else {
-		msg = "Unsolicited Neighbour Adverts";
-		inet_ntop(AF_INET6, &ipaddress->u.sin6_addr, addr_str, sizeof(addr_str));
-		ndisc_send_unsolicited_na(ipaddress);
-	}
+	vrrp_garp_queue_add(ipaddress);
 
 	if (idx == 0 && __test_bit(LOG_DETAIL_BIT, &debug)) {
+		if (!IP_IS6(ipaddress)) {
+			msg = "gratuitous ARPs";
+			inet_ntop(AF_INET, &ipaddress->u.sin.sin_addr, addr_str, sizeof(addr_str));
+		} else {
+			msg = "Unsolicited Neighbour Adverts";
+			inet_ntop(AF_INET6, &ipaddress->u.sin6_addr, addr_str, sizeof(addr_str));
+		}
+
 		log_message(LOG_INFO, "VRRP_Instance(%s) Sending %s on %s for %s",
 			    vrrp->iname, msg, IF_NAME(ipaddress->ifp), addr_str);
 	}
@@ -1027,6 +1026,9 @@ vrrp_send_link_update(vrrp_t * vrrp, int rep)
 			}
 		}
 	}
+
+	/* Batched and optionally paced by the burst engine */
+	vrrp_garp_queue_run();
 }
 
 /* becoming master */
@@ -1102,8 +1104,8 @@ vrrp_state_goto_master(vrrp_t * vrrp)
 
 	vrrp_send_adv(vrrp, vrrp->effective_priority);
 
-	vrrp->state = VRRP_STATE_MAST;
-	log_message(LOG_INFO, "VRRP_Instance(%s) Transition to MASTER STATE"
+	vrrp_set_state(vrrp, VRRP_STATE_MAST);
+	log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Transition to MASTER STATE"
 			    , vrrp->iname);
 }
 
@@ -1127,6 +1129,10 @@ vrrp_restore_interface(vrrp_t * vrrp, int advF)
 	if (!LIST_ISEMPTY(vrrp->vrules))
 		vrrp_handle_iprules(vrrp, IPRULE_DEL);
 
+	/* Stop advertising addresses we are about to release */
+	vrrp_garp_queue_purge(vrrp->vip);
+	vrrp_garp_queue_purge(vrrp->evip);
+
 	/*
 	 * Remove the ip addresses.
 	 *
@@ -1166,18 +1172,18 @@ vrrp_state_leave_master(vrrp_t * vrrp)
 	/* set the new vrrp state */
 	switch (vrrp->wantstate) {
 	case VRRP_STATE_BACK:
-		log_message(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE", vrrp->iname);
+		log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE", vrrp->iname);
 		vrrp_restore_interface(vrrp, 0);
-		vrrp->state = vrrp->wantstate;
+		vrrp_set_state(vrrp, vrrp->wantstate);
 		notify_instance_exec(vrrp, VRRP_STATE_BACK);
 #ifdef _WITH_SNMP_
 		vrrp_snmp_instance_trap(vrrp);
 #endif
 		break;
 	case VRRP_STATE_GOTO_FAULT:
-		log_message(LOG_INFO, "VRRP_Instance(%s) Entering FAULT STATE", vrrp->iname);
+		log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Entering FAULT STATE", vrrp->iname);
 		vrrp_restore_interface(vrrp, 0);
-		vrrp->state = VRRP_STATE_FAULT;
+		vrrp_set_state(vrrp, VRRP_STATE_FAULT);
 		notify_instance_exec(vrrp, VRRP_STATE_FAULT);
 		vrrp_send_adv(vrrp, VRRP_PRIO_STOP);
 #ifdef _WITH_SNMP_
@@ -1254,7 +1260,7 @@ vrrp_state_backup(vrrp_t * vrrp, char *buf, int buflen)
 	} else if (hd->priority < vrrp->effective_priority) {
 		log_message(LOG_INFO, "VRRP_Instance(%s) forcing a new MASTER election"
 				    , vrrp->iname);
-		vrrp->wantstate = VRRP_STATE_GOTO_MASTER;
+		vrrp_set_wantstate(vrrp, VRRP_STATE_GOTO_MASTER);
 		vrrp_send_adv(vrrp, vrrp->effective_priority);
 	}
 }
@@ -1266,7 +1272,7 @@ vrrp_state_master_tx(vrrp_t * vrrp, const int prio)
 	int ret = 0;
 
 	if (!VRRP_VIP_ISSET(vrrp)) {
-		log_message(LOG_INFO, "VRRP_Instance(%s) Entering MASTER STATE"
+		log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Entering MASTER STATE"
 				    , vrrp->iname);
 		vrrp_state_become_master(vrrp);
 		ret = 1;
@@ -1317,7 +1323,7 @@ vrrp_state_master_rx(vrrp_t * vrrp, char *buf, int buflen)
 	/* return on link failure */
 	if (vrrp->wantstate == VRRP_STATE_GOTO_FAULT) {
 		vrrp->ms_down_timer = 3 * vrrp->adver_int + VRRP_TIMER_SKEW(vrrp);
-		vrrp->state = VRRP_STATE_FAULT;
+		vrrp_set_state(vrrp, VRRP_STATE_FAULT);
 		notify_instance_exec(vrrp, VRRP_STATE_FAULT);
 		vrrp->last_transition = timer_now();
 		return 1;
@@ -1372,8 +1378,8 @@ vrrp_state_master_rx(vrrp_t * vrrp, char *buf, int buflen)
 
 		vrrp->ms_down_timer = 3 * vrrp->adver_int + VRRP_TIMER_SKEW(vrrp);
 		vrrp->master_priority = hd->priority;
-		vrrp->wantstate = VRRP_STATE_BACK;
-		vrrp->state = VRRP_STATE_BACK;
+		vrrp_set_wantstate(vrrp, VRRP_STATE_BACK);
+		vrrp_set_state(vrrp, VRRP_STATE_BACK);
 		return 1;
 	}
 
@@ -1616,7 +1622,8 @@ vrrp_complete_instance(vrrp_t * vrrp)
 	vrrp->state = VRRP_STATE_INIT;
 	if (!vrrp->adver_int)
 		vrrp->adver_int = VRRP_ADVER_DFL * TIMER_HZ;
-	vrrp->master_adver_int = vrrp->adver_int;
+	if (!vrrp->reload_kept)
+		vrrp->master_adver_int = vrrp->adver_int;
 	if (!vrrp->effective_priority)
 		vrrp->effective_priority = VRRP_PRIO_DFL;
 
@@ -1675,20 +1682,7 @@ vrrp_ipvs_needed(void)
 static vrrp_t *
 vrrp_exist(vrrp_t * old_vrrp)
 {
-	element e;
-	list l = vrrp_data->vrrp;
-	vrrp_t *vrrp;
-
-	if (LIST_ISEMPTY(l))
-		return NULL;
-
-	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
-		vrrp = ELEMENT_DATA(e);
-		if (!strcmp(vrrp->iname, old_vrrp->iname))
-			return vrrp;
-	}
-
-	return NULL;
+	return vrrp_index_name_lookup(old_vrrp->iname);
 }
 
 /* Clear VIP|EVIP not present into the new data */
@@ -1727,6 +1721,65 @@ clear_diff_vrrp_vrules(vrrp_t * old_vrrp)
 	clear_diff_rules(old_vrrp->vrules, vrrp->vrules);
 }
 
+/* Try to find a sync group into the new data */
+static vrrp_sgroup_t *
+vrrp_sgroup_exist(vrrp_sgroup_t * old_vgroup)
+{
+	element e;
+	list l = vrrp_data->vrrp_sync_group;
+	vrrp_sgroup_t *vgroup;
+
+	if (LIST_ISEMPTY(l))
+		return NULL;
+
+	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+		vgroup = ELEMENT_DATA(e);
+		if (!strcmp(vgroup->gname, old_vgroup->gname))
+			return vgroup;
+	}
+
+	return NULL;
+}
+
+/* An instance in a stable state carries on across the reload as if
+ * nothing happened: same state, same advert schedule, no transition
+ * and no notification. Others are restarted from their old state.
+ */
+static void
+keep_vrrp_state(vrrp_t * vrrp, vrrp_t * old_vrrp)
+{
+	vrrp_sgroup_t *vgroup;
+
+	if (old_vrrp->state != VRRP_STATE_BACK &&
+	    old_vrrp->state != VRRP_STATE_MAST &&
+	    old_vrrp->state != VRRP_STATE_FAULT)
+		return;
+
+	/* Protocol identity must be unchanged */
+	if (vrrp->vrid != old_vrrp->vrid || vrrp->ifp != old_vrrp->ifp ||
+	    vrrp->family != old_vrrp->family || vrrp->version != old_vrrp->version ||
+	    vrrp->auth_type != old_vrrp->auth_type ||
+	    LIST_ISEMPTY(vrrp->unicast_peer) != LIST_ISEMPTY(old_vrrp->unicast_peer) ||
+	    vrrp->vmac_flags != old_vrrp->vmac_flags)
+		return;
+
+	vrrp->reload_kept = 1;
+	vrrp->wantstate = old_vrrp->wantstate;
+	vrrp->sands = old_vrrp->sands;
+	vrrp->ms_down_timer = old_vrrp->ms_down_timer;
+	vrrp->master_adver_int = old_vrrp->master_adver_int;
+	vrrp->master_priority = old_vrrp->master_priority;
+	vrrp->master_saddr = old_vrrp->master_saddr;
+	vrrp->last_transition = old_vrrp->last_transition;
+	vrrp->garp_refresh_timer = old_vrrp->garp_refresh_timer;
+	vrrp->notify_state = old_vrrp->notify_state;
+
+	if (old_vrrp->sync && (vgroup = vrrp_sgroup_exist(old_vrrp->sync))) {
+		vgroup->state = old_vrrp->sync->state;
+		vgroup->notify_state = old_vrrp->sync->notify_state;
+	}
+}
+
 /* Keep the state from before reload */
 static void
 reset_vrrp_state(vrrp_t * old_vrrp)
@@ -1738,6 +1791,7 @@ reset_vrrp_state(vrrp_t * old_vrrp)
 	vrrp->wantstate = old_vrrp->state;
 	if (!old_vrrp->sync)
 		vrrp->effective_priority = old_vrrp->effective_priority;
+	keep_vrrp_state(vrrp, old_vrrp);
 	/* Save old stats */
 	memcpy(vrrp->stats, old_vrrp->stats, sizeof(vrrp_stats));
 
@@ -48,7 +48,7 @@ static int send_arp(ip_address_t *ipaddress)
 	sll.sll_ifindex = IF_INDEX(ipaddress->ifp);
 
 	/* Send packet */
-	len = sendto(garp_fd, garp_buffer, sizeof(arphdr_t) + ETHER_HDR_LEN
+	len = sendto(garp_fd, garp_buffer, GARP_PKT_LEN
 		     , 0, (struct sockaddr *)&sll, sizeof(sll));
 	if (len < 0)
 		log_message(LOG_INFO, "Error sending gratuitous ARP on %s for %s",
@@ -57,12 +57,11 @@ static int send_arp(ip_address_t *ipaddress)
 }
 
 /* Build a gratuitous ARP message over a specific interface */
-int send_gratuitous_arp(ip_address_t *ipaddress)
+int build_gratuitous_arp(ip_address_t *ipaddress, char *buffer)
 {
-	struct ether_header *eth = (struct ether_header *) garp_buffer;
-	arphdr_t *arph		 = (arphdr_t *) (garp_buffer + ETHER_HDR_LEN);
+	struct ether_header *eth = (struct ether_header *) buffer;
+	arphdr_t *arph		 = (arphdr_t *) (buffer + ETHER_HDR_LEN);
 	char *hwaddr		 = (char *) IF_HWADDR(ipaddress->ifp);
-	int len;
 
 	/* Ethernet header */
 	memset(eth->ether_dhost, 0xFF, ETH_ALEN);
@@ -80,11 +79,21 @@ int send_gratuitous_arp(ip_address_t *ipaddress)
 	memset(arph->__ar_tha, 0xFF, ETH_ALEN);
 	memcpy(arph->__ar_tip, &ipaddress->u.sin.sin_addr.s_addr, sizeof(struct in_addr));
 
+	return GARP_PKT_LEN;
+}
+
+/* Build and send a gratuitous ARP message over a specific interface */
+int send_gratuitous_arp(ip_address_t *ipaddress)
+{
+	int len;
+
+	build_gratuitous_arp(ipaddress, garp_buffer);
+
 	/* Send the ARP message */
 	len = send_arp(ipaddress);
 
 	/* Cleanup room for next round */
-	memset(garp_buffer, 0, sizeof(arphdr_t) + ETHER_HDR_LEN);
+	memset(garp_buffer, 0, GARP_PKT_LEN);
 	return len;
 }
 
@@ -95,7 +104,7 @@ int send_gratuitous_arp(ip_address_t *ipaddress)
 void gratuitous_arp_init(void)
 {
 	/* Initalize shared buffer */
-	garp_buffer = (char *)MALLOC(sizeof(arphdr_t) + ETHER_HDR_LEN);
+	garp_buffer = (char *)MALLOC(GARP_PKT_LEN);
 
 	/* Create the socket descriptor */
 	garp_fd = socket(PF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(ETH_P_RARP));
@@ -25,7 +25,11 @@
 #include "vrrp_if.h"
 #include "vrrp_arp.h"
 #include "vrrp_ndisc.h"
+#include "vrrp_garp.h"
+#include "vrrp_ipset.h"
 #include "vrrp_netlink.h"
+#include "vrrp_vmac.h"
+#include "vrrp_notify.h"
 #include "vrrp_ipaddress.h"
 #include "vrrp_iproute.h"
 #include "vrrp_iprule.h"
@@ -34,10 +38,12 @@
 #include "vrrp.h"
 #include "vrrp_print.h"
 #include "global_data.h"
+#include "journal.h"
 #include "pidfile.h"
 #include "daemon.h"
 #include "logger.h"
 #include "signals.h"
+#include "notify.h"
 #include "bitops.h"
 #ifdef _WITH_LVS_
   #include "ipvswrapper.h"
@@ -98,9 +104,14 @@ stop_vrrp(void)
 	free_vrrp_buffer();
 	free_interface_queue();
 	kernel_netlink_close();
+	vrrp_garp_close();
 	thread_destroy_master(master);
 	gratuitous_arp_close();
 	ndisc_close();
+	vrrp_ipset_close();
+	vrrp_notify_sink_close();
+	journal_close();
+	script_helper_close();
 
 	signal_handler_destroy();
 
@@ -112,6 +123,7 @@ stop_vrrp(void)
 	 * Reached when terminate signal catched.
 	 * finally return to parent process.
 	 */
+	log_helper_close();
 	closelog();
 	exit(0);
 }
@@ -120,11 +132,21 @@ stop_vrrp(void)
 static void
 start_vrrp(void)
 {
-	/* Initialize sub-system */
-	init_interface_queue();
-	kernel_netlink_init();
+	timeval_t start = timer_now();
+	unsigned long mem_base = mem_in_use();
+
+	/* Initialize sub-system. The script helper, interface queue and
+	 * netlink channels are kept running across a reload */
+	if (!reload) {
+		/* Spawn scripts from a small helper rather than forking ourself */
+		script_helper_init(master);
+		init_interface_queue();
+		kernel_netlink_init();
+	} else
+		reset_interface_tracking();
 	gratuitous_arp_init();
 	ndisc_init();
+	vrrp_garp_init();
 #ifdef _WITH_SNMP_
 	if (!reload && snmp)
 		vrrp_snmp_agent_init(snmp_socket);
@@ -139,7 +161,20 @@ start_vrrp(void)
 		stop_vrrp();
 		return;
 	}
+
+	/* Create VMAC interfaces requested by the configuration */
+	netlink_link_vmac_commit();
 	init_global_data(global_data);
+	log_rate_set(global_data->log_rate_burst, global_data->log_rate_interval);
+
+	/* Binary event journal, if configured */
+	journal_open(global_data->event_journal, global_data->event_journal_size);
+
+	/* Accept mode drop rules through ipset, if configured */
+	vrrp_ipset_init();
+
+	/* Transition events FIFO/socket, if configured */
+	vrrp_notify_sink_init();
 
 #ifdef _WITH_LVS_
 	if (vrrp_ipvs_needed()) {
@@ -168,7 +203,10 @@ start_vrrp(void)
 	}
 
 	/* Post initializations */
-	log_message(LOG_INFO, "Configuration is using : %lu Bytes", mem_allocated);
+	log_message(LOG_INFO, "Configuration is using : %lu Bytes"
+			    , (mem_in_use() > mem_base) ? mem_in_use() - mem_base : 0);
+	log_message(LOG_INFO, "VRRP instances ready in %ld ms"
+			    , timer_long(timer_sub(timer_now(), start)) / 1000);
 
 	/* Set static entries */
 	netlink_iplist(vrrp_data->static_addresses, IPADDRESS_ADD);
@@ -184,9 +222,13 @@ start_vrrp(void)
 	/* Initialize linkbeat */
 	init_interface_linkbeat();
 
-	/* Init & start the VRRP packet dispatcher */
-	thread_add_event(master, vrrp_dispatcher_init, NULL,
-			 VRRP_DISPATCHER);
+	/* Init & start the VRRP packet dispatcher. On reload, take over
+	 * the running one right away */
+	if (reload)
+		vrrp_dispatcher_init(NULL);
+	else
+		thread_add_event(master, vrrp_dispatcher_init, NULL,
+				 VRRP_DISPATCHER);
 }
 
 /* Reload handler */
@@ -235,26 +277,64 @@ vrrp_signal_init(void)
 	signal_ignore(SIGPIPE);
 }
 
-/* Reload thread */
+/* Send an advert for every instance we are master of */
+static void
+vrrp_send_master_adverts(void)
+{
+	vrrp_t *vrrp;
+	element e;
+
+	if (LIST_ISEMPTY(vrrp_data->vrrp))
+		return;
+
+	for (e = LIST_HEAD(vrrp_data->vrrp); e; ELEMENT_NEXT(e)) {
+		vrrp = ELEMENT_DATA(e);
+		if (vrrp->state == VRRP_STATE_MAST)
+			vrrp_send_adv(vrrp, vrrp->effective_priority);
+	}
+}
+
+/* Drop pending threads referring to the previous configuration */
+static void
+vrrp_cancel_data_threads(vrrp_data_t *data)
+{
+	element e;
+
+	if (!LIST_ISEMPTY(data->vrrp)) {
+		for (e = LIST_HEAD(data->vrrp); e; ELEMENT_NEXT(e))
+			thread_cancel_arg(master, ELEMENT_DATA(e));
+	}
+
+	if (!LIST_ISEMPTY(data->vrrp_script)) {
+		for (e = LIST_HEAD(data->vrrp_script); e; ELEMENT_NEXT(e))
+			thread_cancel_arg(master, ELEMENT_DATA(e));
+	}
+}
+
+/* Reload thread.
+ * The scheduler, netlink channels, interface queue and VRRP sockets are
+ * kept. The new configuration is diffed against the running one and
+ * instances present in both carry on with their state and advert timers.
+ */
 int
 reload_vrrp_thread(thread_t * thread)
 {
+	unsigned long mem;
+
 	/* set the reloading flag */
 	SET_RELOAD;
 
-	/* Signal handling */
-	signal_handler_reset();
+	/* Refresh peers first so that parsing a large configuration
+	 * can't get us past an advert deadline */
+	vrrp_send_master_adverts();
 
-	/* Destroy master thread */
-	vrrp_dispatcher_release(vrrp_data);
-	kernel_netlink_close();
-	thread_destroy_master(master);
-	master = thread_make_master();
+	/* Release configuration dependent parts */
 	free_global_data(global_data);
-	free_interface_queue();
 	free_vrrp_buffer();
 	gratuitous_arp_close();
 	ndisc_close();
+	vrrp_garp_close();
+	vrrp_notify_sink_close();
 
 #ifdef _WITH_LVS_
 	if (vrrp_ipvs_needed()) {
@@ -268,13 +348,17 @@ reload_vrrp_thread(thread_t * thread)
 	vrrp_data = NULL;
 
 	/* Reload the conf */
-	mem_allocated = 0;
-	vrrp_signal_init();
-	signal_set(SIGCHLD, thread_child_handler, master);
 	start_vrrp();
 
 	/* free backup data */
+	mem = mem_in_use();
+	vrrp_cancel_data_threads(old_vrrp_data);
+	vrrp_dispatcher_release(old_vrrp_data);
 	free_vrrp_data(old_vrrp_data);
+	old_vrrp_data = NULL;
+	log_message(LOG_INFO, "Previous configuration released : %lu Bytes"
+			    , (mem > mem_in_use()) ? mem - mem_in_use() : 0);
+	mem_release();
 	UNSET_RELOAD;
 
 	return 0;
@@ -291,6 +375,8 @@ int
 print_vrrp_stats(thread_t * thread)
 {
 	vrrp_print_stats();
+	dump_mem_stats();
+	dump_log_stats();
 	return 0;
 }
 
@@ -328,6 +414,7 @@ start_vrrp_child(void)
 {
 #ifndef _DEBUG_
 	pid_t pid;
+	int facility;
 	int ret;
 
 	/* Initialize child process */
@@ -351,8 +438,10 @@ start_vrrp_child(void)
 	signal_handler_destroy();
 
 	/* Opening local VRRP syslog channel */
+	facility = (log_facility==LOG_DAEMON) ? LOG_LOCAL1 : log_facility;
 	openlog(PROG_VRRP, LOG_PID | ((__test_bit(LOG_CONSOLE_BIT, &debug)) ? LOG_CONS : 0)
-			 , (log_facility==LOG_DAEMON) ? LOG_LOCAL1 : log_facility);
+			 , facility);
+	log_helper_init(PROG_VRRP, facility);
 
 	/* Child process part, write pidfile */
 	if (!pidfile_write(vrrp_pidfile, getpid())) {
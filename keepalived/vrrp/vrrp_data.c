@@ -28,6 +28,7 @@
 #include "vrrp_vmac.h"
 #include "vrrp.h"
 #include "memory.h"
+#include "parser.h"
 #include "utils.h"
 #include "logger.h"
 #include "bitops.h"
@@ -92,6 +93,10 @@ dump_vgroup(void *data)
 		str = vector_slot(vgroup->iname, i);
 		log_message(LOG_INFO, "   monitor = %s", str);
 	}
+	log_message(LOG_INFO, "   Members = %d, up = %d, master = %d, backup = %d,"
+			      " fault = %d, want master = %d",
+		    vgroup->nr_members, vgroup->nr_up, vgroup->nr_master,
+		    vgroup->nr_backup, vgroup->nr_fault, vgroup->nr_want_master);
 	if (vgroup->global_tracking)
 		log_message(LOG_INFO, "   Same tracking for all VRRP instances");
 	if (vgroup->script_backup)
@@ -117,6 +122,10 @@ free_vscript(void *data)
 
 	FREE(vscript->sname);
 	FREE_PTR(vscript->script);
+	FREE_PTR(vscript->path);
+	if (vscript->fd >= 0)
+		close(vscript->fd);
+	free_list(vscript->tracking_vrrp);
 	FREE(vscript);
 }
 static void
@@ -373,6 +382,7 @@ alloc_vrrp(char *iname)
 	new->garp_delay = global_data->vrrp_garp_delay;
 
 	list_add(vrrp_data->vrrp, new);
+	alloc_vrrp_name_bucket(new);
 }
 
 vrrp_stats *
@@ -509,6 +519,8 @@ alloc_vrrp_script(char *sname)
 	new->inuse = 0;
 	new->rise = 1;
 	new->fall = 1;
+	new->type = VRRP_SCRIPT_TYPE_EXEC;
+	new->fd = -1;
 	list_add(vrrp_data->vrrp_script, new);
 }
 
@@ -534,6 +546,7 @@ alloc_vrrp_data(void)
 	new->vrrp = alloc_list(free_vrrp, dump_vrrp);
 	new->vrrp_index = alloc_mlist(NULL, NULL, 255+1);
 	new->vrrp_index_fd = alloc_mlist(NULL, NULL, 1024+1);
+	new->vrrp_index_name = alloc_mlist(NULL, NULL, VRRP_INDEX_NAME_SIZE);
 	new->vrrp_sync_group = alloc_list(free_vgroup, dump_vgroup);
 	new->vrrp_script = alloc_list(free_vscript, dump_vscript);
 	new->vrrp_socket_pool = alloc_list(free_sock, dump_sock);
@@ -549,6 +562,7 @@ free_vrrp_data(vrrp_data_t * data)
 	free_list(data->static_rules);
 	free_mlist(data->vrrp_index, 255+1);
 	free_mlist(data->vrrp_index_fd, 1024+1);
+	free_mlist(data->vrrp_index_name, VRRP_INDEX_NAME_SIZE);
 	free_list(data->vrrp);
 	free_list(data->vrrp_sync_group);
 	free_list(data->vrrp_script);
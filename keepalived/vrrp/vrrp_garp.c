@@ -0,0 +1,482 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Gratuitous ARP / unsolicited Neighbour Advert burst engine.
+ *              Frames are prebuilt per VIP, queued, and flushed to the
+ *              wire with sendmmsg(), optionally paced by the scheduler.
+ *              When enabled, frames are instead written into a per
+ *              interface PACKET_TX_RING and kicked with a single send().
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+/* sendmmsg() is a GNU extension */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* system includes */
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <linux/if_packet.h>
+
+/* local includes */
+#include "vrrp_garp.h"
+#include "vrrp_arp.h"
+#include "vrrp_ndisc.h"
+#include "vrrp.h"
+#include "global_data.h"
+#include "scheduler.h"
+#include "logger.h"
+#include "memory.h"
+#include "utils.h"
+#include "bitops.h"
+#include "main.h"
+
+/* Largest frame we ever prebuild */
+#define GARP_FRAME_LEN	((GARP_PKT_LEN > NDISC_NA_PKT_LEN) ? GARP_PKT_LEN : NDISC_NA_PKT_LEN)
+
+/* Pending frame queue. Entries are VIPs whose frame is to be sent,
+ * one entry per frame (a VIP appears rep times for a rep burst).
+ */
+static ip_address_t **garp_queue;
+static unsigned int garp_queue_size;
+static unsigned int garp_queue_head;
+static unsigned int garp_queue_tail;
+static int garp_pacer_running;
+static thread_t *garp_pacer;		/* Pending pacer timer, if any */
+
+/* Per interface TX rings */
+static list garp_rings;
+
+static int garp_pacer_thread(thread_t *);
+
+/*
+ *	Per interface PACKET_TX_RING (TPACKET_V3) channel.
+ */
+static void
+free_garp_ring(void *data)
+{
+	garp_ring_t *ring = data;
+
+	if (ring->map)
+		munmap(ring->map, ring->map_len);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	FREE(ring);
+}
+
+static void
+dump_garp_ring(void *data)
+{
+	garp_ring_t *ring = data;
+
+	log_message(LOG_INFO, "GARP tx ring: [ifindex(%d), fd(%d), frames(%d)]"
+			    , ring->ifindex, ring->fd, ring->frame_nr);
+}
+
+/* Open, map and bind a TX ring on ifindex. On any failure fd is
+ * left at -1 so the shared channels keep being used.
+ */
+static garp_ring_t *
+alloc_garp_ring(int ifindex)
+{
+	garp_ring_t *ring;
+	struct tpacket_req3 req;
+	struct sockaddr_ll sll;
+	int val;
+
+	ring = (garp_ring_t *) MALLOC(sizeof(garp_ring_t));
+	ring->ifindex = ifindex;
+	list_add(garp_rings, ring);
+
+	ring->fd = socket(PF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+	if (ring->fd < 0)
+		goto err;
+
+	val = TPACKET_V3;
+	if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &val, sizeof(val)) < 0)
+		goto err;
+
+	/* Frames bypass the qdisc layer, like a failover burst wants */
+	val = 1;
+	setsockopt(ring->fd, SOL_PACKET, PACKET_QDISC_BYPASS, &val, sizeof(val));
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = GARP_RING_BLOCK_SIZE;
+	req.tp_block_nr = GARP_RING_BLOCK_NR;
+	req.tp_frame_size = GARP_RING_FRAME_SIZE;
+	req.tp_frame_nr = (GARP_RING_BLOCK_SIZE / GARP_RING_FRAME_SIZE) * GARP_RING_BLOCK_NR;
+	if (setsockopt(ring->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0)
+		goto err;
+
+	ring->map_len = req.tp_block_size * req.tp_block_nr;
+	ring->map = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+	if (ring->map == MAP_FAILED) {
+		ring->map = NULL;
+		goto err;
+	}
+	ring->frame_nr = req.tp_frame_nr;
+
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_ifindex = ifindex;
+	if (bind(ring->fd, (struct sockaddr *) &sll, sizeof(sll)) < 0)
+		goto err;
+
+	if (__test_bit(LOG_DETAIL_BIT, &debug))
+		dump_garp_ring(ring);
+	return ring;
+
+  err:
+	log_message(LOG_INFO, "GARP tx ring setup failed on ifindex %d (%m)"
+			      ", using shared channel", ifindex);
+	if (ring->map)
+		munmap(ring->map, ring->map_len);
+	ring->map = NULL;
+	if (ring->fd >= 0)
+		close(ring->fd);
+	ring->fd = -1;
+	return ring;
+}
+
+static garp_ring_t *
+garp_ring_get(int ifindex)
+{
+	garp_ring_t *ring;
+	element e;
+
+	for (e = LIST_HEAD(garp_rings); e; ELEMENT_NEXT(e)) {
+		ring = ELEMENT_DATA(e);
+		if (ring->ifindex == ifindex)
+			return (ring->fd < 0) ? NULL : ring;
+	}
+
+	ring = alloc_garp_ring(ifindex);
+	return (ring->fd < 0) ? NULL : ring;
+}
+
+/* Kick the ring: the kernel sends every frame marked SEND_REQUEST.
+ * The socket is blocking, so this returns once the ring is drained.
+ */
+static int
+garp_ring_kick(garp_ring_t *ring)
+{
+	return send(ring->fd, NULL, 0, 0);
+}
+
+/* Copy a frame into the next ring slot. Return -1 if no slot frees up */
+static int
+garp_ring_put(garp_ring_t *ring, char *frame, int len)
+{
+	struct tpacket3_hdr *hdr;
+
+	hdr = (struct tpacket3_hdr *) (ring->map + ring->frame_idx * GARP_RING_FRAME_SIZE);
+	if (hdr->tp_status != TP_STATUS_AVAILABLE) {
+		/* Ring is full, flush it before going on */
+		garp_ring_kick(ring);
+		if (hdr->tp_status != TP_STATUS_AVAILABLE &&
+		    hdr->tp_status != TP_STATUS_WRONG_FORMAT)
+			return -1;
+	}
+
+	memcpy((char *) hdr + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)), frame, len);
+	hdr->tp_len = len;
+	hdr->tp_next_offset = 0;
+	hdr->tp_status = TP_STATUS_SEND_REQUEST;
+
+	ring->frame_idx = (ring->frame_idx + 1) % ring->frame_nr;
+	return 0;
+}
+
+/* Return the prebuilt frame for a VIP, (re)building it if the
+ * owning interface hardware address changed since last build.
+ */
+static char *
+garp_frame(ip_address_t *ipaddress)
+{
+	struct ether_header *eth;
+
+	if (!ipaddress->garp_pkt)
+		ipaddress->garp_pkt = (char *) MALLOC(GARP_FRAME_LEN);
+	else {
+		eth = (struct ether_header *) ipaddress->garp_pkt;
+		if (!memcmp(eth->ether_shost, IF_HWADDR(ipaddress->ifp), ETH_ALEN))
+			return ipaddress->garp_pkt;
+		memset(ipaddress->garp_pkt, 0, GARP_FRAME_LEN);
+	}
+
+	if (IP_IS6(ipaddress))
+		ipaddress->garp_pkt_len = ndisc_build_unsolicited_na(ipaddress, ipaddress->garp_pkt);
+	else
+		ipaddress->garp_pkt_len = build_gratuitous_arp(ipaddress, ipaddress->garp_pkt);
+
+	return ipaddress->garp_pkt;
+}
+
+static void
+garp_log_error(ip_address_t *ipaddress)
+{
+	char addr_str[INET6_ADDRSTRLEN];
+
+	if (IP_IS6(ipaddress)) {
+		inet_ntop(AF_INET6, &ipaddress->u.sin6_addr, addr_str, sizeof(addr_str));
+		log_message(LOG_INFO, "VRRP: Error sending ndisc unsolicited neighbour advert on %s for %s",
+			    IF_NAME(ipaddress->ifp), addr_str);
+	} else
+		log_message(LOG_INFO, "Error sending gratuitous ARP on %s for %s",
+			    IF_NAME(ipaddress->ifp), inet_ntop2(ipaddress->u.sin.sin_addr.s_addr));
+}
+
+/* Return the TX ring a VIP frame is to be sent through, if any */
+static garp_ring_t *
+garp_channel_ring(ip_address_t *ipaddress)
+{
+	if (!global_data->vrrp_garp_tx_ring)
+		return NULL;
+	return garp_ring_get(IF_INDEX(ipaddress->ifp));
+}
+
+/* Send at most max queued frames through a single TX ring kick.
+ * The batch is cut short at the first frame going to another channel.
+ */
+static unsigned int
+garp_send_ring(garp_ring_t *ring, unsigned int max)
+{
+	ip_address_t *ipaddress;
+	unsigned int cnt = 0;
+	timeval_t start;
+	char *frame;
+
+	start = timer_now();
+	while (garp_queue_head != garp_queue_tail && cnt < max) {
+		ipaddress = garp_queue[garp_queue_head];
+		if (garp_channel_ring(ipaddress) != ring)
+			break;
+		garp_queue_head++;
+		cnt++;
+
+		frame = garp_frame(ipaddress);
+		if (garp_ring_put(ring, frame, ipaddress->garp_pkt_len) < 0)
+			garp_log_error(ipaddress);
+	}
+
+	if (garp_ring_kick(ring) < 0)
+		log_message(LOG_INFO, "Error kicking GARP tx ring on ifindex %d (%m)"
+				    , ring->ifindex);
+
+	if (__test_bit(LOG_DETAIL_BIT, &debug))
+		log_message(LOG_INFO, "GARP tx ring on ifindex %d sent %u frames in %ld usec"
+				    , ring->ifindex, cnt, timer_long(timer_sub(timer_now(), start)));
+	return cnt;
+}
+
+/* Send at most max queued frames using a single sendmmsg() call.
+ * A batch only holds frames for one socket, so it is cut short
+ * when the next frame belongs to the other address family or
+ * goes through a TX ring.
+ * Return the number of frames dequeued.
+ */
+static unsigned int
+garp_send_batch(unsigned int max)
+{
+	struct mmsghdr msgs[VRRP_GARP_BATCH_MAX];
+	struct iovec iov[VRRP_GARP_BATCH_MAX];
+	struct sockaddr_ll sll[VRRP_GARP_BATCH_MAX];
+	ip_address_t *addrs[VRRP_GARP_BATCH_MAX];
+	ip_address_t *ipaddress;
+	garp_ring_t *ring;
+	unsigned int cnt = 0, done = 0;
+	int fd = -1, ret;
+
+	if (max > VRRP_GARP_BATCH_MAX)
+		max = VRRP_GARP_BATCH_MAX;
+
+	/* Head of queue goes through a TX ring */
+	if (garp_queue_head != garp_queue_tail &&
+	    (ring = garp_channel_ring(garp_queue[garp_queue_head]))) {
+		cnt = garp_send_ring(ring, max);
+		if (garp_queue_head == garp_queue_tail)
+			garp_queue_head = garp_queue_tail = 0;
+		return cnt;
+	}
+
+	memset(msgs, 0, sizeof(msgs));
+	while (garp_queue_head != garp_queue_tail && cnt < max) {
+		ipaddress = garp_queue[garp_queue_head];
+		if (cnt && (fd != (IP_IS6(ipaddress) ? ndisc_fd : garp_fd) ||
+			    garp_channel_ring(ipaddress)))
+			break;
+		fd = IP_IS6(ipaddress) ? ndisc_fd : garp_fd;
+		garp_queue_head++;
+
+		/* Build the dst device */
+		memset(&sll[cnt], 0, sizeof(struct sockaddr_ll));
+		sll[cnt].sll_family = AF_PACKET;
+		memcpy(sll[cnt].sll_addr, IF_HWADDR(ipaddress->ifp), ETH_ALEN);
+		sll[cnt].sll_halen = ETHERNET_HW_LEN;
+		sll[cnt].sll_ifindex = IF_INDEX(ipaddress->ifp);
+
+		iov[cnt].iov_base = garp_frame(ipaddress);
+		iov[cnt].iov_len = ipaddress->garp_pkt_len;
+		msgs[cnt].msg_hdr.msg_name = &sll[cnt];
+		msgs[cnt].msg_hdr.msg_namelen = sizeof(struct sockaddr_ll);
+		msgs[cnt].msg_hdr.msg_iov = &iov[cnt];
+		msgs[cnt].msg_hdr.msg_iovlen = 1;
+		addrs[cnt++] = ipaddress;
+	}
+
+	if (garp_queue_head == garp_queue_tail)
+		garp_queue_head = garp_queue_tail = 0;
+
+	/* Send packets. A failing frame is reported and skipped */
+	while (done < cnt) {
+		ret = sendmmsg(fd, &msgs[done], cnt - done, 0);
+		if (ret <= 0) {
+			garp_log_error(addrs[done++]);
+			continue;
+		}
+		done += ret;
+	}
+
+	return cnt;
+}
+
+/* Flush the whole queue without pacing */
+static void
+garp_queue_flush(void)
+{
+	while (garp_queue_head != garp_queue_tail)
+		garp_send_batch(global_data->vrrp_garp_batch);
+}
+
+/* Send one batch and schedule the next one so that the
+ * configured packet rate is honoured on average.
+ */
+static int
+garp_pacer_thread(thread_t * thread)
+{
+	unsigned int sent;
+
+	garp_pacer = NULL;
+	sent = garp_send_batch(global_data->vrrp_garp_batch);
+	if (garp_queue_head == garp_queue_tail) {
+		garp_pacer_running = 0;
+		return 0;
+	}
+
+	garp_pacer = thread_add_timer(master, garp_pacer_thread, NULL,
+				      ((long) sent * TIMER_HZ) / global_data->vrrp_garp_rate);
+	return 0;
+}
+
+/* Queue one frame for ipaddress */
+void
+vrrp_garp_queue_add(ip_address_t *ipaddress)
+{
+	if (garp_queue_tail == garp_queue_size) {
+		if (garp_queue_head) {
+			/* Reclaim room at the front */
+			memmove(garp_queue, &garp_queue[garp_queue_head],
+				(garp_queue_tail - garp_queue_head) * sizeof(ip_address_t *));
+			garp_queue_tail -= garp_queue_head;
+			garp_queue_head = 0;
+		} else {
+			garp_queue_size *= 2;
+			garp_queue = REALLOC(garp_queue, garp_queue_size * sizeof(ip_address_t *));
+		}
+	}
+
+	garp_queue[garp_queue_tail++] = ipaddress;
+}
+
+/* Drop the queued frames of any address in l, once the
+ * instance owning them no longer holds them.
+ */
+void
+vrrp_garp_queue_purge(list l)
+{
+	unsigned int i, j;
+	element e;
+
+	if (LIST_ISEMPTY(l))
+		return;
+
+	for (i = j = garp_queue_head; i < garp_queue_tail; i++) {
+		for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e))
+			if (ELEMENT_DATA(e) == garp_queue[i])
+				break;
+		if (!e)
+			garp_queue[j++] = garp_queue[i];
+	}
+	garp_queue_tail = j;
+
+	/* A running pacer stops by itself on an empty queue */
+	if (garp_queue_head == garp_queue_tail)
+		garp_queue_head = garp_queue_tail = 0;
+}
+
+/* Push queued frames to the wire */
+void
+vrrp_garp_queue_run(void)
+{
+	if (garp_queue_head == garp_queue_tail)
+		return;
+
+	if (!global_data->vrrp_garp_rate) {
+		garp_queue_flush();
+		return;
+	}
+
+	/* The pacer is already draining the queue */
+	if (garp_pacer_running)
+		return;
+
+	garp_pacer_running = 1;
+	garp_pacer_thread(NULL);
+}
+
+/*
+ *	Burst engine init/close
+ */
+void
+vrrp_garp_init(void)
+{
+	garp_queue_size = GARP_QUEUE_DEFAULT_SIZE;
+	garp_queue = (ip_address_t **) MALLOC(garp_queue_size * sizeof(ip_address_t *));
+	garp_queue_head = garp_queue_tail = 0;
+	garp_pacer_running = 0;
+	garp_rings = alloc_list(free_garp_ring, dump_garp_ring);
+}
+
+void
+vrrp_garp_close(void)
+{
+	/* Pending frames refer to the configuration being released */
+	FREE(garp_queue);
+	garp_queue = NULL;
+	garp_queue_size = garp_queue_head = garp_queue_tail = 0;
+	garp_pacer_running = 0;
+	/* The scheduler outlives a reload */
+	thread_cancel(garp_pacer);
+	garp_pacer = NULL;
+	/* TX rings are bound to interfaces which may be gone on reload */
+	free_list(garp_rings);
+	garp_rings = NULL;
+}
@@ -51,14 +51,16 @@ typedef uint8_t u8;
 #include "vrrp_data.h"
 #include "vrrp.h"
 #include "vrrp_if.h"
+#include "vrrp_track.h"
 #include "vrrp_netlink.h"
 #include "memory.h"
 #include "utils.h"
 #include "logger.h"
 
 /* Global vars */
-static list if_queue;
+static list_head_t if_queue = LIST_HEAD_INITIALIZER(if_queue);
 static struct ifreq ifr;
+static int linkbeat_polling;	/* MII/ethtool polling threads are running */
 
 /* Helper functions */
 /* Return interface from interface index */
@@ -66,13 +68,8 @@ interface_t *
 if_get_by_ifindex(const int ifindex)
 {
 	interface_t *ifp;
-	element e;
 
-	if (LIST_ISEMPTY(if_queue))
-		return NULL;
-
-	for (e = LIST_HEAD(if_queue); e; ELEMENT_NEXT(e)) {
-		ifp = ELEMENT_DATA(e);
+	list_head_for_each_entry(ifp, &if_queue, e_list) {
 		if (ifp->ifindex == ifindex)
 			return ifp;
 	}
@@ -92,19 +89,32 @@ interface_t *
 if_get_by_ifname(const char *ifname)
 {
 	interface_t *ifp;
-	element e;
-
-	if (LIST_ISEMPTY(if_queue))
-		return NULL;
 
-	for (e = LIST_HEAD(if_queue); e; ELEMENT_NEXT(e)) {
-		ifp = ELEMENT_DATA(e);
+	list_head_for_each_entry(ifp, &if_queue, e_list) {
 		if (!strcmp(ifp->ifname, ifname))
 			return ifp;
 	}
 	return NULL;
 }
 
+/* Update interface flags, pushing any UP/DOWN transition to the
+ * instances tracking this interface.
+ */
+void
+if_set_flags(interface_t *ifp, const unsigned long flags)
+{
+	int was_up;
+
+	if (LIST_ISEMPTY(ifp->tracking_vrrp)) {
+		ifp->flags = flags;
+		return;
+	}
+
+	was_up = IF_ISUP(ifp);
+	ifp->flags = flags;
+	vrrp_track_if_changed(ifp, was_up);
+}
+
 /*
  * Reflect base interface flags on VMAC interfaces.
  * VMAC interfaces should never update it own flags, only be reflected
@@ -114,15 +124,13 @@ void
 if_vmac_reflect_flags(const int ifindex, const unsigned long flags)
 {
 	interface_t *ifp;
-	element e;
 
-	if (LIST_ISEMPTY(if_queue) || !ifindex)
+	if (!ifindex)
 		return;
 
-	for (e = LIST_HEAD(if_queue); e; ELEMENT_NEXT(e)) {
-		ifp = ELEMENT_DATA(e);
+	list_head_for_each_entry(ifp, &if_queue, e_list) {
 		if (ifp->vmac && ifp->base_ifindex == ifindex)
-			ifp->flags = flags;
+			if_set_flags(ifp, flags);
 	}
 }
 
@@ -276,15 +284,16 @@ if_ioctl_flags(interface_t * ifp)
 		close(fd);
 		return;
 	}
-	ifp->flags = ifr.ifr_flags;
+	if_set_flags(ifp, ifr.ifr_flags);
 	close(fd);
 }
 
 /* Interfaces lookup */
 static void
-free_if(void *data)
+free_if(interface_t *ifp)
 {
-	FREE(data);
+	free_list(ifp->tracking_vrrp);
+	FREE(ifp);
 }
 
 void
@@ -341,19 +350,37 @@ dump_if(void *data)
 static void
 init_if_queue(void)
 {
-	if_queue = alloc_list(free_if, dump_if);
+	INIT_LIST_HEAD(&if_queue);
 }
 
 void
 if_add_queue(interface_t * ifp)
 {
-	list_add(if_queue, ifp);
+	list_head_add_tail(&ifp->e_list, &if_queue);
+}
+
+/* Unlink only, the caller owns ifp */
+void
+if_del_queue(interface_t * ifp)
+{
+	list_head_del(&ifp->e_list);
+}
+
+/* Wipe an interface for reuse, keeping its place in the queue */
+void
+if_reset(interface_t * ifp)
+{
+	list_head_t e_list = ifp->e_list;
+
+	memset(ifp, 0, sizeof(interface_t));
+	ifp->e_list = e_list;
 }
 
 static int
 if_linkbeat_refresh_thread(thread_t * thread)
 {
 	interface_t *ifp = THREAD_ARG(thread);
+	int was_up = !LIST_ISEMPTY(ifp->tracking_vrrp) && IF_ISUP(ifp);
 
 	if (IF_MII_SUPPORTED(ifp))
 		ifp->linkbeat = (if_mii_probe(ifp->ifname)) ? 1 : 0;
@@ -361,6 +388,8 @@ if_linkbeat_refresh_thread(thread_t * thread)
 		ifp->linkbeat = (if_ethtool_probe(ifp->ifname)) ? 1 : 0;
 	else
 		ifp->linkbeat = 1;
+	if (!LIST_ISEMPTY(ifp->tracking_vrrp))
+		vrrp_track_if_changed(ifp, was_up);
 
 	/*
 	 * update ifp->flags to get the new IFF_RUNNING status.
@@ -377,11 +406,9 @@ static void
 init_if_linkbeat(void)
 {
 	interface_t *ifp;
-	element e;
 	int status;
 
-	for (e = LIST_HEAD(if_queue); e; ELEMENT_NEXT(e)) {
-		ifp = ELEMENT_DATA(e);
+	list_head_for_each_entry(ifp, &if_queue, e_list) {
 		ifp->lb_type = LB_IOCTL;
 		status = if_mii_probe(ifp->ifname);
 		if (status >= 0) {
@@ -416,9 +443,25 @@ if_linkbeat(const interface_t * ifp)
 void
 free_interface_queue(void)
 {
-	if (!LIST_ISEMPTY(if_queue))
-		free_list(if_queue);
-	if_queue = NULL;
+	interface_t *ifp, *next;
+
+	list_head_for_each_entry_safe(ifp, next, &if_queue, e_list)
+		free_if(ifp);
+	INIT_LIST_HEAD(&if_queue);
+}
+
+/* Drop reverse tracking links, the instances they point to are
+ * about to be released by a reload.
+ */
+void
+reset_interface_tracking(void)
+{
+	interface_t *ifp;
+
+	list_head_for_each_entry(ifp, &if_queue, e_list) {
+		free_list(ifp->tracking_vrrp);
+		ifp->tracking_vrrp = NULL;
+	}
 }
 
 void
@@ -426,15 +469,19 @@ init_interface_queue(void)
 {
 	init_if_queue();
 	netlink_interface_lookup();
-//	dump_list(if_queue);
 }
 
 void
 init_interface_linkbeat(void)
 {
+	/* Polling threads survive a reload */
+	if (linkbeat_polling)
+		return;
+
 	if (global_data->linkbeat_use_polling) {
 		log_message(LOG_INFO, "Using MII-BMSR NIC polling thread...");
 		init_if_linkbeat();
+		linkbeat_polling = 1;
 	} else {
 		log_message(LOG_INFO, "Using LinkWatch kernel netlink reflector...");
 	}
@@ -26,6 +26,7 @@
 #include "vrrp.h"
 #include "memory.h"
 #include "list.h"
+#include "utils.h"
 
 /* VRID hash table */
 void
@@ -69,6 +70,37 @@ vrrp_index_lookup(const int vrid, const int fd)
 	return NULL;
 }
 
+/* Instance name hash table */
+static list
+vrrp_name_bucket(const char *iname)
+{
+	uint32_t hash = hash_string(iname, HASH_FNV1A_INIT);
+
+	return &vrrp_data->vrrp_index_name[hash & (VRRP_INDEX_NAME_SIZE - 1)];
+}
+
+void
+alloc_vrrp_name_bucket(vrrp_t *vrrp)
+{
+	list_add(vrrp_name_bucket(vrrp->iname), vrrp);
+}
+
+vrrp_t *
+vrrp_index_name_lookup(const char *iname)
+{
+	vrrp_t *vrrp;
+	element e;
+	list l = vrrp_name_bucket(iname);
+
+	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+		vrrp = ELEMENT_DATA(e);
+		if (!strcmp(vrrp->iname, iname))
+			return vrrp;
+	}
+
+	return NULL;
+}
+
 /* FD hash table */
 void
 alloc_vrrp_fd_bucket(vrrp_t *vrrp)
@@ -24,11 +24,114 @@
 #include "vrrp_ipaddress.h"
 #include "vrrp_netlink.h"
 #include "vrrp_data.h"
+#include "vrrp_ipset.h"
 #include "logger.h"
 #include "memory.h"
 #include "utils.h"
 #include "bitops.h"
 
+/*
+ * Kernel address cache. Mirrors the addresses currently set in the
+ * kernel, as learnt from the netlink address lookup and reflector
+ * plus the changes we make ourselves (the reflector skips those).
+ * Transitions use it to only emit the netlink requests needed.
+ */
+static kernel_ipaddr_t *kernel_ipaddr_hash[KERNEL_IPADDR_HASH_SIZE];
+static int kernel_ipaddr_valid;
+
+static unsigned int
+kernel_ipaddr_hashkey(int family, void *addr)
+{
+	uint32_t *a = addr;
+	uint32_t key = a[0];
+
+	if (family == AF_INET6)
+		key ^= a[1] ^ a[2] ^ a[3];
+	key ^= key >> 16;
+	return (key ^ (key >> 8)) & (KERNEL_IPADDR_HASH_SIZE - 1);
+}
+
+static kernel_ipaddr_t **
+kernel_ipaddr_lookup(int family, int ifindex, int prefixlen, void *addr)
+{
+	kernel_ipaddr_t **kp;
+	kernel_ipaddr_t *k;
+	int len = (family == AF_INET6) ? sizeof(struct in6_addr) : sizeof(struct in_addr);
+
+	kp = &kernel_ipaddr_hash[kernel_ipaddr_hashkey(family, addr)];
+	for (; (k = *kp); kp = &k->next) {
+		/* IPv4 addresses are keyed on prefix too, IPv6 are not */
+		if (k->family == family && k->ifindex == ifindex &&
+		    (family == AF_INET6 || k->prefixlen == prefixlen) &&
+		    !memcmp(&k->u, addr, len))
+			break;
+	}
+
+	return kp;
+}
+
+void
+kernel_ipaddr_update(int family, int ifindex, int prefixlen, void *addr, int cmd)
+{
+	kernel_ipaddr_t **kp;
+	kernel_ipaddr_t *k;
+
+	kp = kernel_ipaddr_lookup(family, ifindex, prefixlen, addr);
+	if (cmd && !*kp) {
+		k = (kernel_ipaddr_t *) MALLOC(sizeof(kernel_ipaddr_t));
+		k->family = family;
+		k->ifindex = ifindex;
+		k->prefixlen = prefixlen;
+		memcpy(&k->u, addr, (family == AF_INET6) ? sizeof(struct in6_addr) :
+							    sizeof(struct in_addr));
+		*kp = k;
+	} else if (!cmd && *kp) {
+		k = *kp;
+		*kp = k->next;
+		FREE(k);
+	}
+}
+
+/* Called once the cache mirrors the kernel. Until then, and after a
+ * flush, every request is sent.
+ */
+void
+kernel_ipaddr_set_valid(void)
+{
+	kernel_ipaddr_valid = 1;
+}
+
+void
+kernel_ipaddr_flush(void)
+{
+	kernel_ipaddr_t *k;
+	int i;
+
+	for (i = 0; i < KERNEL_IPADDR_HASH_SIZE; i++) {
+		while ((k = kernel_ipaddr_hash[i])) {
+			kernel_ipaddr_hash[i] = k->next;
+			FREE(k);
+		}
+	}
+	kernel_ipaddr_valid = 0;
+}
+
+/* Return 1 if the kernel already matches the cmd for this address */
+static int
+kernel_ipaddr_match(ip_address_t *ipaddress, int cmd)
+{
+	void *addr = IP_IS6(ipaddress) ? (void *) &ipaddress->u.sin6_addr :
+					 (void *) &ipaddress->u.sin.sin_addr;
+	int exist;
+
+	if (!kernel_ipaddr_valid)
+		return 0;
+
+	exist = *kernel_ipaddr_lookup(IP_FAMILY(ipaddress), ipaddress->ifa.ifa_index,
+				      ipaddress->ifa.ifa_prefixlen, addr) != NULL;
+	return (cmd) ? exist : !exist;
+}
+
 /* Add/Delete IP address to a specific interface_t */
 static int
 netlink_ipaddress(ip_address_t *ipaddress, int cmd)
@@ -98,9 +201,23 @@ netlink_ipaddress(ip_address_t *ipaddress, int cmd)
 		addattr_l(&req.n, sizeof (req), IFA_LABEL,
 			  ipaddress->label, strlen(ipaddress->label) + 1);
 
-	if (netlink_talk(&nl_cmd, &req.n) < 0)
+	if (netlink_talk(&nl_cmd, &req.n) < 0) {
 		status = -1;
 
+		/* The kernel dropped it behind our back, forget it too */
+		if (cmd == IPADDRESS_DEL && (errno == EADDRNOTAVAIL || errno == ENOENT))
+			kernel_ipaddr_update(IP_FAMILY(ipaddress), ipaddress->ifa.ifa_index,
+					     ipaddress->ifa.ifa_prefixlen,
+					     IP_IS6(ipaddress) ? (void *) &ipaddress->u.sin6_addr :
+								 (void *) &ipaddress->u.sin.sin_addr,
+					     cmd);
+	} else
+		kernel_ipaddr_update(IP_FAMILY(ipaddress), ipaddress->ifa.ifa_index,
+				     ipaddress->ifa.ifa_prefixlen,
+				     IP_IS6(ipaddress) ? (void *) &ipaddress->u.sin6_addr :
+							 (void *) &ipaddress->u.sin.sin_addr,
+				     cmd);
+
 	return status;
 }
 
@@ -124,6 +241,14 @@ netlink_iplist(list ip_list, int cmd)
 		if ((cmd && !ipaddr->set) ||
 		    (!cmd &&
 		     (ipaddr->set || __test_bit(DONT_RELEASE_VRRP_BIT, &debug)))) {
+			/* Kernel already there, nothing to send. An address
+			 * we did not add is not ours to remove later.
+			 */
+			if (kernel_ipaddr_match(ipaddr, cmd)) {
+				if (!cmd)
+					ipaddr->set = 0;
+				continue;
+			}
 			if (netlink_ipaddress(ipaddr, cmd) > 0)
 				ipaddr->set = (cmd) ? 1 : 0;
 			else
@@ -166,6 +291,11 @@ handle_iptable_rule_to_vip(ip_address_t *ipaddress, int cmd, char *ifname)
 	char  *argv[10];
 	unsigned int i = 0;
 
+	if (vrrp_ipset_active()) {
+		vrrp_ipset_ipaddress(ipaddress, cmd, ifname);
+		return;
+	}
+
 	if (IP_IS6(ipaddress)) {
 		handle_iptable_rule_to_NA(ipaddress, cmd, ifname);
 		argv[i++] = "ip6tables";
@@ -202,6 +332,12 @@ handle_iptable_rule_to_iplist(list ip_list, int cmd, char *ifname)
 	if (LIST_ISEMPTY(ip_list))
 		return;
 
+	/* All entries go in a single ipset request */
+	if (vrrp_ipset_active()) {
+		vrrp_ipset_iplist(ip_list, cmd, ifname);
+		return;
+	}
+
 	for (e = LIST_HEAD(ip_list); e; ELEMENT_NEXT(e)) {
 		ipaddr = ELEMENT_DATA(e);
 		if ((cmd && !ipaddr->iptable_rule_set) ||
@@ -218,6 +354,7 @@ free_ipaddress(void *if_data)
 	ip_address_t *ipaddr = if_data;
 
 	FREE_PTR(ipaddr->label);
+	FREE_PTR(ipaddr->garp_pkt);
 	FREE(ipaddr);
 }
 char *
@@ -394,6 +531,18 @@ address_exist(list l, ip_address_t *ipaddress)
 	return 0;
 }
 
+/* Addresses of the new conf are indexed on address and interface */
+static list
+address_hashbucket(list index, unsigned int size, ip_address_t *ipaddr)
+{
+	void *addr = (IP_IS6(ipaddr)) ? (void *) &ipaddr->u.sin6_addr :
+					(void *) &ipaddr->u.sin.sin_addr;
+	uint32_t hash = hash_fnv1a(addr, IP_SIZE(ipaddr), HASH_FNV1A_INIT);
+
+	hash = hash_fnv1a(&ipaddr->ifa.ifa_index, sizeof(ipaddr->ifa.ifa_index), hash);
+	return &index[hash & (size - 1)];
+}
+
 /* Clear diff addresses */
 void
 clear_diff_address(list l, list n)
@@ -403,6 +552,8 @@ clear_diff_address(list l, list n)
 	char *addr_str;
 	void *addr;
 	char *iface_name;
+	unsigned int size;
+	list index;
 
 	/* No addresses in previous conf */
 	if (LIST_ISEMPTY(l))
@@ -418,11 +569,20 @@ clear_diff_address(list l, list n)
 		return;
 	}
 
+	/* Index the new addresses */
+	size = hash_index_size(LIST_SIZE(n));
+	index = alloc_mlist(NULL, NULL, size);
+	for (e = LIST_HEAD(n); e; ELEMENT_NEXT(e)) {
+		ipaddr = ELEMENT_DATA(e);
+		list_add(address_hashbucket(index, size, ipaddr), ipaddr);
+	}
+
 	addr_str = (char *) MALLOC(41);
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		ipaddr = ELEMENT_DATA(e);
 
-		if (!address_exist(n, ipaddr) && ipaddr->set) {
+		if (!address_exist(address_hashbucket(index, size, ipaddr), ipaddr) &&
+		    ipaddr->set) {
 			addr = (IP_IS6(ipaddr)) ? (void *) &ipaddr->u.sin6_addr :
 						  (void *) &ipaddr->u.sin.sin_addr;
 			inet_ntop(IP_FAMILY(ipaddr), addr, addr_str, 41);
@@ -437,6 +597,7 @@ clear_diff_address(list l, list n)
 		}
 	}
 	FREE(addr_str);
+	free_mlist(index, size);
 }
 
 /* Clear static ip address */
@@ -26,6 +26,7 @@
 #include "vrrp_netlink.h"
 #include "vrrp_if.h"
 #include "vrrp_data.h"
+#include "vrrp_vmac.h"
 #include "logger.h"
 #include "memory.h"
 #include "utils.h"
@@ -252,6 +253,9 @@ alloc_route(list rt_list, vector_t *strvec)
 				FREE(new);
 				return;
 			}
+			/* Routes only keep the ifindex, VMACs must exist by now */
+			if (ifp->vmac && !ifp->ifindex)
+				netlink_link_vmac_commit();
 			new->index = IF_INDEX(ifp);
 		} else if (!strcmp(str, "table")) {
 			new->table = atoi(vector_slot(strvec, ++i));
@@ -0,0 +1,503 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Accept mode VIP drop rules through ipset. Two
+ *              hash:net,iface sets (IPv4/IPv6) are referenced by a
+ *              fixed pair of iptables rules installed at startup, and
+ *              transitions only add/remove set entries, all of them in
+ *              a single batched nfnetlink request.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+/* system includes */
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/ipset/ip_set.h>
+
+/* local includes */
+#include "vrrp_ipset.h"
+#include "vrrp_netlink.h"
+#include "vrrp_data.h"
+#include "vrrp.h"
+#include "global_data.h"
+#include "scheduler.h"
+#include "logger.h"
+#include "memory.h"
+#include "utils.h"
+#include "bitops.h"
+#include "main.h"
+
+#ifndef NLMSG_TAIL
+#define NLMSG_TAIL(nmsg) ((struct rtattr *) (((void *) (nmsg)) + NLMSG_ALIGN((nmsg)->nlmsg_len)))
+#endif
+
+#define IPSET_TYPENAME	"hash:net,iface"
+#define IPSET_REVISION	0
+
+/* nfnetlink channel and set names, kept across reloads */
+static int ipset_fd = -1;
+static char *ipset_name4;
+static char *ipset_name6;
+static uint32_t ipset_seq;
+
+/* Pending batch. addrs[i] is the VIP the i-th request is about,
+ * or NULL for set management requests.
+ */
+static char *ipset_buf;
+static size_t ipset_buf_len;
+static ip_address_t **ipset_addrs;
+static unsigned int ipset_cnt;
+static unsigned int ipset_max;
+static uint32_t ipset_first_seq;
+
+int
+vrrp_ipset_active(void)
+{
+	return ipset_fd >= 0;
+}
+
+/* Start a new request at the end of the batch */
+static struct nlmsghdr *
+ipset_msg_start(int cmd, int family, ip_address_t *ipaddress)
+{
+	struct nlmsghdr *n;
+	struct nfgenmsg *nfg;
+	uint8_t proto = IPSET_PROTOCOL_MIN;
+
+	if (ipset_cnt == ipset_max) {
+		ipset_max = (ipset_max) ? ipset_max * 2 : 64;
+		ipset_addrs = (ip_address_t **) REALLOC(ipset_addrs, ipset_max * sizeof(ip_address_t *));
+	}
+	if (!ipset_cnt)
+		ipset_first_seq = ipset_seq + 1;
+	ipset_addrs[ipset_cnt++] = ipaddress;
+
+	n = (struct nlmsghdr *) (ipset_buf + ipset_buf_len);
+	memset(n, 0, IPSET_MSG_MAX);
+	n->nlmsg_len = NLMSG_LENGTH(sizeof(struct nfgenmsg));
+	n->nlmsg_type = (NFNL_SUBSYS_IPSET << 8) | cmd;
+	n->nlmsg_flags = NLM_F_REQUEST;
+	n->nlmsg_seq = ++ipset_seq;
+
+	nfg = NLMSG_DATA(n);
+	nfg->nfgen_family = family;
+	nfg->version = NFNETLINK_V0;
+
+	addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_PROTOCOL, &proto, sizeof(proto));
+	return n;
+}
+
+static void
+ipset_msg_end(struct nlmsghdr *n)
+{
+	ipset_buf_len += NLMSG_ALIGN(n->nlmsg_len);
+}
+
+static struct rtattr *
+ipset_nest_start(struct nlmsghdr *n, int type)
+{
+	struct rtattr *nest = NLMSG_TAIL(n);
+
+	addattr_l(n, IPSET_MSG_MAX, type | NLA_F_NESTED, NULL, 0);
+	return nest;
+}
+
+static void
+ipset_nest_end(struct nlmsghdr *n, struct rtattr *nest)
+{
+	/* Padding of the last attribute belongs to the nest */
+	n->nlmsg_len = NLMSG_ALIGN(n->nlmsg_len);
+	nest->rta_len = (char *) NLMSG_TAIL(n) - (char *) nest;
+}
+
+/* Send the batch and collect errors. Only the last request asks for an
+ * ACK, errors on the others come back before it. Entries are flagged
+ * according to cmd unless the kernel refused them.
+ */
+static int
+ipset_commit(int cmd)
+{
+	struct nlmsghdr *n;
+	struct nlmsgerr *err;
+	char buf[4096];
+	char *addr_str;
+	uint32_t last_seq;
+	unsigned int i;
+	int status, errors = 0, done = 0;
+
+	if (!ipset_cnt)
+		return 0;
+
+	/* Find the last request and ask for an ACK */
+	for (n = (struct nlmsghdr *) ipset_buf, i = 1; i < ipset_cnt; i++)
+		n = (struct nlmsghdr *) ((char *) n + NLMSG_ALIGN(n->nlmsg_len));
+	n->nlmsg_flags |= NLM_F_ACK;
+	last_seq = n->nlmsg_seq;
+
+	if (send(ipset_fd, ipset_buf, ipset_buf_len, 0) < 0) {
+		log_message(LOG_INFO, "ipset: error sending %u requests (%m)", ipset_cnt);
+		for (i = 0; i < ipset_cnt; i++)
+			ipset_addrs[i] = NULL;
+		errors = ipset_cnt;
+		done = 1;
+	}
+
+	while (!done) {
+		status = recv(ipset_fd, buf, sizeof(buf), 0);
+		if (status < 0) {
+			if (errno == EINTR)
+				continue;
+			log_message(LOG_INFO, "ipset: error receiving answer (%m)");
+			errors++;
+			break;
+		}
+
+		for (n = (struct nlmsghdr *) buf; NLMSG_OK(n, status); n = NLMSG_NEXT(n, status)) {
+			if (n->nlmsg_type != NLMSG_ERROR)
+				continue;
+			err = NLMSG_DATA(n);
+			if (err->error) {
+				i = err->msg.nlmsg_seq - ipset_first_seq;
+				if (i < ipset_cnt && ipset_addrs[i]) {
+					addr_str = ipaddresstos(ipset_addrs[i]);
+					log_message(LOG_INFO, "ipset: failed to %s %s in set (%s)"
+							    , (cmd) ? "add" : "remove"
+							    , addr_str, strerror(-err->error));
+					FREE(addr_str);
+					ipset_addrs[i] = NULL;
+				} else
+					log_message(LOG_INFO, "ipset: request failed (%s)"
+							    , strerror(-err->error));
+				errors++;
+			}
+			if (err->msg.nlmsg_seq == last_seq)
+				done = 1;
+		}
+	}
+
+	for (i = 0; i < ipset_cnt; i++)
+		if (ipset_addrs[i])
+			ipset_addrs[i]->iptable_rule_set = (cmd) ? true : false;
+
+	ipset_buf_len = 0;
+	ipset_cnt = 0;
+	return errors;
+}
+
+/* Make sure there is room for one more request */
+static void
+ipset_reserve(int cmd)
+{
+	if (ipset_buf_len + IPSET_MSG_MAX > IPSET_BATCH_SIZE)
+		ipset_commit(cmd);
+}
+
+static void
+ipset_add_set_cmd(int cmd, char *name, int family)
+{
+	struct nlmsghdr *n;
+	char *type = IPSET_TYPENAME;
+	uint8_t val;
+
+	ipset_reserve(cmd);
+	n = ipset_msg_start(cmd, family, NULL);
+	addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_SETNAME, name, strlen(name) + 1);
+	if (cmd == IPSET_CMD_CREATE) {
+		addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_TYPENAME, type, strlen(type) + 1);
+		val = IPSET_REVISION;
+		addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_REVISION, &val, sizeof(val));
+		val = family;
+		addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_FAMILY, &val, sizeof(val));
+	}
+	ipset_msg_end(n);
+}
+
+static void
+ipset_add_entry(ip_address_t *ipaddress, int cmd, char *ifname)
+{
+	struct nlmsghdr *n;
+	struct rtattr *data, *ip;
+	char *name = IP_IS6(ipaddress) ? ipset_name6 : ipset_name4;
+	uint8_t cidr = IP_IS6(ipaddress) ? 128 : 32;
+
+	ipset_reserve(cmd);
+	n = ipset_msg_start(cmd ? IPSET_CMD_ADD : IPSET_CMD_DEL, IP_FAMILY(ipaddress), ipaddress);
+	addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_SETNAME, name, strlen(name) + 1);
+	data = ipset_nest_start(n, IPSET_ATTR_DATA);
+	ip = ipset_nest_start(n, IPSET_ATTR_IP);
+	if (IP_IS6(ipaddress))
+		addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_IPADDR_IPV6 | NLA_F_NET_BYTEORDER,
+			  &ipaddress->u.sin6_addr, sizeof(ipaddress->u.sin6_addr));
+	else
+		addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_IPADDR_IPV4 | NLA_F_NET_BYTEORDER,
+			  &ipaddress->u.sin.sin_addr, sizeof(ipaddress->u.sin.sin_addr));
+	ipset_nest_end(n, ip);
+	addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_CIDR, &cidr, sizeof(cidr));
+	addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_IFACE, ifname, strlen(ifname) + 1);
+	ipset_nest_end(n, data);
+	ipset_msg_end(n);
+}
+
+/* Add/remove the rules referencing the sets. Only run at startup and
+ * shutdown, so the fork/exec cost stays out of transitions.
+ */
+static int
+ipset_iptables_rule(char *cmd, int family, int na)
+{
+	char *argv[16];
+	unsigned int i = 0;
+
+	argv[i++] = (family == AF_INET6) ? "ip6tables" : "iptables";
+	argv[i++] = cmd;
+	argv[i++] = "INPUT";
+	argv[i++] = "-m";
+	argv[i++] = "set";
+	argv[i++] = "--match-set";
+	argv[i++] = (family == AF_INET6) ? ipset_name6 : ipset_name4;
+	argv[i++] = "dst,src";
+	if (na) {
+		/* Let NAs sent to the VIP in, as the per VIP rules did */
+		argv[i++] = "-p";
+		argv[i++] = "icmpv6";
+		argv[i++] = "--icmpv6-type";
+		argv[i++] = "136";
+		argv[i++] = "-j";
+		argv[i++] = "ACCEPT";
+	} else {
+		argv[i++] = "-j";
+		argv[i++] = "DROP";
+	}
+	argv[i] = NULL;
+
+	return fork_exec(argv);
+}
+
+static void
+ipset_iptables_rules(int cmd)
+{
+	char *op = (cmd) ? "-A" : "-D";
+
+	/* Remove rules left over by a previous run before adding them */
+	if (cmd)
+		ipset_iptables_rules(IPADDRESS_DEL);
+
+	if (ipset_iptables_rule(op, AF_INET, 0) < 0 && cmd)
+		log_message(LOG_INFO, "ipset: failed to set iptables rule for set %s", ipset_name4);
+	if (ipset_iptables_rule(op, AF_INET6, 1) < 0 && cmd)
+		log_message(LOG_INFO, "ipset: failed to set ip6tables NA rule for set %s", ipset_name6);
+	if (ipset_iptables_rule(op, AF_INET6, 0) < 0 && cmd)
+		log_message(LOG_INFO, "ipset: failed to set ip6tables rule for set %s", ipset_name6);
+}
+
+/* A run started with --dont-release-vrrp left its VIPs and their set
+ * entries in place. Take the entries over, so that they go away with
+ * the VIPs when an instance starts in or falls back to BACKUP.
+ */
+static void
+ipset_repopulate(void)
+{
+	vrrp_t *vrrp;
+	element e;
+
+	if (LIST_ISEMPTY(vrrp_data->vrrp))
+		return;
+
+	for (e = LIST_HEAD(vrrp_data->vrrp); e; ELEMENT_NEXT(e)) {
+		vrrp = ELEMENT_DATA(e);
+		if (!VRRP_DROP_VIP(vrrp) || LIST_ISEMPTY(vrrp->vip))
+			continue;
+		vrrp_ipset_iplist(vrrp->vip, IPADDRESS_ADD, IF_NAME(vrrp->ifp));
+		vrrp->iptable_rules_set = true;
+	}
+}
+
+/* Runs before the instances get their initial state */
+static int
+ipset_rules_thread(thread_t *thread)
+{
+	if (ipset_fd < 0)
+		return 0;
+
+	if (__test_bit(DONT_RELEASE_VRRP_BIT, &debug))
+		ipset_repopulate();
+	ipset_iptables_rules(IPADDRESS_ADD);
+	return 0;
+}
+
+static void
+ipset_release(void)
+{
+	if (ipset_fd >= 0)
+		close(ipset_fd);
+	ipset_fd = -1;
+	FREE_PTR(ipset_name4);
+	FREE_PTR(ipset_name6);
+	ipset_name4 = ipset_name6 = NULL;
+	FREE_PTR(ipset_buf);
+	FREE_PTR(ipset_addrs);
+	ipset_buf = NULL;
+	ipset_addrs = NULL;
+	ipset_buf_len = ipset_cnt = ipset_max = 0;
+}
+
+/* Batch add/remove of a list of VIPs */
+void
+vrrp_ipset_iplist(list ip_list, int cmd, char *ifname)
+{
+	ip_address_t *ipaddr;
+	element e;
+
+	if (LIST_ISEMPTY(ip_list))
+		return;
+
+	for (e = LIST_HEAD(ip_list); e; ELEMENT_NEXT(e)) {
+		ipaddr = ELEMENT_DATA(e);
+		if ((cmd && !ipaddr->iptable_rule_set) ||
+		    (!cmd && ipaddr->iptable_rule_set))
+			ipset_add_entry(ipaddr, cmd, ifname);
+	}
+
+	ipset_commit(cmd);
+}
+
+void
+vrrp_ipset_ipaddress(ip_address_t *ipaddress, int cmd, char *ifname)
+{
+	ipset_add_entry(ipaddress, cmd, ifname);
+	ipset_commit(cmd);
+}
+
+/* Rename set *name to new_name. On success *name follows */
+static void
+ipset_rename_set(char **name, char *new_name, int family)
+{
+	struct nlmsghdr *n;
+
+	if (!strcmp(*name, new_name))
+		return;
+
+	ipset_reserve(IPADDRESS_ADD);
+	n = ipset_msg_start(IPSET_CMD_RENAME, family, NULL);
+	addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_SETNAME, *name, strlen(*name) + 1);
+	addattr_l(n, IPSET_MSG_MAX, IPSET_ATTR_SETNAME2, new_name, strlen(new_name) + 1);
+	ipset_msg_end(n);
+	if (ipset_commit(IPADDRESS_ADD)) {
+		log_message(LOG_INFO, "ipset: cannot rename set %s to %s, keeping it"
+				    , *name, new_name);
+		return;
+	}
+
+	log_message(LOG_INFO, "ipset: set %s renamed to %s", *name, new_name);
+	FREE(*name);
+	*name = (char *) MALLOC(strlen(new_name) + 1);
+	strcpy(*name, new_name);
+}
+
+/* On reload, follow a change of set names. The sets are renamed
+ * rather than recreated, so their entries are kept.
+ */
+static void
+ipset_reload(void)
+{
+	if (!global_data->vrrp_ipsets) {
+		log_message(LOG_INFO, "ipset: vrrp_ipsets removed, keeping sets %s/%s"
+				      " until restart", ipset_name4, ipset_name6);
+		return;
+	}
+
+	if (!strcmp(ipset_name4, global_data->vrrp_ipset_address) &&
+	    !strcmp(ipset_name6, global_data->vrrp_ipset_address6))
+		return;
+
+	/* Sets referenced by a rule can't be renamed */
+	ipset_iptables_rules(IPADDRESS_DEL);
+	ipset_rename_set(&ipset_name4, global_data->vrrp_ipset_address, AF_INET);
+	ipset_rename_set(&ipset_name6, global_data->vrrp_ipset_address6, AF_INET6);
+	ipset_iptables_rules(IPADDRESS_ADD);
+}
+
+/* Setup sets and rules. The sets and the channel are kept across
+ * reloads, since entries of instances staying MASTER must not be lost.
+ */
+void
+vrrp_ipset_init(void)
+{
+	if (ipset_fd >= 0) {
+		ipset_reload();
+		return;
+	}
+
+	if (!global_data->vrrp_ipsets)
+		return;
+
+	ipset_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+	if (ipset_fd < 0) {
+		log_message(LOG_INFO, "ipset: cannot open nfnetlink socket (%m)"
+				      ", using per VIP iptables rules");
+		return;
+	}
+
+	ipset_name4 = (char *) MALLOC(strlen(global_data->vrrp_ipset_address) + 1);
+	strcpy(ipset_name4, global_data->vrrp_ipset_address);
+	ipset_name6 = (char *) MALLOC(strlen(global_data->vrrp_ipset_address6) + 1);
+	strcpy(ipset_name6, global_data->vrrp_ipset_address6);
+	ipset_buf = (char *) MALLOC(IPSET_BATCH_SIZE);
+
+	/* Create sets, and flush entries left over by a previous run
+	 * unless it kept its VIPs, whose entries are then taken over */
+	ipset_add_set_cmd(IPSET_CMD_CREATE, ipset_name4, AF_INET);
+	ipset_add_set_cmd(IPSET_CMD_CREATE, ipset_name6, AF_INET6);
+	if (!__test_bit(DONT_RELEASE_VRRP_BIT, &debug)) {
+		ipset_add_set_cmd(IPSET_CMD_FLUSH, ipset_name4, AF_INET);
+		ipset_add_set_cmd(IPSET_CMD_FLUSH, ipset_name6, AF_INET6);
+	}
+	if (ipset_commit(IPADDRESS_ADD)) {
+		log_message(LOG_INFO, "ipset: cannot setup sets %s/%s"
+				      ", using per VIP iptables rules"
+				    , ipset_name4, ipset_name6);
+		ipset_release();
+		return;
+	}
+
+	/* SIGCHLD is still ignored at this point, which fork_exec() can't
+	 * cope with. Set the rules from the scheduler instead.
+	 */
+	thread_add_event(master, ipset_rules_thread, NULL, 0);
+	log_message(LOG_INFO, "Using ipsets %s/%s for accept mode drop rules"
+			    , ipset_name4, ipset_name6);
+}
+
+void
+vrrp_ipset_close(void)
+{
+	if (ipset_fd < 0)
+		return;
+
+	/* VIPs are left in place, so are their drop rules */
+	if (!__test_bit(DONT_RELEASE_VRRP_BIT, &debug)) {
+		ipset_iptables_rules(IPADDRESS_DEL);
+		ipset_add_set_cmd(IPSET_CMD_DESTROY, ipset_name4, AF_INET);
+		ipset_add_set_cmd(IPSET_CMD_DESTROY, ipset_name6, AF_INET6);
+		ipset_commit(IPADDRESS_DEL);
+	}
+
+	ipset_release();
+}
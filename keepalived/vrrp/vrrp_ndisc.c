@@ -53,9 +53,7 @@ ndisc_send_na(ip_address_t *ipaddress)
 	sll.sll_ifindex = IF_INDEX(ipaddress->ifp);
 
 	/* Send packet */
-	len = sendto(ndisc_fd, ndisc_buffer,
-		     ETHER_HDR_LEN + sizeof(struct ip6hdr) + sizeof(struct ndhdr) +
-		     sizeof(struct nd_opt_hdr) + ETH_ALEN, 0,
+	len = sendto(ndisc_fd, ndisc_buffer, NDISC_NA_PKT_LEN, 0,
 		     (struct sockaddr *) &sll, sizeof (sll));
 	if (len < 0)
 		log_message(LOG_INFO, "VRRP: Error sending ndisc unsolicited neighbour advert on %s",
@@ -116,16 +114,15 @@ ndisc_icmp6_cksum(const struct ip6hdr *ip6, const struct icmp6hdr *icp, uint32_t
  *	new information quickly.
  */
 int
-ndisc_send_unsolicited_na(ip_address_t *ipaddress)
+ndisc_build_unsolicited_na(ip_address_t *ipaddress, char *buffer)
 {
-	struct ether_header *eth = (struct ether_header *) ndisc_buffer;
+	struct ether_header *eth = (struct ether_header *) buffer;
 	struct ip6hdr *ip6h = (struct ip6hdr *) ((char *)eth + ETHER_HDR_LEN);
 	struct ndhdr *ndh = (struct ndhdr*) ((char *)ip6h + sizeof(struct ip6hdr));
 	struct icmp6hdr *icmp6h = &ndh->icmph;
 	struct nd_opt_hdr *nd_opt_h = (struct nd_opt_hdr *) ((char *)ndh + sizeof(struct ndhdr));
 	char *nd_opt_lladdr = (char *) ((char *)nd_opt_h + sizeof(struct nd_opt_hdr));
 	char *lladdr = (char *) IF_HWADDR(ipaddress->ifp);
-	int len;
 
 	/* Ethernet header:
 	 * Destination ethernet address MUST use specific address Mapping
@@ -166,12 +163,21 @@ ndisc_send_unsolicited_na(ip_address_t *ipaddress)
 	icmp6h->icmp6_cksum = ndisc_icmp6_cksum(ip6h, icmp6h,
 						sizeof(struct ndhdr) + sizeof(struct nd_opt_hdr) + ETH_ALEN);
 
+	return NDISC_NA_PKT_LEN;
+}
+
+int
+ndisc_send_unsolicited_na(ip_address_t *ipaddress)
+{
+	int len;
+
+	ndisc_build_unsolicited_na(ipaddress, ndisc_buffer);
+
 	/* Send the neighbor advertisement message */
 	len = ndisc_send_na(ipaddress);
 
 	/* Cleanup room for next round */
-	memset(ndisc_buffer, 0, ETHER_HDR_LEN + sizeof(struct ip6hdr) +
-	       sizeof(struct ndhdr) + sizeof(struct nd_opt_hdr) + ETH_ALEN);
+	memset(ndisc_buffer, 0, NDISC_NA_PKT_LEN);
 
 	return len;
 }
@@ -184,8 +190,7 @@ void
 ndisc_init(void)
 {
 	/* Initalize shared buffer */
-	ndisc_buffer = (char *) MALLOC(ETHER_HDR_LEN + sizeof(struct ip6hdr) +
-				       sizeof(struct ndhdr) + sizeof(struct nd_opt_hdr) + ETH_ALEN);
+	ndisc_buffer = (char *) MALLOC(NDISC_NA_PKT_LEN);
 
 	/* Create the socket descriptor */
 	ndisc_fd = socket(PF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(ETH_P_IPV6));
@@ -43,10 +43,12 @@
 #include "scheduler.h"
 #include "utils.h"
 #include "bitops.h"
+#include "vrrp_ipaddress.h"
 
 /* Global vars */
 nl_handle_t nl_kernel;	/* Kernel reflection channel */
 nl_handle_t nl_cmd;	/* Command channel */
+static int nl_kernel_overrun;	/* Reflected events were lost */
 
 /* Create a socket to netlink interface_t */
 int
@@ -354,6 +356,8 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 			if (errno == EWOULDBLOCK || errno == EAGAIN)
 				break;
 			log_message(LOG_INFO, "Netlink: Received message overrun (%m)");
+			if (nl == &nl_kernel)
+				nl_kernel_overrun = 1;
 			continue;
 		}
 
@@ -406,11 +410,19 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 				       err->msg.nlmsg_type,
 				       err->msg.nlmsg_seq, err->msg.nlmsg_pid);
 
+				/* Let the caller know what the kernel said */
+				errno = -err->error;
 				return -1;
 			}
 
-			/* Skip unsolicited messages from cmd channel */
-			if (nl != &nl_cmd && h->nlmsg_pid == nl_cmd.nl_pid)
+			/* Skip unsolicited messages from cmd channel. Address
+			 * deletions are kept: the kernel reports the ones our
+			 * requests caused as a side effect (secondaries going
+			 * with their primary) under our pid too, and the
+			 * kernel address cache must see them.
+			 */
+			if (nl != &nl_cmd && h->nlmsg_pid == nl_cmd.nl_pid &&
+			    h->nlmsg_type != RTM_DELADDR)
 				continue;
 
 			error = (*filter) (&snl, h);
@@ -449,7 +461,7 @@ int
 netlink_talk(nl_handle_t *nl, struct nlmsghdr *n)
 {
 	int status;
-	int ret, flags;
+	int ret, flags, err_no;
 	struct sockaddr_nl snl;
 	struct iovec iov = { (void *) n, n->nlmsg_len };
 	struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
@@ -477,13 +489,97 @@ netlink_talk(nl_handle_t *nl, struct nlmsghdr *n)
 		       "blocking flag to netlink socket...");
 
 	status = netlink_parse_info(netlink_talk_filter, nl, n);
+	err_no = errno;
 
 	/* Restore previous flags */
 	if (ret == 0)
 		netlink_set_nonblock(nl, &flags);
+	errno = err_no;
 	return status;
 }
 
+/* Send a batch of messages with a single sendmsg() per NETLINK_BATCH_MAX
+ * messages, then wait once for all the acknowledgements. Messages must
+ * have room for their alignment padding. status[i] is set to the error
+ * of the i-th message, 0 on success. Return the number of failed messages.
+ */
+int
+netlink_talk_batch(nl_handle_t *nl, struct nlmsghdr **msgs, int cnt, int *status)
+{
+	struct sockaddr_nl snl;
+	struct iovec iov[NETLINK_BATCH_MAX];
+	struct msghdr msg = { (void *) &snl, sizeof snl, iov, 0, NULL, 0, 0 };
+	struct nlmsghdr *h;
+	struct nlmsgerr *err;
+	char buf[4096];
+	__u32 first_seq, last_seq;
+	int i, j, n, len, ret, flags, done, errors = 0;
+
+	memset(&snl, 0, sizeof snl);
+	snl.nl_family = AF_NETLINK;
+
+	/* Set blocking flag */
+	ret = netlink_set_block(nl, &flags);
+	if (ret < 0)
+		log_message(LOG_INFO, "Netlink: Warning, couldn't set "
+		       "blocking flag to netlink socket...");
+
+	for (i = 0; i < cnt; i += n) {
+		n = (cnt - i > NETLINK_BATCH_MAX) ? NETLINK_BATCH_MAX : cnt - i;
+		first_seq = nl->seq + 1;
+		for (j = 0; j < n; j++) {
+			msgs[i + j]->nlmsg_seq = ++nl->seq;
+			msgs[i + j]->nlmsg_flags |= NLM_F_ACK;
+			iov[j].iov_base = msgs[i + j];
+			/* Messages are packed, each must start aligned */
+			iov[j].iov_len = NLMSG_ALIGN(msgs[i + j]->nlmsg_len);
+			status[i + j] = 0;
+		}
+		last_seq = nl->seq;
+		msg.msg_iovlen = n;
+
+		if (sendmsg(nl->fd, &msg, 0) < 0) {
+			log_message(LOG_INFO, "Netlink: sendmsg() error: %s",
+			       strerror(errno));
+			for (j = 0; j < n; j++)
+				status[i + j] = -errno;
+			errors += n;
+			continue;
+		}
+
+		/* One ACK per message, the last one ends the batch */
+		for (done = 0; !done;) {
+			len = recv(nl->fd, buf, sizeof buf, 0);
+			if (len < 0) {
+				if (errno == EINTR)
+					continue;
+				log_message(LOG_INFO, "Netlink: recv() error: %s",
+				       strerror(errno));
+				break;
+			}
+
+			for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+			     h = NLMSG_NEXT(h, len)) {
+				if (h->nlmsg_type != NLMSG_ERROR)
+					continue;
+				err = (struct nlmsgerr *) NLMSG_DATA(h);
+				j = err->msg.nlmsg_seq - first_seq;
+				if (err->error && j >= 0 && j < n) {
+					status[i + j] = err->error;
+					errors++;
+				}
+				if (err->msg.nlmsg_seq == last_seq)
+					done = 1;
+			}
+		}
+	}
+
+	/* Restore previous flags */
+	if (ret == 0)
+		netlink_set_nonblock(nl, &flags);
+	return errors;
+}
+
 /* Fetch a specific type information from netlink kernel */
 static int
 netlink_request(nl_handle_t *nl, int family, int type)
@@ -531,7 +627,7 @@ netlink_if_link_populate(interface_t *ifp, struct rtattr *tb[], struct ifinfomsg
 
 	if (!ifp->vmac) {
 		if_vmac_reflect_flags(ifi->ifi_index, ifi->ifi_flags);
-		ifp->flags = ifi->ifi_flags;
+		if_set_flags(ifp, ifi->ifi_flags);
 		ifp->base_ifindex = ifi->ifi_index;
 	}
 
@@ -592,9 +688,12 @@ netlink_if_link_filter(struct sockaddr_nl *snl, struct nlmsghdr *h)
 	/* Skip it if already exist */
 	ifp = if_get_by_ifname(name);
 	if (ifp) {
+		/* VMAC stand-in, now created */
+		if (ifp->vmac && !ifp->ifindex)
+			return (netlink_if_link_populate(ifp, tb, ifi) < 0) ? -1 : 0;
 		if (!ifp->vmac) {
 			if_vmac_reflect_flags(ifi->ifi_index, ifi->ifi_flags);
-			ifp->flags = ifi->ifi_flags;
+			if_set_flags(ifp, ifi->ifi_flags);
 		}
 		return 0;
 	}
@@ -657,6 +756,10 @@ netlink_if_address_filter(struct sockaddr_nl *snl, struct nlmsghdr *h)
 	if (addr == NULL)
 		return -1;
 
+	/* Keep kernel address cache in sync */
+	kernel_ipaddr_update(ifa->ifa_family, ifa->ifa_index, ifa->ifa_prefixlen, addr,
+			     (h->nlmsg_type == RTM_NEWADDR) ? 1 : 0);
+
 	/* If no address is set on interface then set the first time */
 	if (ifa->ifa_family == AF_INET) {
 		if (!ifp->sin_addr.s_addr)
@@ -703,6 +806,9 @@ netlink_address_lookup(void)
 	nl_handle_t nlh;
 	int status = 0;
 
+	/* Kernel address cache is rebuilt from scratch */
+	kernel_ipaddr_flush();
+
 	if (netlink_socket(&nlh, 0, 0) < 0)
 		return -1;
 
@@ -719,6 +825,8 @@ netlink_address_lookup(void)
 		goto end_addr;
 	}
 	status = netlink_parse_info(netlink_if_address_filter, &nlh, NULL);
+	if (status == 0)
+		kernel_ipaddr_set_valid();
 
 end_addr:
 	netlink_close(&nlh);
@@ -769,7 +877,7 @@ netlink_reflect_filter(struct sockaddr_nl *snl, struct nlmsghdr *h)
                             ifp = (interface_t *) MALLOC(sizeof(interface_t));
                             if_add_queue(ifp);
                     } else {
-                            memset(ifp, 0, sizeof(interface_t));
+                            if_reset(ifp);
                     }
                     status = netlink_if_link_populate(ifp, tb, ifi);
                     if (status < 0)
@@ -789,7 +897,7 @@ netlink_reflect_filter(struct sockaddr_nl *snl, struct nlmsghdr *h)
 	 */
 	if (!ifp->vmac) {
 		if_vmac_reflect_flags(ifi->ifi_index, ifi->ifi_flags);
-		ifp->flags = ifi->ifi_flags;
+		if_set_flags(ifp, ifi->ifi_flags);
 	}
 
 	return 0;
@@ -824,6 +932,12 @@ kernel_netlink(thread_t * thread)
 
 	if (thread->type != THREAD_READ_TIMEOUT)
 		netlink_parse_info(netlink_broadcast_filter, nl, NULL);
+
+	/* Address events were dropped, resync the kernel address cache */
+	if (nl_kernel_overrun) {
+		nl_kernel_overrun = 0;
+		netlink_address_lookup();
+	}
 	nl->thread = thread_add_read(master, kernel_netlink, nl, nl->fd,
 				      NETLINK_TIMER);
 	return 0;
@@ -846,8 +960,11 @@ kernel_netlink_init(void)
 		log_message(LOG_INFO, "Registering Kernel netlink reflector");
 		nl_kernel.thread = thread_add_read(master, kernel_netlink, &nl_kernel, nl_kernel.fd,
 						   NETLINK_TIMER);
-	} else
+	} else {
 		log_message(LOG_INFO, "Error while registering Kernel netlink reflector channel");
+		/* Kernel address cache can't be kept in sync */
+		kernel_ipaddr_flush();
+	}
 
 	/* Prepare netlink command channel. */
 	netlink_socket(&nl_cmd, SOCK_NONBLOCK, 0);
@@ -862,4 +979,5 @@ kernel_netlink_close(void)
 {
 	netlink_close(&nl_kernel);
 	netlink_close(&nl_cmd);
+	kernel_ipaddr_flush();
 }
@@ -22,13 +22,24 @@
 
 /* system include */
 #include <ctype.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 /* local include */
 #include "vrrp_notify.h"
+#include "global_data.h"
 #include "memory.h"
 #include "notify.h"
 #include "logger.h"
 
+/* Notification sinks, fed one line per transition */
+static int notify_fifo_fd = -1;
+static int notify_sock_fd = -1;
+static struct sockaddr_un notify_sock_addr;
+static unsigned long notify_dropped;
+
 static char *
 get_iscript(vrrp_t * vrrp, int state)
 {
@@ -165,6 +176,111 @@ notify_script_exec(char* script, char *type, int state_num, char* name, int prio
 	return 1;
 }
 
+static char *
+notify_state_str(int state)
+{
+	switch (state) {
+		case VRRP_STATE_MAST  : return "MASTER";
+		case VRRP_STATE_BACK  : return "BACKUP";
+		case VRRP_STATE_FAULT : return "FAULT";
+	}
+	return "INIT";
+}
+
+void
+vrrp_notify_sink_init(void)
+{
+	struct stat st;
+	char *path;
+
+	/* Opened read-write so that it never blocks and events don't
+	 * fail while no consumer is attached, they wait in the pipe.
+	 */
+	path = global_data->vrrp_notify_fifo;
+	if (path && notify_fifo_fd < 0) {
+		if (mkfifo(path, 0600) < 0 && errno != EEXIST)
+			log_message(LOG_INFO, "Notify FIFO %s: mkfifo error (%s)"
+					    , path, strerror(errno));
+		else if ((notify_fifo_fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0)
+			log_message(LOG_INFO, "Notify FIFO %s: open error (%s)"
+					    , path, strerror(errno));
+		else if (fstat(notify_fifo_fd, &st) < 0 || !S_ISFIFO(st.st_mode)) {
+			log_message(LOG_INFO, "Notify FIFO %s: not a FIFO", path);
+			close(notify_fifo_fd);
+			notify_fifo_fd = -1;
+		}
+	}
+
+	/* The consumer binds the socket, we only send to it */
+	path = global_data->vrrp_notify_socket;
+	if (path && notify_sock_fd < 0) {
+		if (strlen(path) >= sizeof(notify_sock_addr.sun_path)) {
+			log_message(LOG_INFO, "Notify socket %s: path too long", path);
+			return;
+		}
+		memset(&notify_sock_addr, 0, sizeof(notify_sock_addr));
+		notify_sock_addr.sun_family = AF_UNIX;
+		strcpy(notify_sock_addr.sun_path, path);
+		notify_sock_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (notify_sock_fd < 0)
+			log_message(LOG_INFO, "Notify socket %s: socket error (%s)"
+					    , path, strerror(errno));
+	}
+}
+
+void
+vrrp_notify_sink_close(void)
+{
+	if (notify_fifo_fd >= 0)
+		close(notify_fifo_fd);
+	if (notify_sock_fd >= 0)
+		close(notify_sock_fd);
+	notify_fifo_fd = -1;
+	notify_sock_fd = -1;
+}
+
+/*
+ * One line per event:
+ *
+ *   {GROUP|INSTANCE} "NAME" NEW_STATE PRIO OLD_STATE SEC.USEC
+ *
+ * The first fields are those given to the generic notify script.
+ * Events a slow consumer has no room for are dropped, never waited for.
+ */
+static void
+notify_sink_send(char *type, char *name, int state, int prio, int old_state)
+{
+	char buf[VRRP_NOTIFY_SINK_BUFSIZE];
+	struct timeval tv;
+	int len, dropped = 0;
+
+	if (notify_fifo_fd < 0 && notify_sock_fd < 0)
+		return;
+
+	gettimeofday(&tv, NULL);
+	len = snprintf(buf, sizeof(buf), "%s \"%s\" %s %d %s %ld.%06ld\n"
+				       , type, name, notify_state_str(state), prio
+				       , notify_state_str(old_state)
+				       , (long) tv.tv_sec, (long) tv.tv_usec);
+	if (len >= (int) sizeof(buf))
+		return;
+
+	if (notify_fifo_fd >= 0 && write(notify_fifo_fd, buf, len) != len)
+		dropped++;
+	if (notify_sock_fd >= 0 &&
+	    sendto(notify_sock_fd, buf, len, 0, (struct sockaddr *) &notify_sock_addr,
+		   sizeof(notify_sock_addr)) != len)
+		dropped++;
+
+	/* Log the first drop of a run only */
+	if (dropped && !notify_dropped++)
+		log_message(LOG_INFO, "Notify sink: consumer not keeping up, dropping events");
+	else if (!dropped && notify_dropped) {
+		log_message(LOG_INFO, "Notify sink: %lu events dropped", notify_dropped);
+		notify_dropped = 0;
+	}
+}
+
 int
 notify_instance_exec(vrrp_t * vrrp, int state)
 {
@@ -172,6 +288,10 @@ notify_instance_exec(vrrp_t * vrrp, int state)
 	char *gscript = get_igscript(vrrp);
 	int ret = 0;
 
+	notify_sink_send("INSTANCE", vrrp->iname, state, vrrp->effective_priority,
+			 vrrp->notify_state);
+	vrrp->notify_state = state;
+
 	/* Launch the notify_* script */
 	if (script && script_open(script)) {
 		notify_exec(script);
@@ -195,6 +315,9 @@ notify_group_exec(vrrp_sgroup_t * vgroup, int state)
 	char *gscript = get_ggscript(vgroup);
 	int ret = 0;
 
+	notify_sink_send("GROUP", vgroup->gname, state, 0, vgroup->notify_state);
+	vgroup->notify_state = state;
+
 	/* Launch the notify_* script */
 	if (script && script_open(script)) {
 		notify_exec(script);
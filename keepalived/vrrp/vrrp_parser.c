@@ -28,6 +28,7 @@
 #include "vrrp_index.h"
 #include "vrrp_if.h"
 #include "vrrp_vmac.h"
+#include "vrrp_track_native.h"
 #include "vrrp.h"
 #include "global_data.h"
 #include "global_parser.h"
@@ -508,7 +509,57 @@ static void
 vrrp_vscript_script_handler(vector_t *strvec)
 {
 	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	FREE_PTR(vscript->script);
 	vscript->script = set_value(strvec);
+	vscript->type = VRRP_SCRIPT_TYPE_EXEC;
+}
+static void
+vrrp_vscript_process_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_PROCESS, strvec);
+}
+static void
+vrrp_vscript_pidfile_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_PIDFILE, strvec);
+}
+static void
+vrrp_vscript_file_exists_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_FILE, strvec);
+}
+static void
+vrrp_vscript_file_missing_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_NOFILE, strvec);
+}
+static void
+vrrp_vscript_file_mtime_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_MTIME, strvec);
+}
+static void
+vrrp_vscript_tcp_connect_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_TCP, strvec);
+}
+static void
+vrrp_vscript_udp_connect_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_UDP, strvec);
+}
+static void
+vrrp_vscript_http_get_handler(vector_t *strvec)
+{
+	vrrp_script_t *vscript = LIST_TAIL_DATA(vrrp_data->vrrp_script);
+	vrrp_native_parse(vscript, VRRP_SCRIPT_TYPE_HTTP, strvec);
 }
 static void
 vrrp_vscript_interval_handler(vector_t *strvec)
@@ -634,6 +685,14 @@ vrrp_init_keywords(void)
 	install_sublevel_end();
 	install_keyword_root("vrrp_script", &vrrp_script_handler);
 	install_keyword("script", &vrrp_vscript_script_handler);
+	install_keyword("process", &vrrp_vscript_process_handler);
+	install_keyword("pidfile", &vrrp_vscript_pidfile_handler);
+	install_keyword("file_exists", &vrrp_vscript_file_exists_handler);
+	install_keyword("file_missing", &vrrp_vscript_file_missing_handler);
+	install_keyword("file_mtime", &vrrp_vscript_file_mtime_handler);
+	install_keyword("tcp_connect", &vrrp_vscript_tcp_connect_handler);
+	install_keyword("udp_connect", &vrrp_vscript_udp_connect_handler);
+	install_keyword("http_get", &vrrp_vscript_http_get_handler);
 	install_keyword("interval", &vrrp_vscript_interval_handler);
 	install_keyword("timeout", &vrrp_vscript_timeout_handler);
 	install_keyword("weight", &vrrp_vscript_weight_handler);
@@ -30,6 +30,7 @@
 #include "vrrp_netlink.h"
 #include "vrrp_data.h"
 #include "vrrp_index.h"
+#include "vrrp_track_native.h"
 #include "ipvswrapper.h"
 #include "memory.h"
 #include "notify.h"
@@ -226,11 +227,20 @@ vrrp_init_state(list l)
 				       vrrp->iname);
 			}
 		} else {
-			/* Register new priority update thread */
+			/* Schedule the initial priority computation */
 			thread_add_timer(master, vrrp_update_priority,
 					 vrrp, vrrp->adver_int);
 		}
 
+		/* Link tracked objects back to us */
+		vrrp_track_link(vrrp);
+
+		/* Carried over a reload, carry on where we were */
+		if (vrrp->reload_kept) {
+			vrrp_set_state(vrrp, vrrp->init_state);
+			continue;
+		}
+
 		if (vrrp->wantstate == VRRP_STATE_MAST) {
 #ifdef _HAVE_IPVS_SYNCD_
 			/* Check if sync daemon handling is needed */
@@ -239,7 +249,7 @@ vrrp_init_state(list l)
 					       vrrp->lvs_syncd_if, IPVS_MASTER,
 					       vrrp->vrid);
 #endif
-			vrrp->state = VRRP_STATE_GOTO_MASTER;
+			vrrp_set_state(vrrp, VRRP_STATE_GOTO_MASTER);
 		} else {
 			vrrp->ms_down_timer = 3 * vrrp->adver_int
 			    + VRRP_TIMER_SKEW(vrrp);
@@ -250,12 +260,12 @@ vrrp_init_state(list l)
 					       vrrp->lvs_syncd_if, IPVS_BACKUP,
 					       vrrp->vrid);
 #endif
-			log_message(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE",
+			log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE",
 			       vrrp->iname);
 
 			/* Set BACKUP state */
 			vrrp_restore_interface(vrrp, 0);
-			vrrp->state = VRRP_STATE_BACK;
+			vrrp_set_state(vrrp, VRRP_STATE_BACK);
 			vrrp_smtp_notifier(vrrp);
 			notify_instance_exec(vrrp, VRRP_STATE_BACK);
 #ifdef _WITH_SNMP_
@@ -286,7 +296,8 @@ vrrp_init_sands(list l)
 
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		vrrp = ELEMENT_DATA(e);
-		vrrp_init_instance_sands(vrrp);
+		if (!vrrp->reload_kept)
+			vrrp_init_instance_sands(vrrp);
 	}
 }
 
@@ -392,6 +403,12 @@ vrrp_register_workers(list l)
 	if (!LIST_ISEMPTY(vrrp_data->vrrp_script))
 		vrrp_init_script(vrrp_data->vrrp_script);
 
+	/* Init VRRP sync groups member counters */
+	if (!LIST_ISEMPTY(vrrp_data->vrrp_sync_group)) {
+		for (e = LIST_HEAD(vrrp_data->vrrp_sync_group); e; ELEMENT_NEXT(e))
+			vrrp_sync_init_group(ELEMENT_DATA(e));
+	}
+
 	/* Register VRRP workers threads */
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		sock = ELEMENT_DATA(e);
@@ -409,21 +426,24 @@ vrrp_register_workers(list l)
 }
 
 /* VRRP dispatcher functions */
-static int
+static sock_t *
 already_exist_sock(list l, sa_family_t family, int proto, int ifindex, int unicast)
 {
 	sock_t *sock;
 	element e;
 
+	if (LIST_ISEMPTY(l))
+		return NULL;
+
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		sock = ELEMENT_DATA(e);
 		if ((sock->family == family)	&&
 		    (sock->proto == proto)	&&
 		    (sock->ifindex == ifindex)	&&
 		    (sock->unicast == unicast))
-			return 1;
+			return sock;
 	}
-	return 0;
+	return NULL;
 }
 
 void
@@ -464,6 +484,33 @@ vrrp_create_sockpool(list l)
 	}
 }
 
+/* On reload, take over the descriptors of the same socket in the
+ * previous pool rather than closing and reopening it. Group
+ * memberships and pending packets are kept that way.
+ */
+static int
+vrrp_adopt_sock(sock_t *sock)
+{
+	sock_t *old_sock;
+
+	if (!reload || !old_vrrp_data)
+		return 0;
+
+	old_sock = already_exist_sock(old_vrrp_data->vrrp_socket_pool, sock->family,
+				      sock->proto, sock->ifindex, sock->unicast);
+	if (!old_sock || old_sock->fd_in == -1)
+		return 0;
+
+	/* Its read thread would share our fd */
+	thread_cancel(old_sock->thread);
+	old_sock->thread = NULL;
+
+	sock->fd_in = old_sock->fd_in;
+	sock->fd_out = old_sock->fd_out;
+	old_sock->fd_in = old_sock->fd_out = -1;
+	return 1;
+}
+
 static void
 vrrp_open_sockpool(list l)
 {
@@ -472,6 +519,9 @@ vrrp_open_sockpool(list l)
 
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		sock = ELEMENT_DATA(e);
+		if (vrrp_adopt_sock(sock))
+			continue;
+
 		sock->fd_in = open_vrrp_socket(sock->family, sock->proto,
 					       sock->ifindex, sock->unicast);
 		if (sock->fd_in == -1)
@@ -577,11 +627,11 @@ vrrp_backup(vrrp_t * vrrp, char *buffer, int len)
 
 	if (!VRRP_ISUP(vrrp)) {
 		vrrp_log_int_down(vrrp);
-		log_message(LOG_INFO, "VRRP_Instance(%s) Now in FAULT state",
+		log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Now in FAULT state",
 		       vrrp->iname);
 		if (vrrp->state != VRRP_STATE_FAULT) {
 			notify_instance_exec(vrrp, VRRP_STATE_FAULT);
-			vrrp->state = VRRP_STATE_FAULT;
+			vrrp_set_state(vrrp, VRRP_STATE_FAULT);
 #ifdef _WITH_SNMP_
 			vrrp_snmp_instance_trap(vrrp);
 #endif
@@ -614,7 +664,7 @@ vrrp_become_master(vrrp_t * vrrp, char *buffer, int len)
 	}
 
 	/* Then jump to master state */
-	vrrp->wantstate = VRRP_STATE_MAST;
+	vrrp_set_wantstate(vrrp, VRRP_STATE_MAST);
 	vrrp_state_goto_master(vrrp);
 }
 
@@ -623,7 +673,7 @@ vrrp_leave_master(vrrp_t * vrrp, char *buffer, int len)
 {
 	if (!VRRP_ISUP(vrrp)) {
 		vrrp_log_int_down(vrrp);
-		vrrp->wantstate = VRRP_STATE_GOTO_FAULT;
+		vrrp_set_wantstate(vrrp, VRRP_STATE_GOTO_FAULT);
 		vrrp_state_leave_master(vrrp);
 	} else if (vrrp_state_master_rx(vrrp, buffer, len)) {
 		vrrp_state_leave_master(vrrp);
@@ -640,7 +690,7 @@ vrrp_ah_sync(vrrp_t *vrrp)
 	 */
 	log_message(LOG_INFO, "VRRP_Instance(%s) in FAULT state jump to AH sync",
 	       vrrp->iname);
-	vrrp->wantstate = VRRP_STATE_BACK;
+	vrrp_set_wantstate(vrrp, VRRP_STATE_BACK);
 	vrrp_state_leave_master(vrrp);
 }
 
@@ -667,9 +717,9 @@ vrrp_leave_fault(vrrp_t * vrrp, char *buffer, int len)
 	} else {
 		if (vrrp->sync) {
 			if (vrrp_sync_leave_fault(vrrp)) {
-				log_message(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE",
+				log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE",
 				       vrrp->iname);
-				vrrp->state = VRRP_STATE_BACK;
+				vrrp_set_state(vrrp, VRRP_STATE_BACK);
 				vrrp_smtp_notifier(vrrp);
 				notify_instance_exec(vrrp, VRRP_STATE_BACK);
 #ifdef _WITH_SNMP_
@@ -678,9 +728,9 @@ vrrp_leave_fault(vrrp_t * vrrp, char *buffer, int len)
 				vrrp->last_transition = timer_now();
 			}
 		} else {
-			log_message(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE",
+			log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Entering BACKUP STATE",
 			       vrrp->iname);
-			vrrp->state = VRRP_STATE_BACK;
+			vrrp_set_state(vrrp, VRRP_STATE_BACK);
 			vrrp_smtp_notifier(vrrp);
 			notify_instance_exec(vrrp, VRRP_STATE_BACK);
 #ifdef _WITH_SNMP_
@@ -696,11 +746,11 @@ vrrp_goto_master(vrrp_t * vrrp)
 {
 	if (!VRRP_ISUP(vrrp)) {
 		vrrp_log_int_down(vrrp);
-		log_message(LOG_INFO, "VRRP_Instance(%s) Now in FAULT state",
+		log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Now in FAULT state",
 		       vrrp->iname);
 		if (vrrp->state != VRRP_STATE_FAULT)
 			notify_instance_exec(vrrp, VRRP_STATE_FAULT);
-		vrrp->state = VRRP_STATE_FAULT;
+		vrrp_set_state(vrrp, VRRP_STATE_FAULT);
 		vrrp->ms_down_timer = 3 * vrrp->adver_int + VRRP_TIMER_SKEW(vrrp);
 		notify_instance_exec(vrrp, VRRP_STATE_FAULT);
 #ifdef _WITH_SNMP_
@@ -715,7 +765,7 @@ vrrp_goto_master(vrrp_t * vrrp)
 		}
 
 		/* handle master state transition */
-		vrrp->wantstate = VRRP_STATE_MAST;
+		vrrp_set_wantstate(vrrp, VRRP_STATE_MAST);
 		vrrp_state_goto_master(vrrp);
 	}
 }
@@ -732,42 +782,27 @@ vrrp_gratuitous_arp_thread(thread_t * thread)
 	return 0;
 }
 
-/* Update VRRP effective priority based on multiple checkers.
- * This is a thread which is executed every adver_int.
+/* Compute the initial VRRP effective priority from tracked objects.
+ * Runs once, one adver_int after startup, further interface and script
+ * transitions are pushed incrementally by vrrp_track.
  */
 static int
 vrrp_update_priority(thread_t * thread)
 {
 	vrrp_t *vrrp = THREAD_ARG(thread);
-	int prio_offset, new_prio;
 
-	/* compute prio_offset right here */
-	prio_offset = 0;
+	vrrp->prio_offset = 0;
 
 	/* Now we will sum the weights of all interfaces which are tracked. */
-	if ((!vrrp->sync || vrrp->sync->global_tracking) && !LIST_ISEMPTY(vrrp->track_ifp))
-		 prio_offset += vrrp_tracked_weight(vrrp->track_ifp);
+	if (!LIST_ISEMPTY(vrrp->track_ifp))
+		vrrp->prio_offset += vrrp_tracked_weight(vrrp->track_ifp);
 
 	/* Now we will sum the weights of all scripts which are tracked. */
-	if ((!vrrp->sync || vrrp->sync->global_tracking) && !LIST_ISEMPTY(vrrp->track_script))
-		prio_offset += vrrp_script_weight(vrrp->track_script);
+	if (!LIST_ISEMPTY(vrrp->track_script))
+		vrrp->prio_offset += vrrp_script_weight(vrrp->track_script);
 
-	if (vrrp->base_priority == VRRP_PRIO_OWNER) {
-		/* we will not run a PRIO_OWNER into a non-PRIO_OWNER */
-		vrrp->effective_priority = VRRP_PRIO_OWNER;
-	} else {
-		/* WARNING! we must compute new_prio on a signed int in order
-		   to detect overflows and avoid wrapping. */
-		new_prio = vrrp->base_priority + prio_offset;
-		if (new_prio < 1)
-			new_prio = 1;
-		else if (new_prio > 254)
-			new_prio = 254;
-		vrrp->effective_priority = new_prio;
-	}
-
-	/* Register next priority update thread */
-	thread_add_timer(master, vrrp_update_priority, vrrp, vrrp->adver_int);
+	vrrp_set_effective_priority(vrrp);
+	vrrp->prio_tracking = 1;
 	return 0;
 }
 
@@ -778,7 +813,7 @@ vrrp_master(vrrp_t * vrrp)
 	if (vrrp->wantstate != VRRP_STATE_GOTO_FAULT) {
 		if (!VRRP_ISUP(vrrp)) {
 			vrrp_log_int_down(vrrp);
-			vrrp->wantstate = VRRP_STATE_GOTO_FAULT;
+			vrrp_set_wantstate(vrrp, VRRP_STATE_GOTO_FAULT);
 		}
 	}
 
@@ -792,10 +827,10 @@ vrrp_master(vrrp_t * vrrp)
 		vrrp_state_leave_master(vrrp);
 
 		if (vrrp->state == VRRP_STATE_BACK)
-			log_message(LOG_INFO, "VRRP_Instance(%s) Now in BACKUP state",
+			log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Now in BACKUP state",
 				    vrrp->iname);
 		if (vrrp->state == VRRP_STATE_FAULT)
-			log_message(LOG_INFO, "VRRP_Instance(%s) Now in FAULT state",
+			log_message_nolimit(LOG_INFO, "VRRP_Instance(%s) Now in FAULT state",
 				    vrrp->iname);
 	} else if (vrrp->state == VRRP_STATE_MAST) {
 		/*
@@ -842,7 +877,7 @@ vrrp_fault(vrrp_t * vrrp)
 	} else {
 		/* Otherwise, we transit to init state */
 		if (vrrp->init_state == VRRP_STATE_BACK) {
-			vrrp->state = VRRP_STATE_BACK;
+			vrrp_set_state(vrrp, VRRP_STATE_BACK);
 			notify_instance_exec(vrrp, VRRP_STATE_BACK);
 #ifdef _WITH_SNMP_
 			vrrp_snmp_instance_trap(vrrp);
@@ -984,6 +1019,10 @@ vrrp_script_thread(thread_t * thread)
 	thread_add_timer(thread->master, vrrp_script_thread, vscript,
 			 vscript->interval);
 
+	/* Built-in trackers don't need a child */
+	if (vscript->type != VRRP_SCRIPT_TYPE_EXEC)
+		return vrrp_native_check(thread->master, vscript);
+
         /* Execute the script in a child process. Parent returns, child doesn't */
 	return system_call_script(thread->master, vrrp_script_child_thread,
 				  vscript, (vscript->timeout) ? vscript->timeout : vscript->interval,
@@ -1002,14 +1041,8 @@ vrrp_script_child_thread(thread_t * thread)
 		pid = THREAD_CHILD_PID(thread);
 
 		/* The child hasn't responded. Kill it off. */
-		if (vscript->result > vscript->rise) {
-			vscript->result--;
-		} else {
-			if (vscript->result == vscript->rise)
-				log_message(LOG_INFO, "VRRP_Script(%s) timed out", vscript->sname);
-			vscript->result = 0;
-		}
-		kill(pid, SIGTERM);
+		vrrp_script_result(vscript, VRRP_SCRIPT_RUN_TIMEOUT);
+		script_kill(thread->master, pid, SIGTERM);
 		thread_add_child(thread->master, vrrp_script_child_timeout_thread,
 				 vscript, pid, 2);
 		return 0;
@@ -1017,29 +1050,9 @@ vrrp_script_child_thread(thread_t * thread)
 
 	wait_status = THREAD_CHILD_STATUS(thread);
 
-	if (WIFEXITED(wait_status)) {
-		int status;
-		status = WEXITSTATUS(wait_status);
-		if (status == 0) {
-			/* success */
-			if (vscript->result < vscript->rise - 1) {
-				vscript->result++;
-			} else {
-				if (vscript->result < vscript->rise)
-					log_message(LOG_INFO, "VRRP_Script(%s) succeeded", vscript->sname);
-				vscript->result = vscript->rise + vscript->fall - 1;
-			}
-		} else {
-			/* failure */
-			if (vscript->result > vscript->rise) {
-				vscript->result--;
-			} else {
-				if (vscript->result >= vscript->rise)
-					log_message(LOG_INFO, "VRRP_Script(%s) failed", vscript->sname);
-				vscript->result = 0;
-			}
-		}
-	}
+	if (WIFEXITED(wait_status))
+		vrrp_script_result(vscript, (WEXITSTATUS(wait_status) == 0) ?
+					    VRRP_SCRIPT_RUN_SUCCESS : VRRP_SCRIPT_RUN_FAILURE);
 
 	return 0;
 }
@@ -1047,21 +1060,11 @@ vrrp_script_child_thread(thread_t * thread)
 static int
 vrrp_script_child_timeout_thread(thread_t * thread)
 {
-	pid_t pid;
-
 	if (thread->type != THREAD_CHILD_TIMEOUT)
 		return 0;
 
 	/* OK, it still hasn't exited. Now really kill it off. */
-	pid = THREAD_CHILD_PID(thread);
-	if (kill(pid, SIGKILL) < 0) {
-		/* Its possible it finished while we're handing this */
-		if (errno != ESRCH)
-			DBG("kill error: %s", strerror(errno));
-		return 0;
-	}
-
-	log_message(LOG_WARNING, "Process [%d] didn't respond to SIGTERM", pid);
+	script_kill(thread->master, THREAD_CHILD_PID(thread), SIGKILL);
 
 	return 0;
 }
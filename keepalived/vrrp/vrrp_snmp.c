@@ -1364,6 +1364,11 @@ static struct variable8 vrrp_vars[] = {
 	{VRRP_SNMP_SCRIPT_RESULT, ASN_INTEGER, RONLY, vrrp_snmp_script, 3, {9, 1, 6}},
 	{VRRP_SNMP_SCRIPT_RISE, ASN_UNSIGNED, RONLY, vrrp_snmp_script, 3, {9, 1, 7}},
 	{VRRP_SNMP_SCRIPT_FALL, ASN_UNSIGNED, RONLY, vrrp_snmp_script, 3, {9, 1, 8}},
+	/* vrrpMemoryTable */
+	{SNMP_MEMORY_CATEGORY, ASN_OCTET_STR, RONLY, snmp_memory, 3, {11, 1, 2}},
+	{SNMP_MEMORY_BYTES, ASN_GAUGE, RONLY, snmp_memory, 3, {11, 1, 3}},
+	{SNMP_MEMORY_BLOCKS, ASN_GAUGE, RONLY, snmp_memory, 3, {11, 1, 4}},
+	{SNMP_MEMORY_ALLOCS, ASN_COUNTER, RONLY, snmp_memory, 3, {11, 1, 5}},
 };
 
 void
@@ -24,6 +24,8 @@
 #include "vrrp_if.h"
 #include "vrrp_notify.h"
 #include "vrrp_data.h"
+#include "vrrp_index.h"
+#include "journal.h"
 #ifdef _WITH_SNMP_
   #include "vrrp_snmp.h"
 #endif
@@ -58,16 +60,7 @@ vrrp_init_instance_sands(vrrp_t * vrrp)
 vrrp_t *
 vrrp_get_instance(char *iname)
 {
-	vrrp_t *vrrp;
-	list l = vrrp_data->vrrp;
-	element e;
-
-	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
-		vrrp = ELEMENT_DATA(e);
-		if (strcmp(vrrp->iname, iname) == 0)
-			return vrrp;
-	}
-	return NULL;
+	return vrrp_index_name_lookup(iname);
 }
 
 /* Set instances group pointer */
@@ -90,22 +83,113 @@ vrrp_sync_set_group(vrrp_sgroup_t *vgroup)
 	}
 }
 
-/* All interface are UP in the same group */
-int
-vrrp_sync_group_up(vrrp_sgroup_t * vgroup)
+/* Member counters. vrrp_sync_init_group() takes the initial census,
+ * every later transition goes through the setters below so that group
+ * decisions never need to walk index_list.
+ */
+#define VRRP_WANTS_MASTER(S)	((S) == VRRP_STATE_GOTO_MASTER || (S) == VRRP_STATE_MAST)
+
+static void
+vrrp_sync_count_state(vrrp_sgroup_t *vgroup, int state, int inc)
+{
+	switch (state) {
+	case VRRP_STATE_MAST:
+		vgroup->nr_master += inc;
+		break;
+	case VRRP_STATE_BACK:
+		vgroup->nr_backup += inc;
+		break;
+	case VRRP_STATE_FAULT:
+		vgroup->nr_fault += inc;
+		break;
+	}
+}
+
+/* Why the instance is moving to state, derived from its context since
+ * every transition funnels through vrrp_set_state() */
+static int
+vrrp_state_reason(vrrp_t * vrrp, int state)
+{
+	if (vrrp->state == VRRP_STATE_INIT)
+		return vrrp->reload_kept ? JOURNAL_REASON_RELOAD : JOURNAL_REASON_STARTUP;
+	if (state == VRRP_STATE_FAULT)
+		return VRRP_ISUP(vrrp) ? JOURNAL_REASON_SYNC_GROUP : JOURNAL_REASON_FAULT;
+	if (vrrp->state == VRRP_STATE_FAULT)
+		return JOURNAL_REASON_FAULT_CLEAR;
+	if (state == VRRP_STATE_BACK)
+		return (vrrp->master_priority >= vrrp->effective_priority) ?
+			JOURNAL_REASON_HIGHER_PRIO : JOURNAL_REASON_SYNC_GROUP;
+	return JOURNAL_REASON_ELECTION;
+}
+
+void
+vrrp_set_state(vrrp_t * vrrp, int state)
+{
+	if (vrrp->state == state)
+		return;
+
+	if (vrrp->sync) {
+		vrrp_sync_count_state(vrrp->sync, vrrp->state, -1);
+		vrrp_sync_count_state(vrrp->sync, state, 1);
+	}
+	journal_record(JOURNAL_VRRP_STATE, vrrp->state, state, vrrp_state_reason(vrrp, state)
+			 , vrrp->effective_priority, vrrp->master_priority, vrrp->vrid
+			 , vrrp->iname, vrrp->ifp ? IF_NAME(vrrp->ifp) : NULL);
+	vrrp->state = state;
+}
+
+void
+vrrp_set_wantstate(vrrp_t * vrrp, int wantstate)
+{
+	if (vrrp->sync)
+		vrrp->sync->nr_want_master += VRRP_WANTS_MASTER(wantstate) -
+					      VRRP_WANTS_MASTER(vrrp->wantstate);
+	vrrp->wantstate = wantstate;
+}
+
+/* Re-evaluate a member health, called by vrrp_track when one of the
+ * interfaces or scripts it depends on changes.
+ */
+void
+vrrp_sync_update_up(vrrp_t * vrrp)
+{
+	int is_up = VRRP_ISUP(vrrp) ? 1 : 0;
+
+	if (is_up == vrrp->sync_up)
+		return;
+	vrrp->sync->nr_up += is_up - vrrp->sync_up;
+	vrrp->sync_up = is_up;
+}
+
+/* Initial census, once instances states and scripts are set */
+void
+vrrp_sync_init_group(vrrp_sgroup_t *vgroup)
 {
 	vrrp_t *vrrp;
 	element e;
-	list l = vgroup->index_list;
-	int is_up = 0;
 
-	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+	vgroup->nr_members = LIST_SIZE(vgroup->index_list);
+	vgroup->nr_up = vgroup->nr_master = vgroup->nr_backup = 0;
+	vgroup->nr_fault = vgroup->nr_want_master = 0;
+
+	if (LIST_ISEMPTY(vgroup->index_list))
+		return;
+
+	for (e = LIST_HEAD(vgroup->index_list); e; ELEMENT_NEXT(e)) {
 		vrrp = ELEMENT_DATA(e);
-		if (VRRP_ISUP(vrrp))
-			is_up++;
+		vrrp->sync_up = VRRP_ISUP(vrrp) ? 1 : 0;
+		vgroup->nr_up += vrrp->sync_up;
+		vrrp_sync_count_state(vgroup, vrrp->state, 1);
+		if (VRRP_WANTS_MASTER(vrrp->wantstate))
+			vgroup->nr_want_master++;
 	}
+}
 
-	if (is_up == LIST_SIZE(vgroup->index_list)) {
+/* All interface are UP in the same group */
+int
+vrrp_sync_group_up(vrrp_sgroup_t * vgroup)
+{
+	if (vgroup->nr_up == vgroup->nr_members) {
 		log_message(LOG_INFO, "Kernel is reporting: Group(%s) UP"
 			       , GROUP_NAME(vgroup));
 		return 1;
@@ -135,8 +219,11 @@ vrrp_sync_leave_fault(vrrp_t * vrrp)
 {
 	vrrp_sgroup_t *vgroup = vrrp->sync;
 
+	/* Caller just found itself UP, make sure we agree */
+	vrrp_sync_update_up(vrrp);
+
 	if (vrrp_sync_group_up(vgroup)) {
-		log_message(LOG_INFO, "VRRP_Group(%s) Leaving FAULT state",
+		log_message_nolimit(LOG_INFO, "VRRP_Group(%s) Leaving FAULT state",
 		       GROUP_NAME(vgroup));
 		return 1;
 	}
@@ -147,26 +234,18 @@ vrrp_sync_leave_fault(vrrp_t * vrrp)
 int
 vrrp_sync_goto_master(vrrp_t * vrrp)
 {
-	vrrp_t *isync;
 	vrrp_sgroup_t *vgroup = vrrp->sync;
-	list l = vgroup->index_list;
-	element e;
+	int others_want;
 
 	if (GROUP_STATE(vgroup) == VRRP_STATE_MAST)
 		return 1;
 	if (GROUP_STATE(vgroup) == VRRP_STATE_GOTO_MASTER)
 		return 1;
 
-        /* Only sync to master if everyone wants to 
+	/* Only sync to master if everyone wants to
 	 * i.e. prefer backup state to avoid thrashing */
-	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
-		isync = ELEMENT_DATA(e);
-		if (isync != vrrp && (isync->wantstate != VRRP_STATE_GOTO_MASTER && 
-		                      isync->wantstate != VRRP_STATE_MAST)) {
-			return 0;	
-		}
-	}
-	return 1;
+	others_want = vgroup->nr_want_master - VRRP_WANTS_MASTER(vrrp->wantstate);
+	return others_want == vgroup->nr_members - 1;
 }
 
 void
@@ -182,7 +261,7 @@ vrrp_sync_master_election(vrrp_t * vrrp)
 	if (GROUP_STATE(vgroup) == VRRP_STATE_FAULT)
 		return;
 
-	log_message(LOG_INFO, "VRRP_Group(%s) Transition to MASTER state",
+	log_message_nolimit(LOG_INFO, "VRRP_Group(%s) Transition to MASTER state",
 	       GROUP_NAME(vgroup));
 
 	/* Perform sync index */
@@ -190,7 +269,7 @@ vrrp_sync_master_election(vrrp_t * vrrp)
 		isync = ELEMENT_DATA(e);
 		if (isync != vrrp && isync->wantstate != VRRP_STATE_GOTO_MASTER) {
 			/* Force a new protocol master election */
-			isync->wantstate = VRRP_STATE_GOTO_MASTER;
+			vrrp_set_wantstate(isync, VRRP_STATE_GOTO_MASTER);
 			log_message(LOG_INFO,
 			       "VRRP_Instance(%s) forcing a new MASTER election",
 			       isync->iname);
@@ -210,14 +289,14 @@ vrrp_sync_backup(vrrp_t * vrrp)
 	if (GROUP_STATE(vgroup) == VRRP_STATE_BACK)
 		return;
 
-	log_message(LOG_INFO, "VRRP_Group(%s) Syncing instances to BACKUP state",
+	log_message_nolimit(LOG_INFO, "VRRP_Group(%s) Syncing instances to BACKUP state",
 	       GROUP_NAME(vgroup));
 
 	/* Perform sync index */
 	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
 		isync = ELEMENT_DATA(e);
 		if (isync != vrrp && isync->state != VRRP_STATE_BACK) {
-			isync->wantstate = VRRP_STATE_BACK;
+			vrrp_set_wantstate(isync, VRRP_STATE_BACK);
 			vrrp_state_leave_master(isync);
 			vrrp_init_instance_sands(isync);
 		}
@@ -243,7 +322,7 @@ vrrp_sync_master(vrrp_t * vrrp)
 	if (!vrrp_sync_goto_master(vrrp))
 		return;
 
-	log_message(LOG_INFO, "VRRP_Group(%s) Syncing instances to MASTER state",
+	log_message_nolimit(LOG_INFO, "VRRP_Group(%s) Syncing instances to MASTER state",
 	       GROUP_NAME(vgroup));
 
 	/* Perform sync index */
@@ -252,7 +331,7 @@ vrrp_sync_master(vrrp_t * vrrp)
 
 		/* Send the higher priority advert on all synced instances */
 		if (isync != vrrp && isync->state != VRRP_STATE_MAST) {
-			isync->wantstate = VRRP_STATE_MAST;
+			vrrp_set_wantstate(isync, VRRP_STATE_MAST);
 			vrrp_state_goto_master(isync);
 			vrrp_init_instance_sands(isync);
 		}
@@ -276,7 +355,7 @@ vrrp_sync_fault(vrrp_t * vrrp)
 	if (GROUP_STATE(vgroup) == VRRP_STATE_FAULT)
 		return;
 
-	log_message(LOG_INFO, "VRRP_Group(%s) Syncing instances to FAULT state",
+	log_message_nolimit(LOG_INFO, "VRRP_Group(%s) Syncing instances to FAULT state",
 	       GROUP_NAME(vgroup));
 
 	/* Perform sync index */
@@ -291,9 +370,9 @@ vrrp_sync_fault(vrrp_t * vrrp)
 		 */
 		if (isync != vrrp && isync->state != VRRP_STATE_FAULT) {
 			if (isync->state == VRRP_STATE_MAST)
-				isync->wantstate = VRRP_STATE_GOTO_FAULT;
+				vrrp_set_wantstate(isync, VRRP_STATE_GOTO_FAULT);
 			if (isync->state == VRRP_STATE_BACK)
-				isync->state = VRRP_STATE_FAULT;
+				vrrp_set_state(isync, VRRP_STATE_FAULT);
 		}
 	}
 	vgroup->state = VRRP_STATE_FAULT;
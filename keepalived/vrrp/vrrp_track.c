@@ -24,6 +24,8 @@
 #include "vrrp_track.h"
 #include "vrrp_if.h"
 #include "vrrp_data.h"
+#include "vrrp.h"
+#include "vrrp_sync.h"
 #include "logger.h"
 #include "memory.h"
 
@@ -233,3 +235,159 @@ vrrp_script_weight(list l)
 
 	return weight;
 }
+
+
+/* Recompute effective priority from base priority and the tracked
+ * weights offset, clamped to the non-owner range.
+ */
+void
+vrrp_set_effective_priority(vrrp_t *vrrp)
+{
+	int new_prio;
+
+	if (vrrp->base_priority == VRRP_PRIO_OWNER) {
+		/* we will not run a PRIO_OWNER into a non-PRIO_OWNER */
+		vrrp->effective_priority = VRRP_PRIO_OWNER;
+		return;
+	}
+
+	/* WARNING! we must compute new_prio on a signed int in order
+	   to detect overflows and avoid wrapping. */
+	new_prio = vrrp->base_priority + vrrp->prio_offset;
+	if (new_prio < 1)
+		new_prio = 1;
+	else if (new_prio > 254)
+		new_prio = 254;
+	vrrp->effective_priority = new_prio;
+}
+
+/* Push an UP/DOWN transition of a tracked object to the instances
+ * depending on it. A positive weight is only counted while UP and a
+ * negative one only while DOWN, so either way the offset moves by
+ * |weight|. Sync group members also get their health re-evaluated.
+ */
+static void
+vrrp_track_push(list l, int was_up, int up)
+{
+	element e;
+	tracking_vrrp_t *tvp;
+	vrrp_t *vrrp;
+	int delta;
+
+	if (was_up == up || LIST_ISEMPTY(l))
+		return;
+
+	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+		tvp = ELEMENT_DATA(e);
+		vrrp = tvp->vrrp;
+
+		if (vrrp->sync)
+			vrrp_sync_update_up(vrrp);
+
+		/* Initial offset not computed yet, it will see this state */
+		if (!tvp->weight || !vrrp->prio_tracking)
+			continue;
+
+		delta = (tvp->weight < 0) ? -tvp->weight : tvp->weight;
+		vrrp->prio_offset += (up) ? delta : -delta;
+		vrrp_set_effective_priority(vrrp);
+	}
+}
+
+static void
+free_tracking_vrrp(void *data)
+{
+	FREE(data);
+}
+
+static void
+vrrp_track_add_link(list *l, vrrp_t *vrrp, int weight)
+{
+	tracking_vrrp_t *tvp;
+
+	if (!*l)
+		*l = alloc_list(free_tracking_vrrp, NULL);
+
+	tvp = (tracking_vrrp_t *) MALLOC(sizeof(tracking_vrrp_t));
+	tvp->weight = weight;
+	tvp->vrrp = vrrp;
+	list_add(*l, tvp);
+}
+
+/* Register the instance on every weighted interface and script it
+ * tracks, so status changes are pushed rather than polled. Sync group
+ * members register on all of them, and on their own interface, since
+ * any of those can change the group health.
+ */
+void
+vrrp_track_link(vrrp_t *vrrp)
+{
+	element e;
+	tracked_if_t *tip;
+	tracked_sc_t *tsc;
+
+	if (vrrp->sync && vrrp->ifp && !vrrp->dont_track_primary)
+		vrrp_track_add_link(&vrrp->ifp->tracking_vrrp, vrrp, 0);
+
+	if (!LIST_ISEMPTY(vrrp->track_ifp)) {
+		for (e = LIST_HEAD(vrrp->track_ifp); e; ELEMENT_NEXT(e)) {
+			tip = ELEMENT_DATA(e);
+			if (tip->weight || vrrp->sync)
+				vrrp_track_add_link(&tip->ifp->tracking_vrrp, vrrp, tip->weight);
+		}
+	}
+
+	if (!LIST_ISEMPTY(vrrp->track_script)) {
+		for (e = LIST_HEAD(vrrp->track_script); e; ELEMENT_NEXT(e)) {
+			tsc = ELEMENT_DATA(e);
+			if (tsc->weight || vrrp->sync)
+				vrrp_track_add_link(&tsc->scr->tracking_vrrp, vrrp, tsc->weight);
+		}
+	}
+}
+
+/* Interface flags or linkbeat changed */
+void
+vrrp_track_if_changed(interface_t *ifp, int was_up)
+{
+	vrrp_track_push(ifp->tracking_vrrp, was_up, IF_ISUP(ifp));
+}
+
+/* Account for the outcome of a script run, success moves result up
+ * towards rise+fall-1, failure and timeout move it down to 0.
+ */
+static void
+vrrp_script_result_update(vrrp_script_t *vscript, int run)
+{
+	if (run == VRRP_SCRIPT_RUN_SUCCESS) {
+		if (vscript->result < vscript->rise - 1) {
+			vscript->result++;
+		} else {
+			if (vscript->result < vscript->rise)
+				log_message(LOG_INFO, "VRRP_Script(%s) succeeded", vscript->sname);
+			vscript->result = vscript->rise + vscript->fall - 1;
+		}
+		return;
+	}
+
+	if (vscript->result > vscript->rise) {
+		vscript->result--;
+	} else {
+		if (run == VRRP_SCRIPT_RUN_TIMEOUT) {
+			if (vscript->result == vscript->rise)
+				log_message(LOG_INFO, "VRRP_Script(%s) timed out", vscript->sname);
+		} else if (vscript->result >= vscript->rise)
+			log_message(LOG_INFO, "VRRP_Script(%s) failed", vscript->sname);
+		vscript->result = 0;
+	}
+}
+
+void
+vrrp_script_result(vrrp_script_t *vscript, int run)
+{
+	int was_up = vscript->result >= vscript->rise;
+
+	vrrp_script_result_update(vscript, run);
+	vrrp_track_push(vscript->tracking_vrrp, was_up,
+			vscript->result >= vscript->rise);
+}
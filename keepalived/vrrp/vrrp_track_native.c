@@ -0,0 +1,373 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Built-in vrrp_script trackers. Common checks (process
+ *              running, file present or fresh, local TCP/UDP port,
+ *              HTTP status) evaluated in the VRRP process, without a
+ *              fork/exec per interval.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2015 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+
+/* system includes */
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <dirent.h>
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+/* local includes */
+#include "vrrp_track_native.h"
+#include "memory.h"
+#include "logger.h"
+#include "utils.h"
+
+/* Parse the arguments of a built-in tracker keyword */
+void
+vrrp_native_parse(vrrp_script_t *vscript, int type, vector_t *strvec)
+{
+	int argc = vector_size(strvec) - 1;
+	int i, len = 0, ok = 0;
+	char *arg;
+
+	/* Keep the whole line as command, for dumps and SNMP */
+	for (i = 0; i < vector_size(strvec); i++)
+		len += strlen(vector_slot(strvec, i)) + 1;
+	FREE_PTR(vscript->script);
+	vscript->script = (char *) MALLOC(len);
+	for (i = 0; i < vector_size(strvec); i++) {
+		if (i)
+			strcat(vscript->script, " ");
+		strcat(vscript->script, vector_slot(strvec, i));
+	}
+
+	FREE_PTR(vscript->path);
+	vscript->path = NULL;
+	vscript->type = type;
+	memset(&vscript->addr, 0, sizeof(vscript->addr));
+
+	switch (type) {
+	case VRRP_SCRIPT_TYPE_PROCESS:
+	case VRRP_SCRIPT_TYPE_PIDFILE:
+	case VRRP_SCRIPT_TYPE_FILE:
+	case VRRP_SCRIPT_TYPE_NOFILE:
+		ok = (argc == 1);
+		break;
+	case VRRP_SCRIPT_TYPE_MTIME:
+		ok = (argc == 2 && (vscript->max_age = atol(vector_slot(strvec, 2))) > 0);
+		break;
+	case VRRP_SCRIPT_TYPE_TCP:
+	case VRRP_SCRIPT_TYPE_UDP:
+		ok = (argc == 2 && !inet_stosockaddr(vector_slot(strvec, 1),
+						     vector_slot(strvec, 2),
+						     &vscript->addr));
+		break;
+	case VRRP_SCRIPT_TYPE_HTTP:
+		ok = (argc >= 2 && argc <= 4 &&
+		      !inet_stosockaddr(vector_slot(strvec, 1),
+					vector_slot(strvec, 2), &vscript->addr));
+		vscript->http_status = (argc == 4) ? atoi(vector_slot(strvec, 4)) : 0;
+		break;
+	}
+
+	if (!ok) {
+		log_message(LOG_INFO, "VRRP_Script(%s) invalid '%s', disabling it"
+				    , vscript->sname, vscript->script);
+		vscript->result = VRRP_SCRIPT_STATUS_DISABLED;
+		return;
+	}
+
+	/* Name, file or HTTP path */
+	if (type == VRRP_SCRIPT_TYPE_HTTP)
+		arg = (argc >= 3) ? vector_slot(strvec, 3) : "/";
+	else if (type == VRRP_SCRIPT_TYPE_TCP || type == VRRP_SCRIPT_TYPE_UDP)
+		return;
+	else
+		arg = vector_slot(strvec, 1);
+	vscript->path = (char *) MALLOC(strlen(arg) + 1);
+	strcpy(vscript->path, arg);
+}
+
+/* Same as killall -0: is any process named so ? Names longer than
+ * the kernel command name only compare their first characters.
+ */
+static int
+native_process_running(const char *name)
+{
+	char path[sizeof("/proc//comm") + NAME_MAX];
+	char comm[VRRP_NATIVE_COMM_LEN + 2];
+	size_t name_len = strlen(name);
+	struct dirent *d;
+	DIR *dir;
+	int fd, found = 0;
+	ssize_t len;
+
+	if (name_len > VRRP_NATIVE_COMM_LEN)
+		name_len = VRRP_NATIVE_COMM_LEN;
+
+	dir = opendir("/proc");
+	if (!dir)
+		return 0;
+
+	while (!found && (d = readdir(dir))) {
+		if (d->d_name[0] < '1' || d->d_name[0] > '9')
+			continue;
+
+		snprintf(path, sizeof(path), "/proc/%s/comm", d->d_name);
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		len = read(fd, comm, sizeof(comm) - 1);
+		close(fd);
+		if (len <= 0)
+			continue;
+
+		if (comm[len - 1] == '\n')
+			len--;
+		found = (len == name_len && !strncmp(comm, name, name_len));
+	}
+
+	closedir(dir);
+	return found;
+}
+
+static int
+native_pidfile_running(const char *file)
+{
+	FILE *f;
+	int pid, ret;
+
+	f = fopen(file, "r");
+	if (!f)
+		return 0;
+	ret = fscanf(f, "%d", &pid);
+	fclose(f);
+
+	if (ret != 1 || pid <= 0)
+		return 0;
+	return (!kill(pid, 0) || errno == EPERM);
+}
+
+static int
+native_file_fresh(vrrp_script_t *vscript)
+{
+	struct stat st;
+
+	if (stat(vscript->path, &st) < 0)
+		return 0;
+	return (time(NULL) - st.st_mtime <= vscript->max_age);
+}
+
+static long
+native_timeout(vrrp_script_t *vscript)
+{
+	return (vscript->timeout) ? vscript->timeout : vscript->interval;
+}
+
+/* Release the socket and account the result */
+static void
+native_done(vrrp_script_t *vscript, int run)
+{
+	if (vscript->fd >= 0) {
+		close(vscript->fd);
+		vscript->fd = -1;
+	}
+	vrrp_script_result(vscript, run);
+}
+
+static int
+native_http_thread(thread_t *thread)
+{
+	vrrp_script_t *vscript = THREAD_ARG(thread);
+	ssize_t len;
+	int code;
+
+	if (thread->type == THREAD_READ_TIMEOUT) {
+		native_done(vscript, VRRP_SCRIPT_RUN_TIMEOUT);
+		return 0;
+	}
+
+	len = read(vscript->fd, vscript->resp + vscript->resp_len,
+		   sizeof(vscript->resp) - 1 - vscript->resp_len);
+	if (len < 0 && (errno == EAGAIN || errno == EINTR)) {
+		thread_add_read(thread->master, native_http_thread, vscript,
+				vscript->fd, native_timeout(vscript));
+		return 0;
+	}
+
+	/* Only the status line is of interest */
+	if (len > 0) {
+		vscript->resp_len += len;
+		if (vscript->resp_len < (int) sizeof(vscript->resp) - 1 &&
+		    !memchr(vscript->resp, '\n', vscript->resp_len)) {
+			thread_add_read(thread->master, native_http_thread, vscript,
+					vscript->fd, native_timeout(vscript));
+			return 0;
+		}
+	}
+	vscript->resp[vscript->resp_len] = '\0';
+
+	if (sscanf(vscript->resp, "HTTP/%*d.%*d %d", &code) != 1)
+		native_done(vscript, VRRP_SCRIPT_RUN_FAILURE);
+	else if (vscript->http_status)
+		native_done(vscript, (code == vscript->http_status) ?
+				     VRRP_SCRIPT_RUN_SUCCESS : VRRP_SCRIPT_RUN_FAILURE);
+	else
+		native_done(vscript, (code >= 200 && code < 300) ?
+				     VRRP_SCRIPT_RUN_SUCCESS : VRRP_SCRIPT_RUN_FAILURE);
+	return 0;
+}
+
+static int
+native_connect_thread(thread_t *thread)
+{
+	vrrp_script_t *vscript = THREAD_ARG(thread);
+	char req[512];
+	socklen_t optlen = sizeof(int);
+	int err, len;
+
+	if (thread->type == THREAD_WRITE_TIMEOUT) {
+		native_done(vscript, VRRP_SCRIPT_RUN_TIMEOUT);
+		return 0;
+	}
+
+	if (getsockopt(vscript->fd, SOL_SOCKET, SO_ERROR, &err, &optlen) < 0 || err) {
+		native_done(vscript, VRRP_SCRIPT_RUN_FAILURE);
+		return 0;
+	}
+
+	if (vscript->type == VRRP_SCRIPT_TYPE_TCP) {
+		native_done(vscript, VRRP_SCRIPT_RUN_SUCCESS);
+		return 0;
+	}
+
+	/* HTTP GET */
+	len = snprintf(req, sizeof(req), "GET %s HTTP/1.0\r\nHost: %s\r\n"
+					 "Connection: close\r\n\r\n"
+					 , vscript->path, inet_sockaddrtos(&vscript->addr));
+	if (len >= (int) sizeof(req) ||
+	    send(vscript->fd, req, len, MSG_NOSIGNAL) != len) {
+		native_done(vscript, VRRP_SCRIPT_RUN_FAILURE);
+		return 0;
+	}
+
+	vscript->resp_len = 0;
+	thread_add_read(thread->master, native_http_thread, vscript,
+			vscript->fd, native_timeout(vscript));
+	return 0;
+}
+
+static int
+native_udp_thread(thread_t *thread)
+{
+	vrrp_script_t *vscript = THREAD_ARG(thread);
+	char buf[1];
+
+	/* No port unreachable came back, or the service answered */
+	if (thread->type == THREAD_READ_TIMEOUT ||
+	    recv(vscript->fd, buf, sizeof(buf), MSG_DONTWAIT) >= 0 ||
+	    errno != ECONNREFUSED)
+		native_done(vscript, VRRP_SCRIPT_RUN_SUCCESS);
+	else
+		native_done(vscript, VRRP_SCRIPT_RUN_FAILURE);
+	return 0;
+}
+
+static int
+native_connect(thread_master_t *m, vrrp_script_t *vscript)
+{
+	int udp = (vscript->type == VRRP_SCRIPT_TYPE_UDP);
+	socklen_t addrlen;
+	long wait;
+
+	addrlen = (vscript->addr.ss_family == AF_INET6) ? sizeof(struct sockaddr_in6)
+							: sizeof(struct sockaddr_in);
+	vscript->fd = socket(vscript->addr.ss_family,
+			     (udp ? SOCK_DGRAM : SOCK_STREAM) | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (vscript->fd < 0) {
+		log_message(LOG_INFO, "VRRP_Script(%s) socket error (%s)"
+				    , vscript->sname, strerror(errno));
+		native_done(vscript, VRRP_SCRIPT_RUN_FAILURE);
+		return 0;
+	}
+
+	if (connect(vscript->fd, (struct sockaddr *) &vscript->addr, addrlen) < 0 &&
+	    errno != EINPROGRESS) {
+		native_done(vscript, VRRP_SCRIPT_RUN_FAILURE);
+		return 0;
+	}
+
+	if (!udp) {
+		thread_add_write(m, native_connect_thread, vscript, vscript->fd,
+				 native_timeout(vscript));
+		return 0;
+	}
+
+	/* A closed port answers an empty datagram with port unreachable */
+	if (send(vscript->fd, NULL, 0, 0) < 0) {
+		native_done(vscript, VRRP_SCRIPT_RUN_FAILURE);
+		return 0;
+	}
+	wait = native_timeout(vscript);
+	if (wait > VRRP_NATIVE_UDP_WAIT)
+		wait = VRRP_NATIVE_UDP_WAIT;
+	thread_add_read(m, native_udp_thread, vscript, vscript->fd, wait);
+	return 0;
+}
+
+/* Run a built-in tracker, from vrrp_script_thread() */
+int
+vrrp_native_check(thread_master_t *m, vrrp_script_t *vscript)
+{
+	int up;
+
+	switch (vscript->type) {
+	case VRRP_SCRIPT_TYPE_PROCESS:
+		up = native_process_running(vscript->path);
+		break;
+	case VRRP_SCRIPT_TYPE_PIDFILE:
+		up = native_pidfile_running(vscript->path);
+		break;
+	case VRRP_SCRIPT_TYPE_FILE:
+		up = !access(vscript->path, F_OK);
+		break;
+	case VRRP_SCRIPT_TYPE_NOFILE:
+		up = access(vscript->path, F_OK) < 0;
+		break;
+	case VRRP_SCRIPT_TYPE_MTIME:
+		up = native_file_fresh(vscript);
+		break;
+	case VRRP_SCRIPT_TYPE_TCP:
+	case VRRP_SCRIPT_TYPE_UDP:
+	case VRRP_SCRIPT_TYPE_HTTP:
+		/* Previous check still in progress */
+		if (vscript->fd >= 0)
+			return 0;
+		return native_connect(m, vscript);
+	default:
+		return 0;
+	}
+
+	vrrp_script_result(vscript, up ? VRRP_SCRIPT_RUN_SUCCESS : VRRP_SCRIPT_RUN_FAILURE);
+	return 0;
+}
@@ -30,35 +30,148 @@
 #include "logger.h"
 #include "bitops.h"
 #include "vrrp_if_config.h"
+#include "memory.h"
+#include "timer.h"
 
 #ifdef _HAVE_VRRP_VMAC_
 /* private matter */
 static const char *ll_kind = "macvlan";
 
-static int
-netlink_link_up(vrrp_t *vrrp)
+/* VMAC interfaces requested while parsing, created all at once by
+ * netlink_link_vmac_commit().
+ */
+static list vmac_pending;
+
+static void
+free_vmac_pending(void *data)
 {
-	int status = 1;
-	struct {
-		struct nlmsghdr n;
-		struct ifinfomsg ifi;
-		char buf[256];
-	} req;
+	FREE(data);
+}
 
-	memset(&req, 0, sizeof (req));
-	
-	req.n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifinfomsg));
-	req.n.nlmsg_flags = NLM_F_REQUEST;
-	req.n.nlmsg_type = RTM_NEWLINK;
-	req.ifi.ifi_family = AF_UNSPEC;
-	req.ifi.ifi_index = IF_INDEX(vrrp->ifp);
-	req.ifi.ifi_change |= IFF_UP;
-	req.ifi.ifi_flags |= IFF_UP;
+static void
+netlink_link_up_req(vmac_req_t *req, interface_t *ifp)
+{
+	memset(req, 0, sizeof (vmac_req_t));
+
+	req->n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifinfomsg));
+	req->n.nlmsg_flags = NLM_F_REQUEST;
+	req->n.nlmsg_type = RTM_NEWLINK;
+	req->ifi.ifi_family = AF_UNSPEC;
+	req->ifi.ifi_index = IF_INDEX(ifp);
+	req->ifi.ifi_change |= IFF_UP;
+	req->ifi.ifi_flags |= IFF_UP;
+}
+
+/* Stand-in for a VMAC interface not created yet. The netlink
+ * interface lookup fills in the kernel side once it exists. An
+ * interface_t left by a removed conflicting VMAC is recycled.
+ */
+static interface_t *
+vmac_alloc_interface(interface_t *ifp, char *ifname, u_char *ll_addr, interface_t *base_ifp)
+{
+	if (ifp) {
+		free_list(ifp->tracking_vrrp);
+		if_reset(ifp);
+	}
+	else {
+		ifp = (interface_t *) MALLOC(sizeof(interface_t));
+		if_add_queue(ifp);
+	}
 
-	if (netlink_talk(&nl_cmd, &req.n) < 0)
-		status = -1;
+	strcpy(ifp->ifname, ifname);
+	memcpy(ifp->hw_addr, ll_addr, ETH_ALEN);
+	ifp->hw_addr_len = ETH_ALEN;
+	ifp->hw_type = base_ifp->hw_type;
+	ifp->mtu = base_ifp->mtu;
+	ifp->flags = base_ifp->flags; /* Copy base interface flags */
+	ifp->base_ifindex = base_ifp->ifindex;
+	ifp->vmac = 1;
 
-	return status;
+	return ifp;
+}
+
+/* Point addresses/routes parsed against a pending VMAC to its ifindex */
+static void
+vmac_update_iplist(list l)
+{
+	ip_address_t *ipaddr;
+	element e;
+
+	if (LIST_ISEMPTY(l))
+		return;
+
+	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+		ipaddr = ELEMENT_DATA(e);
+		if (ipaddr->ifp && ipaddr->ifp->vmac)
+			ipaddr->ifa.ifa_index = IF_INDEX(ipaddr->ifp);
+	}
+}
+
+static void
+vmac_update_instances(void)
+{
+	struct sockaddr_in6 *saddr;
+	vrrp_t *vrrp;
+	element e;
+
+	vmac_update_iplist(vrrp_data->static_addresses);
+	for (e = LIST_HEAD(vrrp_data->vrrp); e; ELEMENT_NEXT(e)) {
+		vrrp = ELEMENT_DATA(e);
+		vmac_update_iplist(vrrp->vip);
+		vmac_update_iplist(vrrp->evip);
+
+		/* IPv6 source address scoped to a pending VMAC */
+		saddr = (struct sockaddr_in6 *) &vrrp->saddr;
+		if (vrrp->saddr.ss_family == AF_INET6 && !saddr->sin6_scope_id &&
+		    vrrp->ifp && vrrp->ifp->vmac)
+			saddr->sin6_scope_id = IF_INDEX(vrrp->ifp);
+	}
+}
+
+/* A VMAC failed to be created: move every reference to its stand-in
+ * interface over to the base interface, before the stand-in goes.
+ */
+static void
+vmac_replace_iplist(list l, interface_t *old_ifp, interface_t *new_ifp)
+{
+	ip_address_t *ipaddr;
+	element e;
+
+	if (LIST_ISEMPTY(l))
+		return;
+
+	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+		ipaddr = ELEMENT_DATA(e);
+		if (ipaddr->ifp == old_ifp) {
+			ipaddr->ifp = new_ifp;
+			ipaddr->ifa.ifa_index = IF_INDEX(new_ifp);
+		}
+	}
+}
+
+static void
+vmac_replace_interface(interface_t *old_ifp, interface_t *new_ifp)
+{
+	tracked_if_t *tip;
+	vrrp_t *vrrp;
+	element e, e1;
+
+	vmac_replace_iplist(vrrp_data->static_addresses, old_ifp, new_ifp);
+	for (e = LIST_HEAD(vrrp_data->vrrp); e; ELEMENT_NEXT(e)) {
+		vrrp = ELEMENT_DATA(e);
+		if (vrrp->ifp == old_ifp)
+			vrrp->ifp = new_ifp;
+		vmac_replace_iplist(vrrp->vip, old_ifp, new_ifp);
+		vmac_replace_iplist(vrrp->evip, old_ifp, new_ifp);
+
+		if (LIST_ISEMPTY(vrrp->track_ifp))
+			continue;
+		for (e1 = LIST_HEAD(vrrp->track_ifp); e1; ELEMENT_NEXT(e1)) {
+			tip = ELEMENT_DATA(e1);
+			if (tip->ifp == old_ifp)
+				tip->ifp = new_ifp;
+		}
+	}
 }
 #endif
 
@@ -68,21 +181,20 @@ netlink_link_add_vmac(vrrp_t *vrrp)
 #ifdef _HAVE_VRRP_VMAC_
 	struct rtattr *linkinfo;
 	struct rtattr *data;
-	unsigned int base_ifindex;
 	interface_t *ifp;
-	interface_t *base_ifp;
 	char ifname[IFNAMSIZ];
 	u_char ll_addr[ETH_ALEN] = {0x00, 0x00, 0x5e, 0x00, 0x01, vrrp->vrid};
+	vmac_pending_t *pending;
+	vmac_req_t *req;
 	struct {
 		struct nlmsghdr n;
 		struct ifinfomsg ifi;
 		char buf[256];
-	} req;
+	} del_req;
 
 	if (!vrrp->ifp || __test_bit(VRRP_VMAC_UP_BIT, &vrrp->vmac_flags) || !vrrp->vrid)
 		return -1;
 
-	memset(&req, 0, sizeof (req));
 	memset(ifname, 0, IFNAMSIZ);
 	strncpy(ifname, vrrp->vmac_ifname, IFNAMSIZ - 1);
 
@@ -116,14 +228,14 @@ netlink_link_add_vmac(vrrp_t *vrrp)
 					    , vrrp->vmac_ifname, vrrp->iname);
 
 			/* Request that NETLINK remove the VIF interface first */
-			memset(&req, 0, sizeof (req));
-			req.n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifinfomsg));
-			req.n.nlmsg_flags = NLM_F_REQUEST;
-			req.n.nlmsg_type = RTM_DELLINK;
-			req.ifi.ifi_family = AF_INET;
-			req.ifi.ifi_index = IF_INDEX(ifp);
-
-			if (netlink_talk(&nl_cmd, &req.n) < 0) {
+			memset(&del_req, 0, sizeof (del_req));
+			del_req.n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifinfomsg));
+			del_req.n.nlmsg_flags = NLM_F_REQUEST;
+			del_req.n.nlmsg_type = RTM_DELLINK;
+			del_req.ifi.ifi_family = AF_INET;
+			del_req.ifi.ifi_index = IF_INDEX(ifp);
+
+			if (netlink_talk(&nl_cmd, &del_req.n) < 0) {
 				log_message(LOG_INFO, "vmac: Error removing VMAC interface %s for "
 						      "vrrp_instance %s!!!"
 						    , vrrp->vmac_ifname, vrrp->iname);
@@ -135,62 +247,45 @@ netlink_link_add_vmac(vrrp_t *vrrp)
 	}
 
 	/* Request that NETLINK create the VIF interface */
-	req.n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifinfomsg));
-	req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL;
-	req.n.nlmsg_type = RTM_NEWLINK;
-	req.ifi.ifi_family = AF_INET;
+	pending = (vmac_pending_t *) MALLOC(sizeof(vmac_pending_t));
+	req = &pending->req;
+	req->n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifinfomsg));
+	req->n.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL;
+	req->n.nlmsg_type = RTM_NEWLINK;
+	req->ifi.ifi_family = AF_INET;
 
 	/* macvlan settings */
-	linkinfo = NLMSG_TAIL(&req.n);
-	addattr_l(&req.n, sizeof(req), IFLA_LINKINFO, NULL, 0);
-	addattr_l(&req.n, sizeof(req), IFLA_INFO_KIND, (void *)ll_kind, strlen(ll_kind));
-	data = NLMSG_TAIL(&req.n);
-	addattr_l(&req.n, sizeof(req), IFLA_INFO_DATA, NULL, 0);
+	linkinfo = NLMSG_TAIL(&req->n);
+	addattr_l(&req->n, sizeof(*req), IFLA_LINKINFO, NULL, 0);
+	addattr_l(&req->n, sizeof(*req), IFLA_INFO_KIND, (void *)ll_kind, strlen(ll_kind));
+	data = NLMSG_TAIL(&req->n);
+	addattr_l(&req->n, sizeof(*req), IFLA_INFO_DATA, NULL, 0);
 
 	/*
 	 * In private mode, macvlan will receive frames with same MAC addr
 	 * as configured on the interface.
 	 */
-	addattr32(&req.n, sizeof(req), IFLA_MACVLAN_MODE,
+	addattr32(&req->n, sizeof(*req), IFLA_MACVLAN_MODE,
 		  MACVLAN_MODE_PRIVATE);
-	data->rta_len = (void *)NLMSG_TAIL(&req.n) - (void *)data;
-	linkinfo->rta_len = (void *)NLMSG_TAIL(&req.n) - (void *)linkinfo;
-	addattr_l(&req.n, sizeof(req), IFLA_LINK, &IF_INDEX(vrrp->ifp), sizeof(uint32_t));
-	addattr_l(&req.n, sizeof(req), IFLA_IFNAME, ifname, strlen(ifname));
-	addattr_l(&req.n, sizeof(req), IFLA_ADDRESS, ll_addr, ETH_ALEN);
-
-	if (netlink_talk(&nl_cmd, &req.n) < 0) {
-		log_message(LOG_INFO, "vmac: Error creating VMAC interface %s for vrrp_instance %s!!!"
-				    , ifname, vrrp->iname);
-		return -1;
-	}
-	memcpy(vrrp->ifp->hw_addr, ll_addr, ETH_ALEN);
-
-	log_message(LOG_INFO, "vmac: Success creating VMAC interface %s for vrrp_instance %s"
-			    , ifname, vrrp->iname);
+	data->rta_len = (void *)NLMSG_TAIL(&req->n) - (void *)data;
+	linkinfo->rta_len = (void *)NLMSG_TAIL(&req->n) - (void *)linkinfo;
+	addattr_l(&req->n, sizeof(*req), IFLA_LINK, &IF_INDEX(vrrp->ifp), sizeof(uint32_t));
+	addattr_l(&req->n, sizeof(*req), IFLA_IFNAME, ifname, strlen(ifname));
+	addattr_l(&req->n, sizeof(*req), IFLA_ADDRESS, ll_addr, ETH_ALEN);
 
 	/*
-	 * Update interface queue and vrrp instance interface binding.
-	 * bring it UP !
+	 * Creation is batched with the other instances ones. Until then
+	 * bind the instance to a stand-in interface, so the rest of the
+	 * configuration can refer to it.
 	 */
-	netlink_interface_lookup();
-	ifp = if_get_by_ifname(ifname);
-	if (!ifp)
-		return -1;
-	base_ifp = vrrp->ifp;
-	base_ifindex = vrrp->ifp->ifindex;
-	ifp->flags = vrrp->ifp->flags; /* Copy base interface flags */
-	vrrp->ifp = ifp;
-	vrrp->ifp->base_ifindex = base_ifindex;
-	vrrp->ifp->vmac = 1;
-	vrrp->vmac_ifindex = IF_INDEX(vrrp->ifp); /* For use on delete */
-	__set_bit(VRRP_VMAC_UP_BIT, &vrrp->vmac_flags);
-	netlink_link_up(vrrp);
+	if (!vmac_pending)
+		vmac_pending = alloc_list(free_vmac_pending, NULL);
+	pending->vrrp = vrrp;
+	pending->base_ifp = vrrp->ifp;
+	list_add(vmac_pending, pending);
 
-	if (vrrp->family == AF_INET) {
-		/* Set the necessary kernel parameters to make macvlans work for us */
-		set_interface_parameters(ifp, base_ifp);
-	}
+	vrrp->ifp = vmac_alloc_interface(ifp, ifname, ll_addr, pending->base_ifp);
+	__set_bit(VRRP_VMAC_UP_BIT, &vrrp->vmac_flags);
 #endif
 	return 1;
 }
@@ -235,3 +330,86 @@ netlink_link_del_vmac(vrrp_t *vrrp)
 
 	return status;
 }
+
+/*
+ * Create all VMAC interfaces requested while parsing: one batch of
+ * creation requests, one interface lookup, one batch of link up.
+ */
+void
+netlink_link_vmac_commit(void)
+{
+#ifdef _HAVE_VRRP_VMAC_
+	vmac_pending_t *pending;
+	struct nlmsghdr **msgs;
+	vmac_req_t *up_reqs;
+	interface_t *ifp;
+	timeval_t start;
+	element e;
+	int *status;
+	int i, cnt, up_cnt = 0, created = 0;
+
+	if (LIST_ISEMPTY(vmac_pending))
+		return;
+
+	start = timer_now();
+	cnt = LIST_SIZE(vmac_pending);
+	msgs = (struct nlmsghdr **) MALLOC(cnt * sizeof(struct nlmsghdr *));
+	status = (int *) MALLOC(cnt * sizeof(int));
+	up_reqs = (vmac_req_t *) MALLOC(cnt * sizeof(vmac_req_t));
+
+	for (i = 0, e = LIST_HEAD(vmac_pending); e; ELEMENT_NEXT(e), i++) {
+		pending = ELEMENT_DATA(e);
+		msgs[i] = &pending->req.n;
+	}
+	netlink_talk_batch(&nl_cmd, msgs, cnt, status);
+
+	/* Single lookup fills in every created interface */
+	netlink_interface_lookup();
+
+	for (i = 0, e = LIST_HEAD(vmac_pending); e; ELEMENT_NEXT(e), i++) {
+		pending = ELEMENT_DATA(e);
+		ifp = pending->vrrp->ifp;
+
+		if (status[i] || !ifp->ifindex) {
+			log_message(LOG_INFO, "vmac: Error creating VMAC interface %s for vrrp_instance %s!!!"
+					    , ifp->ifname, pending->vrrp->iname);
+			/* Fall back to the base interface */
+			vmac_replace_interface(ifp, pending->base_ifp);
+			__clear_bit(VRRP_VMAC_UP_BIT, &pending->vrrp->vmac_flags);
+			if_del_queue(ifp);
+			free_list(ifp->tracking_vrrp);
+			FREE(ifp);
+			continue;
+		}
+
+		memcpy(pending->base_ifp->hw_addr, ifp->hw_addr, ETH_ALEN);
+		log_message(LOG_INFO, "vmac: Success creating VMAC interface %s for vrrp_instance %s"
+				    , ifp->ifname, pending->vrrp->iname);
+		pending->vrrp->vmac_ifindex = IF_INDEX(ifp); /* For use on delete */
+		netlink_link_up_req(&up_reqs[up_cnt], ifp);
+		msgs[up_cnt] = &up_reqs[up_cnt].n;
+		up_cnt++;
+		created++;
+
+		if (pending->vrrp->family == AF_INET) {
+			/* Set the necessary kernel parameters to make macvlans work for us */
+			set_interface_parameters(ifp, pending->base_ifp);
+		}
+	}
+
+	/* Bring them all UP */
+	if (up_cnt && netlink_talk_batch(&nl_cmd, msgs, up_cnt, status))
+		log_message(LOG_INFO, "vmac: Error setting some VMAC interfaces UP");
+
+	vmac_update_instances();
+
+	log_message(LOG_INFO, "vmac: %d VMAC interfaces ready in %ld ms"
+			    , created, timer_long(timer_sub(timer_now(), start)) / 1000);
+
+	FREE(msgs);
+	FREE(status);
+	FREE(up_reqs);
+	free_list(vmac_pending);
+	vmac_pending = NULL;
+#endif
+}
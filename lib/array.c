@@ -0,0 +1,112 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Dynamic array manipulation.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@linux-vs.org>
+ */
+
+#include <string.h>
+#include "array.h"
+#include "memory.h"
+
+#define ARRAY_MIN_ALLOC	4
+
+array_t *
+alloc_array(size_t esize, void (*free_func) (void *), void (*dump_func) (void *))
+{
+	array_t *new = (array_t *) MALLOC(sizeof (array_t));
+
+	new->esize = esize;
+	new->free = free_func;
+	new->dump = dump_func;
+	return new;
+}
+
+/* Append a zeroed item and return it. Room grows geometrically so
+ * a sequence of adds costs amortized O(1). Item addresses are only
+ * stable until the next add.
+ */
+void *
+array_add(array_t *a)
+{
+	void *item;
+
+	if (a->count == a->allocated) {
+		unsigned int allocated = a->allocated ? a->allocated * 2 : ARRAY_MIN_ALLOC;
+
+		if (a->data)
+			a->data = REALLOC(a->data, allocated * a->esize);
+		else
+			a->data = MALLOC(allocated * a->esize);
+		a->allocated = allocated;
+	}
+
+	item = ARRAY_ITEM(a, a->count++);
+	memset(item, 0, a->esize);
+	return item;
+}
+
+/* Remove an item, keeping the others in order */
+void
+array_del(array_t *a, unsigned int idx)
+{
+	if (idx >= a->count)
+		return;
+
+	if (a->free)
+		(*a->free) (ARRAY_ITEM(a, idx));
+	a->count--;
+	memmove(ARRAY_ITEM(a, idx), ARRAY_ITEM(a, idx + 1)
+		, (a->count - idx) * a->esize);
+}
+
+void *
+array_item(array_t *a, unsigned int idx)
+{
+	if (!a || idx >= a->count)
+		return NULL;
+	return ARRAY_ITEM(a, idx);
+}
+
+void
+free_array(array_t *a)
+{
+	unsigned int i;
+
+	if (!a)
+		return;
+
+	if (a->free)
+		for (i = 0; i < a->count; i++)
+			(*a->free) (ARRAY_ITEM(a, i));
+	if (a->data)
+		FREE(a->data);
+	FREE(a);
+}
+
+void
+dump_array(array_t *a)
+{
+	unsigned int i;
+
+	if (!a || !a->dump)
+		return;
+
+	for (i = 0; i < a->count; i++)
+		(*a->dump) (ARRAY_ITEM(a, i));
+}
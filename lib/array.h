@@ -0,0 +1,52 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        array.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@linux-vs.org>
+ */
+
+#ifndef _ARRAY_H
+#define _ARRAY_H
+
+#include <stddef.h>
+
+/* Contiguous array of fixed size items, stored by value */
+typedef struct _array {
+	char *data;
+	size_t esize;			/* Size of one item */
+	unsigned int count;		/* Items in use */
+	unsigned int allocated;		/* Items room */
+	void (*free) (void *);		/* Releases item content, not the item */
+	void (*dump) (void *);
+} array_t;
+
+/* utility macro */
+#define ARRAY_COUNT(A)		((A) ? (A)->count : 0)
+#define ARRAY_ITEM(A, I)	((void *) ((A)->data + (size_t) (I) * (A)->esize))
+#define ARRAY_TAIL(A)		(ARRAY_COUNT(A) ? ARRAY_ITEM(A, (A)->count - 1) : NULL)
+#define ARRAY_ISEMPTY(A)	(ARRAY_COUNT(A) == 0)
+
+/* Prototypes */
+extern array_t *alloc_array(size_t esize, void (*free_func) (void *), void (*dump_func) (void *));
+extern void *array_add(array_t *a);
+extern void array_del(array_t *a, unsigned int idx);
+extern void *array_item(array_t *a, unsigned int idx);
+extern void free_array(array_t *a);
+extern void dump_array(array_t *a);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        list_head.h include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@linux-vs.org>
+ */
+
+#ifndef _LIST_HEAD_H
+#define _LIST_HEAD_H
+
+#include <stddef.h>
+
+/*
+ * Intrusive doubly linked circular list. The link is embedded in the
+ * object itself so walking the list touches the objects only, and
+ * insertion/removal need neither an allocation nor a search.
+ */
+typedef struct list_head {
+	struct list_head *next;
+	struct list_head *prev;
+} list_head_t;
+
+/* Helpers */
+#define LIST_HEAD_INITIALIZER(name)	{ &(name), &(name) }
+
+#define list_head_entry(ptr, type, member) \
+	((type *) ((char *) (ptr) - offsetof(type, member)))
+
+#define list_head_first_entry(head, type, member) \
+	list_head_entry((head)->next, type, member)
+
+#define list_head_for_each_entry(pos, head, member)			\
+	for (pos = list_head_entry((head)->next, typeof(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = list_head_entry(pos->member.next, typeof(*pos), member))
+
+/* Safe against removal (and release) of the current entry */
+#define list_head_for_each_entry_safe(pos, n, head, member)		\
+	for (pos = list_head_entry((head)->next, typeof(*pos), member),	\
+	     n = list_head_entry(pos->member.next, typeof(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = n, n = list_head_entry(n->member.next, typeof(*n), member))
+
+static inline void INIT_LIST_HEAD(list_head_t *head)
+{
+	head->next = head;
+	head->prev = head;
+}
+
+static inline int list_head_empty(const list_head_t *head)
+{
+	return head->next == head;
+}
+
+static inline void list_head_add_tail(list_head_t *new, list_head_t *head)
+{
+	new->prev = head->prev;
+	new->next = head;
+	head->prev->next = new;
+	head->prev = new;
+}
+
+static inline void list_head_del(list_head_t *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	entry->next = entry;
+	entry->prev = entry;
+}
+
+#endif
@@ -20,30 +20,228 @@
  * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@linux-vs.org>
  */
 
+/* sendmmsg() is a GNU extension */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "logger.h"
 
 /* Boolean flag - send messages to console as well as syslog */
 static int log_console = 0;
 
+/*
+ * Asynchronous logging.
+ *
+ * Messages are formatted by the daemon into a single producer/single
+ * consumer ring living in shared memory and written out by a small
+ * helper process, so a slow or blocked syslog daemon never stalls the
+ * scheduler. The daemon only ever moves head and the helper only tail.
+ * The helper is woken through a socket when it may have gone to sleep
+ * on an empty ring. When the ring is full messages are dropped and
+ * counted, never waited for.
+ */
+typedef struct _log_record {
+	int			priority;
+	time_t			time;
+	char			msg[LOG_MSG_MAX];
+} log_record_t;
+
+typedef struct _log_ring {
+	unsigned long		head __attribute__ ((aligned (64)));
+	unsigned long		tail __attribute__ ((aligned (64)));
+	log_record_t		rec[LOG_RING_SIZE] __attribute__ ((aligned (64)));
+} log_ring_t;
+
+/* Per call site rate limiting, keyed on the format string */
+typedef struct _log_site {
+	const char		*format;
+	time_t			window;		/* Start of current interval */
+	unsigned int		count;		/* Messages in current interval */
+	unsigned int		suppressed;
+} log_site_t;
+
+static log_ring_t *log_ring = NULL;
+static int log_wake_fd = -1;
+static pid_t log_pid;			/* Process owning the producer side */
+static const char *log_ident;
+static int log_facility;
+static unsigned long log_drop_pending;
+static log_site_t log_sites[LOG_RATE_SITES];
+static unsigned int log_rate_burst = LOG_RATE_BURST;	/* 0 = no rate limiting */
+static unsigned int log_rate_interval = LOG_RATE_INTERVAL;
+static log_stat_t log_stats;
+
 void
 enable_console_log(void)
 {
 	log_console = 1;
 }
 
-void
-vlog_message(const int facility, const char* format, va_list args)
+/* Synchronous output */
+static void
+log_write(int priority, const char *msg)
 {
-	char buf[256];
+	if (log_console) {
+		fprintf(stderr, "%s\n", msg);
+	}
 
-	vsnprintf(buf, sizeof(buf), format, args);
+	syslog(priority, "%s", msg);
+}
 
-	if (log_console) {
-		fprintf(stderr, "%s\n", buf);
+/* Returns -1 if the helper is gone */
+static int
+log_wake(void)
+{
+	char c = 0;
+
+	/* A full socket means the helper has wakeups pending anyway */
+	if (send(log_wake_fd, &c, 1, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+	    errno != EAGAIN && errno != EINTR)
+		return -1;
+	return 0;
+}
+
+static void
+log_helper_lost(void)
+{
+	log_helper_close();
+	log_message(LOG_INFO, "Log helper died, logging synchronously");
+}
+
+/* Queue a message. Returns 0 on success, -1 if the ring is full and
+ * -2 if the helper is gone */
+static int
+log_ring_put(int priority, const char *msg)
+{
+	unsigned long head = log_ring->head;
+	unsigned long tail;
+	log_record_t *rec;
+
+	if (head - __atomic_load_n(&log_ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE)
+		return (log_wake() < 0) ? -2 : -1;
+
+	rec = &log_ring->rec[head & (LOG_RING_SIZE - 1)];
+	rec->priority = priority;
+	rec->time = time(NULL);
+	strncpy(rec->msg, msg, LOG_MSG_MAX - 1);
+	rec->msg[LOG_MSG_MAX - 1] = '\0';
+
+	/* Publish, then wake the helper if it may have seen an empty ring.
+	 * Pairs with the tail store/head load in log_ring_drain() */
+	__atomic_store_n(&log_ring->head, head + 1, __ATOMIC_SEQ_CST);
+	tail = __atomic_load_n(&log_ring->tail, __ATOMIC_SEQ_CST);
+	log_stats.queued++;
+	if (tail == head && log_wake() < 0)
+		return -2;
+
+	return 0;
+}
+
+static void
+log_queue(int priority, const char *msg)
+{
+	char buf[64];
+	int ret = 0;
+
+	if (log_drop_pending) {
+		snprintf(buf, sizeof(buf), "%lu log messages dropped", log_drop_pending);
+		ret = log_ring_put(LOG_WARNING, buf);
+		if (!ret)
+			log_drop_pending = 0;
 	}
 
-	syslog(facility, "%s", buf);
+	if (!ret)
+		ret = log_ring_put(priority, msg);
+	if (!ret)
+		return;
+
+	log_drop_pending++;
+	log_stats.dropped++;
+	if (ret == -2)
+		log_helper_lost();
+}
+
+static void
+log_output(int priority, const char *msg)
+{
+	/* Processes forked from us (script helper, scripts) log directly */
+	if (log_ring && getpid() == log_pid)
+		log_queue(priority, msg);
+	else
+		log_write(priority, msg);
+}
+
+/* Returns 1 if a message from this call site is to be suppressed.
+ * The number of suppressed messages is reported by the first message
+ * the site logs in a later interval. Warnings and worse always get
+ * through.
+ */
+static int
+log_rate_limit(int priority, const char *format)
+{
+	unsigned int i = ((uintptr_t) format >> 3) & (LOG_RATE_SITES - 1);
+	unsigned int n;
+	log_site_t *site;
+	char buf[LOG_MSG_MAX];
+	time_t now;
+
+	if (!log_rate_burst || LOG_PRI(priority) <= LOG_WARNING)
+		return 0;
+
+	for (n = 0; n < LOG_RATE_SITES; n++, i = (i + 1) & (LOG_RATE_SITES - 1)) {
+		site = &log_sites[i];
+		if (site->format == format)
+			break;
+		if (!site->format) {
+			site->format = format;
+			break;
+		}
+	}
+	if (n == LOG_RATE_SITES)
+		return 0;
+
+	now = time(NULL);
+	if (now - site->window >= log_rate_interval) {
+		if (site->suppressed) {
+			snprintf(buf, sizeof(buf), "%u messages suppressed like: %s"
+					 , site->suppressed, format);
+			log_output(priority, buf);
+		}
+		site->window = now;
+		site->count = 0;
+		site->suppressed = 0;
+	}
+
+	if (++site->count <= log_rate_burst)
+		return 0;
+
+	site->suppressed++;
+	log_stats.limited++;
+	return 1;
+}
+
+void
+vlog_message(const int facility, const char* format, va_list args)
+{
+	char buf[LOG_MSG_MAX];
+
+	if (log_rate_limit(facility, format))
+		return;
+
+	vsnprintf(buf, sizeof(buf), format, args);
+	log_output(facility, buf);
 }
 
 void
@@ -55,3 +253,241 @@ log_message(const int facility, const char *format, ...)
 	vlog_message(facility, format, args);
 	va_end(args);
 }
+
+/* For call sites whose every message matters, such as state
+ * transitions, which one format logs for every instance.
+ */
+void
+log_message_nolimit(const int facility, const char *format, ...)
+{
+	char buf[LOG_MSG_MAX];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	log_output(facility, buf);
+}
+
+/* Rate limiting settings from the configuration, burst 0 disables it */
+void
+log_rate_set(unsigned int burst, unsigned int interval)
+{
+	log_rate_burst = burst;
+	log_rate_interval = interval;
+}
+
+/* Helper side. Records are sent to the syslog socket directly so the
+ * messages carry the daemon pid and the time they were logged, a batch
+ * per sendmmsg(). syslog() is the fallback if the socket is unusable.
+ */
+static int
+log_helper_connect(void)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, _PATH_LOG, sizeof(addr.sun_path) - 1);
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void
+log_helper_flush(int *fd, log_record_t **batch, unsigned int nr)
+{
+	static char buf[LOG_BATCH][LOG_MSG_MAX + 64];
+	struct mmsghdr msgs[LOG_BATCH];
+	struct iovec iov[LOG_BATCH];
+	char stamp[32];
+	struct tm tm;
+	unsigned int i, sent = 0;
+	int priority, ret, len;
+
+	for (i = 0; i < nr; i++) {
+		if (log_console)
+			fprintf(stderr, "%s\n", batch[i]->msg);
+
+		priority = batch[i]->priority;
+		if (!(priority & LOG_FACMASK))
+			priority |= log_facility;
+		localtime_r(&batch[i]->time, &tm);
+		strftime(stamp, sizeof(stamp), "%h %e %T", &tm);
+		len = snprintf(buf[i], sizeof(buf[i]), "<%d>%s %s[%d]: %s"
+				     , priority, stamp, log_ident, log_pid, batch[i]->msg);
+		if (len >= (int) sizeof(buf[i]))
+			len = sizeof(buf[i]) - 1;
+
+		iov[i].iov_base = buf[i];
+		iov[i].iov_len = len;
+		memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (sent < nr) {
+		if (*fd < 0 && (*fd = log_helper_connect()) < 0)
+			break;
+		ret = sendmmsg(*fd, msgs + sent, nr - sent, 0);
+		if (ret > 0) {
+			sent += ret;
+			continue;
+		}
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		/* syslog daemon restarted or gone, reconnect once */
+		close(*fd);
+		*fd = log_helper_connect();
+		if (*fd < 0 || sendmmsg(*fd, msgs + sent, 1, 0) != 1)
+			break;
+		sent++;
+	}
+
+	for (i = sent; i < nr; i++)
+		syslog(batch[i]->priority, "%s", batch[i]->msg);
+}
+
+static void
+log_ring_drain(int *fd)
+{
+	log_record_t *batch[LOG_BATCH];
+	unsigned long tail = log_ring->tail;
+	unsigned long head;
+	unsigned int nr;
+
+	for (;;) {
+		head = __atomic_load_n(&log_ring->head, __ATOMIC_SEQ_CST);
+		if (head == tail)
+			break;
+
+		while (tail != head) {
+			for (nr = 0; nr < LOG_BATCH && tail != head; nr++, tail++)
+				batch[nr] = &log_ring->rec[tail & (LOG_RING_SIZE - 1)];
+			log_helper_flush(fd, batch, nr);
+		}
+		__atomic_store_n(&log_ring->tail, tail, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void
+log_helper_main(int wake_fd)
+{
+	char buf[256];
+	ssize_t len;
+	int fd;
+
+	/* Keep draining until the daemon closes its end, so whatever it
+	 * logged on the way out still makes it to syslog */
+	signal(SIGHUP, SIG_IGN);
+	signal(SIGINT, SIG_IGN);
+	signal(SIGTERM, SIG_IGN);
+	signal(SIGUSR1, SIG_IGN);
+	signal(SIGUSR2, SIG_IGN);
+
+	fd = log_helper_connect();
+	for (;;) {
+		log_ring_drain(&fd);
+		len = read(wake_fd, buf, sizeof(buf));
+		if (len == 0)
+			break;
+		if (len < 0 && errno != EINTR)
+			break;
+	}
+
+	log_ring_drain(&fd);
+	exit(0);
+}
+
+/* Move logging of the calling process to a writer process. ident and
+ * facility are the ones passed to openlog(). On failure logging simply
+ * stays synchronous.
+ */
+void
+log_helper_init(const char *ident, int facility)
+{
+	int fds[2];
+	pid_t pid;
+
+	if (log_ring)
+		return;
+
+	log_ring = mmap(NULL, sizeof(log_ring_t), PROT_READ | PROT_WRITE
+				, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (log_ring == MAP_FAILED) {
+		log_ring = NULL;
+		log_message(LOG_INFO, "Log helper: mmap error (%s), logging synchronously"
+				    , strerror(errno));
+		return;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+		log_message(LOG_INFO, "Log helper: socketpair error (%s), logging synchronously"
+				    , strerror(errno));
+		goto err;
+	}
+
+	log_ident = ident;
+	log_facility = facility;
+	log_pid = getpid();
+
+	pid = fork();
+	if (pid < 0) {
+		log_message(LOG_INFO, "Log helper: fork error (%s), logging synchronously"
+				    , strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		goto err;
+	}
+
+	if (!pid) {
+		close(fds[1]);
+		log_helper_main(fds[0]);
+	}
+
+	close(fds[0]);
+	log_wake_fd = fds[1];
+	log_message(LOG_INFO, "Log helper started, pid=%d", pid);
+	return;
+
+err:
+	munmap(log_ring, sizeof(log_ring_t));
+	log_ring = NULL;
+}
+
+/* Back to synchronous logging. The helper writes out what is still
+ * queued and exits on EOF.
+ */
+void
+log_helper_close(void)
+{
+	unsigned long dropped = log_drop_pending;
+
+	if (!log_ring)
+		return;
+
+	close(log_wake_fd);
+	log_wake_fd = -1;
+	munmap(log_ring, sizeof(log_ring_t));
+	log_ring = NULL;
+	log_drop_pending = 0;
+
+	if (dropped)
+		log_message(LOG_WARNING, "%lu log messages dropped", dropped);
+}
+
+void
+dump_log_stats(void)
+{
+	log_message(LOG_INFO, "Logging: %lu queued, %lu dropped, %lu rate limited"
+			    , log_stats.queued, log_stats.dropped, log_stats.limited);
+}
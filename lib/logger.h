@@ -26,9 +26,29 @@
 #include <stdarg.h>
 #include <syslog.h>
 
+/* Asynchronous logging */
+#define LOG_MSG_MAX		256	/* Longest message, truncated beyond */
+#define LOG_RING_SIZE		1024	/* Queued messages, power of 2 */
+#define LOG_BATCH		64	/* Messages written per syscall */
+#define LOG_RATE_SITES		256	/* Rate limited call sites, power of 2 */
+#define LOG_RATE_INTERVAL	5	/* Default seconds */
+#define LOG_RATE_BURST		200	/* Default messages per call site and interval */
+
+typedef struct _log_stat {
+	unsigned long		queued;
+	unsigned long		dropped;	/* Ring full */
+	unsigned long		limited;	/* Suppressed by rate limiting */
+} log_stat_t;
+
 void enable_console_log(void);
 void vlog_message(const int facility, const char* format, va_list args);
 void log_message(int priority, const char* format, ...)
 	__attribute__ ((format (printf, 2, 3)));
+void log_message_nolimit(int priority, const char* format, ...)
+	__attribute__ ((format (printf, 2, 3)));
+void log_rate_set(unsigned int burst, unsigned int interval);
+void log_helper_init(const char *ident, int facility);
+void log_helper_close(void);
+void dump_log_stats(void);
 
 #endif
@@ -22,12 +22,29 @@
  * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@linux-vs.org>
  */
 
+#include <malloc.h>
 #include "memory.h"
 #include "utils.h"
 #include "bitops.h"
+#include "logger.h"
 
 /* Global var */
 unsigned long mem_allocated;	/* Total memory used in Bytes */
+mem_stat_t mem_stats[MEM_CAT_MAX];
+const char *mem_category_name[MEM_CAT_MAX] = {
+	"misc", "scheduler", "parser", "vrrp", "check", "ssl"
+};
+
+/* Accounting header in front of every MALLOC block. Carries what
+ * FREE needs to debit the right category; the union keeps the user
+ * part aligned as malloc() would. */
+typedef union _mem_hdr {
+	struct {
+		size_t size;
+		unsigned int category;
+	} h;
+	max_align_t align;
+} mem_hdr_t;
 
 void *
 xalloc(unsigned long size)
@@ -54,6 +71,120 @@ zalloc(unsigned long size)
 	return mem;
 }
 
+/* Always-on accounting allocator behind MALLOC/REALLOC/FREE in
+ * non-debug builds. Cost is one header and a few counter updates
+ * per call. */
+void *
+mem_malloc(size_t size, unsigned int category)
+{
+	mem_hdr_t *hdr = malloc(sizeof(mem_hdr_t) + size);
+
+	if (hdr == NULL) {
+		perror("Keepalived");
+		exit(EXIT_FAILURE);
+	}
+
+	if (category >= MEM_CAT_MAX)
+		category = MEM_CAT_MISC;
+	hdr->h.size = size;
+	hdr->h.category = category;
+	mem_stats[category].bytes += size;
+	mem_stats[category].blocks++;
+	mem_stats[category].allocs++;
+	return hdr + 1;
+}
+
+void *
+mem_zalloc(size_t size, unsigned int category)
+{
+	void *mem = mem_malloc(size, category);
+
+	memset(mem, 0, size);
+	return mem;
+}
+
+/* The block stays charged to the category it was allocated in */
+void *
+mem_realloc(void *ptr, size_t size, unsigned int category)
+{
+	mem_hdr_t *hdr;
+	mem_stat_t *stat;
+
+	if (ptr == NULL)
+		return mem_malloc(size, category);
+
+	hdr = (mem_hdr_t *) ptr - 1;
+	stat = &mem_stats[hdr->h.category];
+	stat->bytes -= hdr->h.size;
+
+	hdr = realloc(hdr, sizeof(mem_hdr_t) + size);
+	if (hdr == NULL) {
+		perror("Keepalived");
+		exit(EXIT_FAILURE);
+	}
+
+	hdr->h.size = size;
+	stat->bytes += size;
+	return hdr + 1;
+}
+
+void
+mem_free(void *ptr)
+{
+	mem_hdr_t *hdr;
+	mem_stat_t *stat;
+
+	if (ptr == NULL)
+		return;
+
+	hdr = (mem_hdr_t *) ptr - 1;
+	stat = &mem_stats[hdr->h.category];
+	stat->bytes -= hdr->h.size;
+	stat->blocks--;
+	free(hdr);
+}
+
+/* Heap bytes currently in use. Differences between two calls give
+ * the footprint of a configuration generation. */
+unsigned long
+mem_in_use(void)
+{
+#ifdef _DEBUG_
+	return mem_allocated;
+#else
+	unsigned long bytes = 0;
+	int i;
+
+	for (i = 0; i < MEM_CAT_MAX; i++)
+		bytes += mem_stats[i].bytes;
+	return bytes;
+#endif
+}
+
+void
+dump_mem_stats(void)
+{
+	int i;
+
+#ifdef _DEBUG_
+	log_message(LOG_INFO, "Memory in use : %lu Bytes", mem_allocated);
+#endif
+	for (i = 0; i < MEM_CAT_MAX; i++)
+		log_message(LOG_INFO, "Memory %-9s : %lu Bytes in %lu blocks, %lu allocations"
+				    , mem_category_name[i], mem_stats[i].bytes
+				    , mem_stats[i].blocks, mem_stats[i].allocs);
+}
+
+/* Hand memory freed with a previous configuration generation back to
+ * the system, so that repeated reloads do not leave the heap holed */
+void
+mem_release(void)
+{
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+}
+
 /* KeepAlived memory management. in debug mode,
  * help finding eventual memory leak.
  * Allocation memory types manipulated are :
@@ -26,15 +26,50 @@
 
 /* system includes */
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+/* Allocation accounting categories */
+enum mem_category {
+	MEM_CAT_MISC,
+	MEM_CAT_SCHEDULER,
+	MEM_CAT_PARSER,
+	MEM_CAT_VRRP,
+	MEM_CAT_CHECK,
+	MEM_CAT_SSL,
+	MEM_CAT_MAX
+};
+
+/* Per category counters */
+typedef struct _mem_stat {
+	unsigned long bytes;		/* Live bytes */
+	unsigned long blocks;		/* Live blocks */
+	unsigned long allocs;		/* Allocations since startup */
+} mem_stat_t;
+
+/* Category charged by MALLOC/REALLOC. Set per directory by the
+ * Makefile, and redefined by files whose allocations belong to
+ * another category. */
+#ifndef MEM_CATEGORY
+#define MEM_CATEGORY MEM_CAT_MISC
+#endif
+
 /* extern types */
 extern unsigned long mem_allocated;
+extern mem_stat_t mem_stats[MEM_CAT_MAX];
+extern const char *mem_category_name[MEM_CAT_MAX];
 extern void *xalloc(unsigned long size);
 extern void *zalloc(unsigned long size);
+extern void *mem_malloc(size_t size, unsigned int category);
+extern void *mem_zalloc(size_t size, unsigned int category);
+extern void *mem_realloc(void *ptr, size_t size, unsigned int category);
+extern void mem_free(void *ptr);
+extern unsigned long mem_in_use(void);
+extern void mem_release(void);
+extern void dump_mem_stats(void);
 
 /* Global alloc macro */
 #define ALLOC(n) (xalloc(n))
@@ -59,9 +94,9 @@ extern void keepalived_free_final(char *);
 
 #else
 
-#define MALLOC(n)    (zalloc(n))
-#define FREE(p)      (free(p))
-#define REALLOC(p,n) (realloc((p),(n)))
+#define MALLOC(n)    (mem_zalloc((n), MEM_CATEGORY))
+#define FREE(p)      (mem_free(p))
+#define REALLOC(p,n) (mem_realloc((p), (n), MEM_CATEGORY))
 
 #endif
 
@@ -20,17 +20,35 @@
  * Copyright (C) 2001-2012 Alexandre Cassen, <acassen@linux-vs.org>
  */
 
+/* ppoll() is a GNU extension */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <unistd.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <string.h>
 #include <syslog.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <signal.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include "notify.h"
 #include "signals.h"
 #include "logger.h"
+#include "memory.h"
+#include "list.h"
 #include "utils.h"
 
+extern char **environ;
+
+/* Script helper channel, -1 when scripts are run by forking ourself */
+static int script_helper_fd = -1;
+
 /* perform a system call */
 static int
 system_call(const char *cmdline)
@@ -61,33 +79,265 @@ script_setup(void)
 	set_std_fd(false);
 }
 
-/* Execute external script/program */
-int
-notify_exec(char *cmd)
+/*
+ * Script helper.
+ *
+ * Forking keepalived for every script run copies the page tables of a
+ * process which may be large, for each track script, MISC_CHECK and
+ * notify script. Instead a small helper is forked once at startup, it
+ * receives command lines over a socketpair, spawns them with
+ * posix_spawn() (vfork semantics) and sends exit statuses back.
+ *
+ * Nothing waits on the helper: each request carries an id and is kept
+ * on a pending list until its reply is read by script_helper_thread().
+ * Until the pid of a script is known its child thread waits on the
+ * placeholder SCRIPT_REQ_PID(id), and is moved over to the real pid by
+ * the reply. Since the helper reaps the scripts, a timed out script is
+ * signalled through the helper with script_kill(), which only signals
+ * pids not yet reaped.
+ */
+typedef struct _script_child {
+	pid_t			pid;
+	char			*cmd;
+} script_child_t;
+
+static void
+free_script_child(void *data)
 {
+	script_child_t *child = data;
+
+	FREE(child->cmd);
+	FREE(child);
+}
+
+static void
+script_helper_sigchld(int sig)
+{
+	/* Only there to interrupt ppoll() */
+}
+
+static pid_t
+script_helper_spawn(list children, char *cmd)
+{
+	char *argv[] = { "/bin/sh", "-c", cmd, NULL };
+	posix_spawnattr_t attr;
+	script_child_t *child;
+	sigset_t sset;
 	pid_t pid;
+	int ret;
 
-	pid = fork();
+	/* Scripts start with nothing blocked */
+	sigemptyset(&sset);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setsigmask(&attr, &sset);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
 
-	/* In case of fork is error. */
-	if (pid < 0) {
-		log_message(LOG_INFO, "Failed fork process");
+	ret = posix_spawn(&pid, argv[0], NULL, &attr, argv, environ);
+	posix_spawnattr_destroy(&attr);
+	if (ret) {
+		log_message(LOG_ALERT, "Error exec-ing command: %s", cmd);
 		return -1;
 	}
 
-	/* In case of this is parent process */
-	if (pid)
-		return 0;
+	child = (script_child_t *) MALLOC(sizeof(script_child_t));
+	child->pid = pid;
+	child->cmd = (char *) MALLOC(strlen(cmd) + 1);
+	strcpy(child->cmd, cmd);
+	list_add(children, child);
+
+	return pid;
+}
+
+/* Signal one of our running scripts. Return 0 or an errno value */
+static int
+script_helper_kill(list children, pid_t pid, int sig)
+{
+	script_child_t *child;
+	element e;
+
+	/* A reaped pid may already belong to someone else */
+	for (e = LIST_HEAD(children); e; ELEMENT_NEXT(e)) {
+		child = ELEMENT_DATA(e);
+		if (child->pid == pid)
+			return (kill(pid, sig) < 0) ? errno : 0;
+	}
+
+	return ESRCH;
+}
+
+static void
+script_helper_reap(int fd, list children)
+{
+	script_child_t *child;
+	script_msg_t msg;
+	element e;
+	pid_t pid;
+	int status;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		for (e = LIST_HEAD(children); e; ELEMENT_NEXT(e)) {
+			child = ELEMENT_DATA(e);
+			if (child->pid != pid)
+				continue;
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 127)
+				log_message(LOG_ALERT, "Couldn't exec command: %s", child->cmd);
+			list_del(children, child);
+			free_script_child(child);
+			break;
+		}
+
+		/* Script errors aren't server errors */
+		if (!WIFEXITED(status))
+			status = 0;
+
+		msg.type = SCRIPT_MSG_EXITED;
+		msg.id = 0;
+		msg.pid = pid;
+		msg.status = status;
+		send(fd, &msg, sizeof(msg), 0);
+	}
+}
+
+static void
+script_helper_main(int fd)
+{
+	char buf[sizeof(script_msg_t) + SCRIPT_CMD_MAX];
+	script_msg_t *req = (script_msg_t *) buf;
+	script_msg_t msg;
+	struct sigaction sa;
+	struct pollfd pfd;
+	sigset_t sset, oset;
+	list children;
+	ssize_t len;
 
 	script_setup();
 
-	system_call(cmd);
+	/* SIGCHLD is only delivered while waiting in ppoll() */
+	sigemptyset(&sset);
+	sigaddset(&sset, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &sset, &oset);
+	sigdelset(&oset, SIGCHLD);
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = script_helper_sigchld;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD, &sa, NULL);
+
+	children = alloc_list(free_script_child, NULL);
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	for (;;) {
+		if (ppoll(&pfd, 1, NULL, &oset) < 0) {
+			if (errno == EINTR) {
+				script_helper_reap(fd, children);
+				continue;
+			}
+			break;
+		}
+
+		len = recv(fd, buf, sizeof(buf) - 1, 0);
+		if (len <= 0) {
+			/* Our parent is gone */
+			if (len < 0 && errno == EINTR)
+				continue;
+			break;
+		}
+		if ((size_t) len < sizeof(script_msg_t))
+			continue;
+
+		msg.id = req->id;
+		if (req->type == SCRIPT_MSG_KILL) {
+			msg.type = SCRIPT_MSG_KILLED;
+			msg.pid = req->pid;
+			msg.status = script_helper_kill(children, req->pid, req->status);
+			send(fd, &msg, sizeof(msg), 0);
+			continue;
+		}
+
+		if ((size_t) len == sizeof(script_msg_t))
+			continue;
+		buf[len] = '\0';
+
+		msg.type = SCRIPT_MSG_SPAWNED;
+		msg.pid = script_helper_spawn(children, buf + sizeof(script_msg_t));
+		msg.status = 0;
+		if (req->type == SCRIPT_MSG_RUN)
+			send(fd, &msg, sizeof(msg), 0);
+	}
 
 	exit(0);
 }
 
-int
-system_call_script(thread_master_t *m, int (*func) (thread_t *), void * arg, long timer, const char* script)
+/* Pending requests, waiting for a helper reply */
+typedef struct _script_req {
+	int			id;
+	int			type;		/* SCRIPT_MSG_RUN or SCRIPT_MSG_KILL */
+	thread_master_t		*master;
+	pid_t			pid;		/* pid to signal */
+	int			sig;		/* signal to send, 0 for none */
+	char			*cmd;		/* script to run */
+} script_req_t;
+
+static list script_reqs;
+static int script_req_id;
+
+static void
+free_script_req(void *data)
+{
+	script_req_t *req = data;
+
+	FREE_PTR(req->cmd);
+	FREE(req);
+}
+
+static script_req_t *
+script_req_add(thread_master_t *m, int type, pid_t pid, int sig, const char *cmd)
+{
+	script_req_t *req;
+
+	req = (script_req_t *) MALLOC(sizeof(script_req_t));
+	script_req_id = (script_req_id == INT_MAX) ? 1 : script_req_id + 1;
+	req->id = script_req_id;
+	req->type = type;
+	req->master = m;
+	req->pid = pid;
+	req->sig = sig;
+	if (cmd) {
+		req->cmd = (char *) MALLOC(strlen(cmd) + 1);
+		strcpy(req->cmd, cmd);
+	}
+	list_add(script_reqs, req);
+
+	return req;
+}
+
+static script_req_t *
+script_req_get(int type, int id)
+{
+	script_req_t *req;
+	element e;
+
+	for (e = LIST_HEAD(script_reqs); e; ELEMENT_NEXT(e)) {
+		req = ELEMENT_DATA(e);
+		if (req->type == type && req->id == id)
+			return req;
+	}
+
+	return NULL;
+}
+
+static void
+script_req_del(script_req_t *req)
+{
+	list_del(script_reqs, req);
+	free_script_req(req);
+}
+
+/* Fork a shell running script, the way scripts were run before the
+ * helper. Returns the child pid or -1.
+ */
+static pid_t
+script_fork(const char *script)
 {
 	int status;
 	pid_t pid;
@@ -102,10 +352,8 @@ system_call_script(thread_master_t *m, int (*func) (thread_t *), void * arg, lon
 	}
 
 	/* In case of this is parent process */
-	if (pid) {
-		thread_add_child(m, func, arg, pid, timer);
-		return 0;
-	}
+	if (pid)
+		return pid;
 
 	/* Child part */
 	script_setup();
@@ -117,3 +365,292 @@ system_call_script(thread_master_t *m, int (*func) (thread_t *), void * arg, lon
 
 	exit(WEXITSTATUS(status));
 }
+
+/* Log the outcome of a script_kill() */
+static void
+script_kill_result(pid_t pid, int sig, int err)
+{
+	if (err) {
+		/* Its possible it finished while we're handing this */
+		if (err != ESRCH)
+			DBG("kill error: %s", strerror(err));
+		return;
+	}
+
+	if (sig == SIGKILL)
+		log_message(LOG_WARNING, "Process [%d] didn't respond to SIGTERM", pid);
+}
+
+/* Fork the script helper while we are still small. On reload the
+ * running helper is kept and only reattached to the new master.
+ */
+void
+script_helper_init(thread_master_t *m)
+{
+	int fds[2];
+	pid_t pid;
+
+	if (script_helper_fd < 0) {
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+			log_message(LOG_INFO, "Script helper: socketpair error (%s), forking scripts"
+					    , strerror(errno));
+			return;
+		}
+
+		pid = fork();
+		if (pid < 0) {
+			log_message(LOG_INFO, "Script helper: fork error (%s), forking scripts"
+					    , strerror(errno));
+			close(fds[0]);
+			close(fds[1]);
+			return;
+		}
+
+		if (!pid) {
+			close(fds[0]);
+			script_helper_main(fds[1]);
+		}
+
+		close(fds[1]);
+		script_helper_fd = fds[0];
+		script_reqs = alloc_list(free_script_req, NULL);
+		log_message(LOG_INFO, "Script helper started, pid=%d", pid);
+	}
+
+	thread_add_read(m, script_helper_thread, NULL, script_helper_fd, SCRIPT_HELPER_TIMER);
+}
+
+void
+script_helper_close(void)
+{
+	/* The helper exits on EOF, running scripts are left alone */
+	if (script_helper_fd >= 0)
+		close(script_helper_fd);
+	script_helper_fd = -1;
+	free_list(script_reqs);
+	script_reqs = NULL;
+}
+
+/* The helper is gone. Scripts it didn't report as spawned are forked
+ * now, and pending kill requests fail.
+ */
+static void
+script_helper_lost(void)
+{
+	list reqs = script_reqs;
+	script_req_t *req;
+	element e;
+	pid_t pid;
+
+	log_message(LOG_INFO, "Script helper died, forking scripts");
+	script_reqs = NULL;
+	script_helper_close();
+
+	for (e = LIST_HEAD(reqs); e; ELEMENT_NEXT(e)) {
+		req = ELEMENT_DATA(e);
+		if (req->type == SCRIPT_MSG_KILL) {
+			script_kill_result(req->pid, req->sig, ESRCH);
+			continue;
+		}
+
+		pid = script_fork(req->cmd);
+		if (pid < 0) {
+			thread_child_status(req->master, SCRIPT_REQ_PID(req->id), W_EXITCODE(127, 0));
+			continue;
+		}
+		thread_child_rekey(req->master, SCRIPT_REQ_PID(req->id), pid);
+		if (req->sig)
+			script_kill(req->master, pid, req->sig);
+	}
+	free_list(reqs);
+}
+
+static void
+script_helper_dispatch(thread_master_t *m, script_msg_t *msg)
+{
+	script_req_t *req;
+
+	switch (msg->type) {
+	case SCRIPT_MSG_EXITED:
+		thread_child_status(m, msg->pid, msg->status);
+		break;
+	case SCRIPT_MSG_SPAWNED:
+		req = script_req_get(SCRIPT_MSG_RUN, msg->id);
+		if (!req)
+			break;
+		if (msg->pid > 0) {
+			thread_child_rekey(req->master, SCRIPT_REQ_PID(req->id), msg->pid);
+
+			/* Timed out before we knew its pid */
+			if (req->sig)
+				script_kill(req->master, msg->pid, req->sig);
+		} else {
+			/* Same status as a shell which couldn't exec it */
+			thread_child_status(req->master, SCRIPT_REQ_PID(req->id), W_EXITCODE(127, 0));
+		}
+		script_req_del(req);
+		break;
+	case SCRIPT_MSG_KILLED:
+		req = script_req_get(SCRIPT_MSG_KILL, msg->id);
+		if (!req)
+			break;
+		script_kill_result(req->pid, req->sig, msg->status);
+		script_req_del(req);
+		break;
+	}
+}
+
+int
+script_helper_thread(thread_t *thread)
+{
+	script_msg_t msg;
+	ssize_t len;
+
+	if (script_helper_fd < 0)
+		return 0;
+
+	if (thread->type == THREAD_READY_FD) {
+		while ((len = recv(script_helper_fd, &msg, sizeof(msg), MSG_DONTWAIT)) == sizeof(msg))
+			script_helper_dispatch(thread->master, &msg);
+
+		if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR)) {
+			script_helper_lost();
+			return 0;
+		}
+	}
+
+	thread_add_read(thread->master, script_helper_thread, NULL, script_helper_fd, SCRIPT_HELPER_TIMER);
+	return 0;
+}
+
+/* Have the helper run cmd. A synchronous request is put on the pending
+ * list until the helper replies with the pid of the spawned script.
+ * Returns the request id, 0 for asynchronous requests, -1 when the
+ * helper is not usable.
+ */
+static int
+script_helper_run(thread_master_t *m, const char *cmd, int sync)
+{
+	char buf[sizeof(script_msg_t) + SCRIPT_CMD_MAX];
+	script_msg_t *msg = (script_msg_t *) buf;
+	script_req_t *req = NULL;
+	size_t len = strlen(cmd);
+
+	if (script_helper_fd < 0 || len >= SCRIPT_CMD_MAX)
+		return -1;
+
+	memset(msg, 0, sizeof(script_msg_t));
+	msg->type = sync ? SCRIPT_MSG_RUN : SCRIPT_MSG_RUN_ASYNC;
+	if (sync) {
+		req = script_req_add(m, SCRIPT_MSG_RUN, 0, 0, cmd);
+		msg->id = req->id;
+	}
+	memcpy(buf + sizeof(script_msg_t), cmd, len + 1);
+
+	if (send(script_helper_fd, buf, sizeof(script_msg_t) + len + 1, MSG_NOSIGNAL) < 0) {
+		/* Never sent, left to our caller */
+		if (req)
+			script_req_del(req);
+		script_helper_lost();
+		return -1;
+	}
+
+	return msg->id;
+}
+
+/* Signal a script started by system_call_script(), kill() style. Through
+ * the helper the request is asynchronous, 0 means it was sent. In every
+ * case the outcome is logged when it is known.
+ */
+int
+script_kill(thread_master_t *m, pid_t pid, int sig)
+{
+	script_req_t *req;
+	script_msg_t msg;
+	int ret;
+
+	/* Not spawned yet, signal it once it is */
+	if (pid < 0) {
+		req = script_reqs ? script_req_get(SCRIPT_MSG_RUN, -pid) : NULL;
+		if (!req) {
+			errno = ESRCH;
+			return -1;
+		}
+		req->sig = sig;
+		return 0;
+	}
+
+	/* Scripts we forked are ours to reap */
+	if (script_helper_fd < 0) {
+		ret = kill(pid, sig);
+		script_kill_result(pid, sig, (ret < 0) ? errno : 0);
+		return ret;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.type = SCRIPT_MSG_KILL;
+	msg.id = script_req_add(m, SCRIPT_MSG_KILL, pid, sig, NULL)->id;
+	msg.pid = pid;
+	msg.status = sig;
+
+	if (send(script_helper_fd, &msg, sizeof(msg), MSG_NOSIGNAL) < 0) {
+		script_helper_lost();
+		errno = ESRCH;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Execute external script/program */
+int
+notify_exec(char *cmd)
+{
+	pid_t pid;
+
+	if (script_helper_run(NULL, cmd, 0) == 0)
+		return 0;
+
+	pid = fork();
+
+	/* In case of fork is error. */
+	if (pid < 0) {
+		log_message(LOG_INFO, "Failed fork process");
+		return -1;
+	}
+
+	/* In case of this is parent process */
+	if (pid)
+		return 0;
+
+	script_setup();
+
+	system_call(cmd);
+
+	exit(0);
+}
+
+int
+system_call_script(thread_master_t *m, int (*func) (thread_t *), void * arg, long timer, const char* script)
+{
+	pid_t pid;
+	int id;
+
+	/* Preferably have the helper spawn it */
+	if (script_helper_fd >= 0) {
+		id = script_helper_run(m, script, 1);
+		if (id > 0) {
+			thread_add_child(m, func, arg, SCRIPT_REQ_PID(id), timer);
+			return 0;
+		}
+		if (script_helper_fd >= 0)
+			return -1;
+	}
+
+	pid = script_fork(script);
+	if (pid < 0)
+		return -1;
+
+	thread_add_child(m, func, arg, pid, timer);
+	return 0;
+}
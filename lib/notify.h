@@ -25,8 +25,33 @@
 
 #include "scheduler.h"
 
-/* system includes */
+/* Script helper messages */
+#define SCRIPT_MSG_RUN		1	/* Run cmd, reply with its pid */
+#define SCRIPT_MSG_RUN_ASYNC	2	/* Run cmd, no reply */
+#define SCRIPT_MSG_SPAWNED	3	/* pid of the spawned cmd, -1 on error */
+#define SCRIPT_MSG_EXITED	4	/* A spawned cmd exited */
+#define SCRIPT_MSG_KILL		5	/* Signal a spawned cmd, status is the signal */
+#define SCRIPT_MSG_KILLED	6	/* kill() result, status is 0 or an errno */
+
+#define SCRIPT_CMD_MAX		4096
+#define SCRIPT_HELPER_TIMER	(60 * TIMER_HZ)
+
+/* Child threads of a script not spawned yet wait on this pid */
+#define SCRIPT_REQ_PID(id)	(-(pid_t) (id))
+
+typedef struct _script_msg {
+	int			type;
+	int			id;		/* request id, echoed in the reply */
+	pid_t			pid;
+	int			status;		/* wait() status */
+} script_msg_t;
+
+/* prototypes */
+extern void script_helper_init(thread_master_t *);
+extern void script_helper_close(void);
+extern int script_helper_thread(thread_t *);
 extern int system_call_script(thread_master_t *m, int (*func) (thread_t *), void * arg, long timer, const char* script);
+extern int script_kill(thread_master_t *, pid_t, int);
 extern int notify_exec(char *cmd);
 
 #endif
@@ -26,15 +26,22 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "parser.h"
 #include "memory.h"
 #include "logger.h"
+#include "utils.h"
+
+#undef MEM_CATEGORY
+#define MEM_CATEGORY MEM_CAT_PARSER
 
 /* global vars */
 vector_t *keywords;
 vector_t *current_keywords;
-FILE *current_stream;
+conf_stream_t *current_stream;
 char *current_conf_file;
+char *conf_cache = NULL;
 int reload = 0;
 
 /* local vars */
@@ -148,12 +155,83 @@ free_keywords(vector_t *keywords_vec)
 	vector_free(keywords_vec);
 }
 
+/*
+ * Line tokenizer. Token vectors are used in LIFO order, one per nesting
+ * level of line reading, so they are taken from a stack of buffers that
+ * are kept between lines: tokenizing a line allocates nothing once the
+ * stack is warm. Tokens are only valid until the matching free_strvec(),
+ * a handler keeping a string must copy it (see set_value()).
+ */
+typedef struct _strvec_buf {
+	vector_t		vec;
+	char			*buf;		/* Tokens, NUL separated */
+	size_t			size;
+} strvec_buf_t;
+
+static strvec_buf_t **strvec_stack;
+static unsigned int strvec_stack_size;
+static unsigned int strvec_stack_top;
+
+static strvec_buf_t *
+strvec_push(size_t len)
+{
+	strvec_buf_t *sb;
+
+	if (strvec_stack_top == strvec_stack_size) {
+		if (strvec_stack) {
+			strvec_stack = REALLOC(strvec_stack, 2 * strvec_stack_size * sizeof(strvec_buf_t *));
+			memset(&strvec_stack[strvec_stack_size], 0, strvec_stack_size * sizeof(strvec_buf_t *));
+			strvec_stack_size *= 2;
+		} else {
+			strvec_stack_size = 8;
+			strvec_stack = MALLOC(strvec_stack_size * sizeof(strvec_buf_t *));
+		}
+	}
+
+	sb = strvec_stack[strvec_stack_top];
+	if (!sb) {
+		sb = (strvec_buf_t *) MALLOC(sizeof(strvec_buf_t));
+		strvec_stack[strvec_stack_top] = sb;
+	}
+	strvec_stack_top++;
+
+	/* Worst case each character is a token followed by a NUL */
+	if (sb->size < 2 * len + 1) {
+		sb->size = 2 * len + 1;
+		if (sb->buf)
+			sb->buf = REALLOC(sb->buf, sb->size);
+		else
+			sb->buf = MALLOC(sb->size);
+	}
+	sb->vec.allocated = 0;
+	return sb;
+}
+
+/* Release the buffers, once nothing is parsed anymore */
+static void
+free_strvec_stack(void)
+{
+	unsigned int i;
+
+	if (strvec_stack_top)
+		return;
+
+	for (i = 0; i < strvec_stack_size && strvec_stack[i]; i++) {
+		FREE(strvec_stack[i]->vec.slot);
+		FREE(strvec_stack[i]->buf);
+		FREE(strvec_stack[i]);
+	}
+	if (strvec_stack)
+		FREE(strvec_stack);
+	strvec_stack = NULL;
+	strvec_stack_size = 0;
+}
+
 vector_t *
 alloc_strvec(char *string)
 {
-	char *cp, *start, *token;
-	int str_len;
-	vector_t *strvec;
+	char *cp, *token;
+	strvec_buf_t *sb;
 
 	if (!string)
 		return NULL;
@@ -172,39 +250,445 @@ alloc_strvec(char *string)
 	if (*cp == '!' || *cp == '#')
 		return NULL;
 
-	/* Create a vector and alloc each command piece */
-	strvec = vector_alloc();
+	sb = strvec_push(strlen(cp));
+	token = sb->buf;
 
 	while (1) {
-		start = cp;
+		vector_alloc_slot(&sb->vec);
+		vector_set_slot(&sb->vec, token);
+
 		if (*cp == '"') {
 			cp++;
-			token = MALLOC(2);
-			*(token) = '"';
-			*(token + 1) = '\0';
+			*token++ = '"';
 		} else {
 			while (!isspace((int) *cp) && *cp != '\0' && *cp != '"')
-				cp++;
-			str_len = cp - start;
-			token = MALLOC(str_len + 1);
-			memcpy(token, start, str_len);
-			*(token + str_len) = '\0';
+				*token++ = *cp++;
 		}
-
-		/* Alloc & set the slot */
-		vector_alloc_slot(strvec);
-		vector_set_slot(strvec, token);
+		*token++ = '\0';
 
 		while (isspace((int) *cp) && *cp != '\0')
 			cp++;
 		if (*cp == '\0' || *cp == '!' || *cp == '#')
-			return strvec;
+			return &sb->vec;
+	}
+}
+
+void
+free_strvec(vector_t *strvec)
+{
+	unsigned int i;
+	char *str;
+
+	if (!strvec)
+		return;
+
+	/* Token vector: give it back, with any left above it */
+	for (i = strvec_stack_top; i > 0; i--) {
+		if (strvec == &strvec_stack[i - 1]->vec) {
+			strvec_stack_top = i - 1;
+			return;
+		}
+	}
+
+	/* Heap string vector, as built by read_value_block() */
+	for (i = 0; i < vector_size(strvec); i++) {
+		if ((str = vector_slot(strvec, i)) != NULL) {
+			FREE(str);
+		}
+	}
+
+	vector_free(strvec);
+}
+
+/* Load a whole configuration file in memory. A regular file is read
+ * in a single call, pipes and devices grow the buffer as needed. */
+static conf_stream_t *
+open_conf_stream(char *path)
+{
+	conf_stream_t *stream;
+	struct stat sb;
+	size_t size = 4096;
+	ssize_t len;
+	int fd, err;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0)
+		size = sb.st_size + 1;
+
+	stream = (conf_stream_t *) MALLOC(sizeof(conf_stream_t));
+	stream->name = path;
+	stream->buf = (char *) MALLOC(size);
+	while ((len = read(fd, stream->buf + stream->len, size - stream->len)) != 0) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			err = errno;
+			FREE(stream->buf);
+			FREE(stream);
+			close(fd);
+			errno = err;
+			return NULL;
+		}
+
+		stream->len += len;
+		if (stream->len == size) {
+			size *= 2;
+			stream->buf = (char *) REALLOC(stream->buf, size);
+		}
+	}
+
+	close(fd);
+	return stream;
+}
+
+static void
+close_conf_stream(conf_stream_t *stream)
+{
+	FREE(stream->buf);
+	FREE(stream);
+}
+
+/* Copy next line of the stream into buf. Returns 0 at end of stream */
+static int
+conf_stream_getline(conf_stream_t *stream, char *buf, int size)
+{
+	char *line, *cp, *end;
+	size_t len;
+
+	if (stream->pos >= stream->len)
+		return 0;
+
+	line = cp = stream->buf + stream->pos;
+	end = stream->buf + stream->len;
+	while (cp < end && *cp != '\n' && *cp != '\r')
+		cp++;
+	len = cp - line;
+
+	/* Step over the line terminator, CRLF included */
+	if (cp < end && *cp == '\r' && cp + 1 < end && *(cp + 1) == '\n')
+		cp++;
+	stream->pos = cp - stream->buf + 1;
+	stream->lineno++;
+
+	if (len >= (size_t) size) {
+		log_message(LOG_INFO, "%s:%d: line too long, truncated"
+				    , stream->name, stream->lineno);
+		len = size - 1;
+	}
+	memcpy(buf, line, len);
+	buf[len] = '\0';
+	return 1;
+}
+
+/*
+ * Configuration cache. The include expanded stream of significant lines
+ * is saved with the stat() of every source file and the matches of every
+ * include pattern. It is replayed instead of the sources as long as none
+ * of them changed and the root configuration file is the same.
+ */
+#define CONF_CACHE_MAGIC	0x4b414343	/* "KACC" */
+#define CONF_CACHE_VERSION	2
+
+typedef struct _conf_cache_hdr {
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		checksum;	/* FNV-1a of everything past the header */
+	uint32_t		root_len;	/* Root configuration file path */
+	uint32_t		deps_len;	/* Source dependency records */
+	uint32_t		lines_len;	/* Configuration lines */
+} conf_cache_hdr_t;
+
+typedef struct _conf_buf {
+	char			*buf;
+	size_t			len;
+	size_t			size;
+} conf_buf_t;
+
+typedef struct _conf_cache_rec {
+	conf_buf_t		deps;
+	conf_buf_t		lines;
+	int			failed;
+} conf_cache_rec_t;
+
+/* Non NULL while a cache is being recorded */
+static conf_cache_rec_t *cache_rec;
+
+static void
+conf_buf_append(conf_buf_t *cbuf, const char *data, size_t len)
+{
+	if (cbuf->len + len > cbuf->size) {
+		while (cbuf->len + len > cbuf->size)
+			cbuf->size *= 2;
+		cbuf->buf = (char *) REALLOC(cbuf->buf, cbuf->size);
+	}
+	memcpy(cbuf->buf + cbuf->len, data, len);
+	cbuf->len += len;
+}
+
+/* Sources are recorded with absolute paths, the cache is checked from
+ * another working directory than the one they were read from. Returns
+ * 0 if the path does not fit. */
+static int
+cache_abspath(char *path, char *buf, size_t size)
+{
+	char cwd[MAXBUF];
+	int len;
+
+	if (*path == '/' || !getcwd(cwd, MAXBUF))
+		len = snprintf(buf, size, "%s", path);
+	else
+		len = snprintf(buf, size, "%s/%s", cwd, path);
+	return len < size;
+}
+
+static uint32_t
+cache_glob_hash(glob_t *globbuf, int absolute)
+{
+	uint32_t hash = HASH_FNV1A_INIT;
+	char path[MAXBUF];
+	int i;
+
+	for (i = 0; i < globbuf->gl_pathc; i++) {
+		if (absolute)
+			cache_abspath(globbuf->gl_pathv[i], path, MAXBUF);
+		else
+			snprintf(path, MAXBUF, "%s", globbuf->gl_pathv[i]);
+		hash = hash_fnv1a(path, strlen(path) + 1, hash);
+	}
+	return hash;
+}
+
+static void
+cache_add_glob(char *pattern, glob_t *globbuf)
+{
+	char path[MAXBUF];
+	char rec[2 * MAXBUF];
+	int len;
+
+	if (!cache_abspath(pattern, path, MAXBUF)) {
+		cache_rec->failed = 1;
+		return;
+	}
+	len = snprintf(rec, sizeof(rec), "G %08x %u %s\n"
+			  , cache_glob_hash(globbuf, 1)
+			  , (unsigned) globbuf->gl_pathc, path);
+	conf_buf_append(&cache_rec->deps, rec, len);
+}
+
+/* Called before the file is read, so that a change racing with
+ * the read invalidates the cache */
+static void
+cache_add_file(char *file)
+{
+	struct stat sb;
+	char path[MAXBUF];
+	char rec[2 * MAXBUF];
+	int len;
+
+	if (stat(file, &sb) < 0) {
+		cache_rec->failed = 1;
+		return;
+	}
+
+	if (!cache_abspath(file, path, MAXBUF)) {
+		cache_rec->failed = 1;
+		return;
+	}
+	len = snprintf(rec, sizeof(rec), "F %llu %llu %lld %ld %s\n"
+			  , (unsigned long long) sb.st_ino
+			  , (unsigned long long) sb.st_size
+			  , (long long) sb.st_mtim.tv_sec, sb.st_mtim.tv_nsec, path);
+	conf_buf_append(&cache_rec->deps, rec, len);
+}
+
+static void
+cache_add_line(char *buf)
+{
+	while (isspace((int) *buf))
+		buf++;
+	if (*buf == '\0' || *buf == '!' || *buf == '#')
+		return;
+
+	conf_buf_append(&cache_rec->lines, buf, strlen(buf));
+	conf_buf_append(&cache_rec->lines, "\n", 1);
+}
+
+static void
+cache_rec_start(void)
+{
+	cache_rec = (conf_cache_rec_t *) MALLOC(sizeof(conf_cache_rec_t));
+	cache_rec->deps.size = cache_rec->lines.size = 4096;
+	cache_rec->deps.buf = (char *) MALLOC(cache_rec->deps.size);
+	cache_rec->lines.buf = (char *) MALLOC(cache_rec->lines.size);
+}
+
+static int
+conf_write(int fd, const char *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/* Write the recorded cache of root conf_file and stop recording. The
+ * file is renamed into place, both daemons may write it at the same
+ * time. */
+static void
+cache_rec_stop(char *cache_file, char *conf_file)
+{
+	conf_cache_hdr_t hdr;
+	char root[MAXBUF];
+	char tmp[MAXBUF];
+	int fd = -1;
+
+	if (cache_rec->failed || !cache_abspath(conf_file, root, MAXBUF))
+		goto end;
+
+	hdr.magic = CONF_CACHE_MAGIC;
+	hdr.version = CONF_CACHE_VERSION;
+	hdr.root_len = strlen(root);
+	hdr.deps_len = cache_rec->deps.len;
+	hdr.lines_len = cache_rec->lines.len;
+	hdr.checksum = hash_fnv1a(root, hdr.root_len, HASH_FNV1A_INIT);
+	hdr.checksum = hash_fnv1a(cache_rec->deps.buf, cache_rec->deps.len, hdr.checksum);
+	hdr.checksum = hash_fnv1a(cache_rec->lines.buf, cache_rec->lines.len, hdr.checksum);
+
+	snprintf(tmp, MAXBUF, "%s.%d", cache_file, getpid());
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0 ||
+	    conf_write(fd, (char *) &hdr, sizeof(hdr)) < 0 ||
+	    conf_write(fd, root, hdr.root_len) < 0 ||
+	    conf_write(fd, cache_rec->deps.buf, cache_rec->deps.len) < 0 ||
+	    conf_write(fd, cache_rec->lines.buf, cache_rec->lines.len) < 0 ||
+	    close(fd) < 0 || rename(tmp, cache_file) < 0) {
+		log_message(LOG_INFO, "Configuration cache '%s' write error (%s)"
+				    , cache_file, strerror(errno));
+		if (fd >= 0)
+			unlink(tmp);
 	}
+
+end:
+	FREE(cache_rec->deps.buf);
+	FREE(cache_rec->lines.buf);
+	FREE(cache_rec);
+	cache_rec = NULL;
+}
+
+/* Check every dependency record against the filesystem */
+static int
+conf_cache_valid(char *deps)
+{
+	unsigned long long ino, size;
+	long long sec;
+	long nsec;
+	unsigned count;
+	uint32_t hash;
+	struct stat sb;
+	glob_t globbuf;
+	char *rec, *save;
+	int off, valid;
+
+	for (rec = strtok_r(deps, "\n", &save); rec; rec = strtok_r(NULL, "\n", &save)) {
+		off = 0;
+		if (*rec == 'G') {
+			if (sscanf(rec, "G %x %u %n", &hash, &count, &off) != 2 || !off)
+				return 0;
+			globbuf.gl_offs = 0;
+			glob(rec + off, 0, NULL, &globbuf);
+			valid = globbuf.gl_pathc == count &&
+				cache_glob_hash(&globbuf, 0) == hash;
+			globfree(&globbuf);
+		} else if (*rec == 'F') {
+			if (sscanf(rec, "F %llu %llu %lld %ld %n", &ino, &size, &sec, &nsec, &off) != 4 || !off)
+				return 0;
+			valid = stat(rec + off, &sb) == 0 &&
+				(unsigned long long) sb.st_ino == ino &&
+				(unsigned long long) sb.st_size == size &&
+				sb.st_mtim.tv_sec == sec && sb.st_mtim.tv_nsec == nsec;
+		} else
+			valid = 0;
+
+		if (!valid)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Replay a valid cache of root conf_file. Returns 0 if the sources
+ * must be read instead */
+static int
+read_conf_cache(char *cache_file, char *conf_file)
+{
+	conf_stream_t *stream;
+	conf_stream_t lines;
+	conf_cache_hdr_t *hdr;
+	char root[MAXBUF];
+	char *deps;
+	int valid;
+
+	if (!cache_abspath(conf_file, root, MAXBUF))
+		return 0;
+
+	stream = open_conf_stream(cache_file);
+	if (!stream)
+		return 0;
+
+	/* A cache recorded from another root file says nothing of this one */
+	hdr = (conf_cache_hdr_t *) stream->buf;
+	valid = stream->len >= sizeof(conf_cache_hdr_t) &&
+		hdr->magic == CONF_CACHE_MAGIC &&
+		hdr->version == CONF_CACHE_VERSION &&
+		stream->len == sizeof(conf_cache_hdr_t) + hdr->root_len +
+			       hdr->deps_len + hdr->lines_len &&
+		hdr->checksum == hash_fnv1a(stream->buf + sizeof(conf_cache_hdr_t),
+					    hdr->root_len + hdr->deps_len + hdr->lines_len,
+					    HASH_FNV1A_INIT) &&
+		hdr->root_len == strlen(root) &&
+		!memcmp(stream->buf + sizeof(conf_cache_hdr_t), root, hdr->root_len);
+	if (valid) {
+		deps = (char *) MALLOC(hdr->deps_len + 1);
+		memcpy(deps, stream->buf + sizeof(conf_cache_hdr_t) + hdr->root_len
+			   , hdr->deps_len);
+		valid = conf_cache_valid(deps);
+		FREE(deps);
+	}
+
+	if (!valid) {
+		close_conf_stream(stream);
+		return 0;
+	}
+
+	log_message(LOG_INFO, "Using configuration cache '%s'.", cache_file);
+	memset(&lines, 0, sizeof(conf_stream_t));
+	lines.name = cache_file;
+	lines.buf = stream->buf + sizeof(conf_cache_hdr_t) + hdr->root_len + hdr->deps_len;
+	lines.len = hdr->lines_len;
+
+	current_stream = &lines;
+	current_conf_file = cache_file;
+	process_stream(current_keywords);
+
+	close_conf_stream(stream);
+	return 1;
 }
 
 void read_conf_file(char *conf_file)
 {
-	FILE *stream;
+	conf_stream_t *stream;
 	char *path;
 	int ret;
 
@@ -212,15 +696,21 @@ void read_conf_file(char *conf_file)
 
 	globbuf.gl_offs = 0;
 	glob(conf_file, 0, NULL, &globbuf);
+	if (cache_rec)
+		cache_add_glob(conf_file, &globbuf);
 
 	int i;
 	for(i = 0; i < globbuf.gl_pathc; i++){
 		log_message(LOG_INFO, "Opening file '%s'.", globbuf.gl_pathv[i]);
-		stream = fopen(globbuf.gl_pathv[i], "r");
+		if (cache_rec)
+			cache_add_file(globbuf.gl_pathv[i]);
+		stream = open_conf_stream(globbuf.gl_pathv[i]);
 		if (!stream) {
 			log_message(LOG_INFO, "Configuration file '%s' open problem (%s)..."
 				       , globbuf.gl_pathv[i], strerror(errno));
-			return;
+			if (cache_rec)
+				cache_rec->failed = 1;
+			break;
 		}
 		current_stream = stream;
 		current_conf_file = globbuf.gl_pathv[i];
@@ -241,7 +731,7 @@ void read_conf_file(char *conf_file)
 		}
 		free(confpath);
 		process_stream(current_keywords);
-		fclose(stream);
+		close_conf_stream(stream);
 
 		ret = chdir(prev_path);
 		if (ret < 0) {
@@ -261,22 +751,24 @@ check_include(char *buf)
 	char *path;
 	int ret;
 
+	/* Most lines are not includes, avoid tokenizing them twice */
+	str = buf;
+	while (isspace((int) *str))
+		str++;
+	if (strncmp(str, "include", 7))
+		return 0;
+
 	strvec = alloc_strvec(buf);
 
 	if (!strvec){
 		return 0;
 	}
 	str = vector_slot(strvec, 0);
-	
-	if (!strcmp(str, EOB)) {
-		free_strvec(strvec);
-		return 0;
-	}
 
 	if(!strcmp("include", str) && vector_size(strvec) == 2){
 		char *conf_file = vector_slot(strvec, 1);
 
-		FILE *prev_stream = current_stream;
+		conf_stream_t *prev_stream = current_stream;
 		char *prev_conf_file = current_conf_file;
 		char prev_path[MAXBUF];
 		path = getcwd(prev_path, MAXBUF);
@@ -303,34 +795,28 @@ check_include(char *buf)
 int
 read_line(char *buf, int size)
 {
-	int ch;
-
 	do {
-		int count = 0;
-		memset(buf, 0, size);
-		while ((ch = fgetc(current_stream)) != EOF && (int) ch != '\n'
-			   && (int) ch != '\r') {
-			if (count < size)
-				buf[count] = (int) ch;
-			else
-				break;
-			count++;
+		if (!conf_stream_getline(current_stream, buf, size)) {
+			*buf = '\0';
+			return 0;
 		}
 	} while (check_include(buf) == 1);
-	return (ch == EOF) ? 0 : 1;
+
+	if (cache_rec)
+		cache_add_line(buf);
+	return 1;
 }
 
 vector_t *
 read_value_block(void)
 {
-	char *buf;
+	char buf[MAXBUF];
 	int i;
 	char *str = NULL;
 	char *dup;
 	vector_t *vec = NULL;
 	vector_t *elements = vector_alloc();
 
-	buf = (char *) MALLOC(MAXBUF);
 	while (read_line(buf, MAXBUF)) {
 		vec = alloc_strvec(buf);
 		if (vec) {
@@ -340,6 +826,7 @@ read_value_block(void)
 				break;
 			}
 
+			vector_reserve(elements, vector_size(elements) + vector_size(vec));
 			if (vector_size(vec))
 				for (i = 0; i < vector_size(vec); i++) {
 					str = vector_slot(vec, i);
@@ -350,21 +837,18 @@ read_value_block(void)
 				}
 			free_strvec(vec);
 		}
-		memset(buf, 0, MAXBUF);
 	}
 
-	FREE(buf);
 	return elements;
 }
 
 void
 alloc_value_block(vector_t *strvec, void (*alloc_func) (vector_t *))
 {
-	char *buf;
+	char buf[MAXBUF];
 	char *str = NULL;
 	vector_t *vec = NULL;
 
-	buf = (char *) MALLOC(MAXBUF);
 	while (read_line(buf, MAXBUF)) {
 		vec = alloc_strvec(buf);
 		if (vec) {
@@ -379,9 +863,7 @@ alloc_value_block(vector_t *strvec, void (*alloc_func) (vector_t *))
 
 			free_strvec(vec);
 		}
-		memset(buf, 0, MAXBUF);
 	}
-	FREE(buf);
 }
 
 
@@ -418,23 +900,125 @@ set_value(vector_t *strvec)
 	return alloc;
 }
 
+/*
+ * Keyword index. Once registered, the whole keyword tree is frozen into
+ * a single open addressing table keyed by (level, keyword string), so
+ * that a line is dispatched without walking its level. The first of two
+ * identical keywords at a level wins, as with a linear lookup.
+ */
+typedef struct _keyword_slot {
+	vector_t		*level;
+	keyword_t		*keyword;
+} keyword_slot_t;
+
+static keyword_slot_t *keyword_index;
+static unsigned int keyword_index_size;
+
+static inline uint32_t
+keyword_hash(vector_t *level, char *str)
+{
+	return hash_string(str, hash_fnv1a(&level, sizeof(vector_t *), HASH_FNV1A_INIT));
+}
+
+static int
+count_keywords(vector_t *keywords_vec)
+{
+	keyword_t *keyword_vec;
+	int i, count = vector_size(keywords_vec);
+
+	for (i = 0; i < vector_size(keywords_vec); i++) {
+		keyword_vec = vector_slot(keywords_vec, i);
+		if (keyword_vec->sub)
+			count += count_keywords(keyword_vec->sub);
+	}
+	return count;
+}
+
+static void
+index_keywords(vector_t *keywords_vec)
+{
+	keyword_t *keyword_vec;
+	keyword_slot_t *slot;
+	unsigned int h;
+	int i;
+
+	for (i = 0; i < vector_size(keywords_vec); i++) {
+		keyword_vec = vector_slot(keywords_vec, i);
+
+		h = keyword_hash(keywords_vec, keyword_vec->string) & (keyword_index_size - 1);
+		for (slot = &keyword_index[h]; slot->keyword; slot = &keyword_index[h]) {
+			if (slot->level == keywords_vec &&
+			    !strcmp(slot->keyword->string, keyword_vec->string))
+				break;
+			h = (h + 1) & (keyword_index_size - 1);
+		}
+		if (!slot->keyword) {
+			slot->level = keywords_vec;
+			slot->keyword = keyword_vec;
+		}
+
+		if (keyword_vec->sub)
+			index_keywords(keyword_vec->sub);
+	}
+}
+
+static void
+freeze_keywords(vector_t *keywords_vec)
+{
+	/* Keep the table at most half full */
+	keyword_index_size = hash_index_size(2 * count_keywords(keywords_vec));
+	keyword_index = (keyword_slot_t *) MALLOC(keyword_index_size * sizeof(keyword_slot_t));
+	index_keywords(keywords_vec);
+}
+
+static void
+thaw_keywords(void)
+{
+	FREE(keyword_index);
+	keyword_index = NULL;
+	keyword_index_size = 0;
+}
+
+static keyword_t *
+find_keyword(vector_t *keywords_vec, char *str)
+{
+	keyword_t *keyword_vec;
+	keyword_slot_t *slot;
+	unsigned int h;
+	int i;
+
+	if (keyword_index) {
+		h = keyword_hash(keywords_vec, str) & (keyword_index_size - 1);
+		for (slot = &keyword_index[h]; slot->keyword; slot = &keyword_index[h]) {
+			if (slot->level == keywords_vec && !strcmp(slot->keyword->string, str))
+				return slot->keyword;
+			h = (h + 1) & (keyword_index_size - 1);
+		}
+		return NULL;
+	}
+
+	for (i = 0; i < vector_size(keywords_vec); i++) {
+		keyword_vec = vector_slot(keywords_vec, i);
+		if (!strcmp(keyword_vec->string, str))
+			return keyword_vec;
+	}
+	return NULL;
+}
+
 /* recursive configuration stream handler */
 static int kw_level = 0;
 void
 process_stream(vector_t *keywords_vec)
 {
-	int i;
 	keyword_t *keyword_vec;
 	char *str;
-	char *buf;
+	char buf[MAXBUF];
 	vector_t *strvec;
 	vector_t *prev_keywords = current_keywords;
 	current_keywords = keywords_vec;
 
-	buf = zalloc(MAXBUF);
 	while (read_line(buf, MAXBUF)) {
 		strvec = alloc_strvec(buf);
-		memset(buf,0, MAXBUF);
 
 		if (!strvec)
 			continue;
@@ -446,21 +1030,17 @@ process_stream(vector_t *keywords_vec)
 			break;
 		}
 
-		for (i = 0; i < vector_size(keywords_vec); i++) {
-			keyword_vec = vector_slot(keywords_vec, i);
-
-			if (!strcmp(keyword_vec->string, str)) {
-				if (keyword_vec->handler)
-					(*keyword_vec->handler) (strvec);
-
-				if (keyword_vec->sub) {
-					kw_level++;
-					process_stream(keyword_vec->sub);
-					kw_level--;
-					if (keyword_vec->sub_close_handler)
-						(*keyword_vec->sub_close_handler) ();
-				}
-				break;
+		keyword_vec = find_keyword(keywords_vec, str);
+		if (keyword_vec) {
+			if (keyword_vec->handler)
+				(*keyword_vec->handler) (strvec);
+
+			if (keyword_vec->sub) {
+				kw_level++;
+				process_stream(keyword_vec->sub);
+				kw_level--;
+				if (keyword_vec->sub_close_handler)
+					(*keyword_vec->sub_close_handler) ();
 			}
 		}
 
@@ -468,7 +1048,6 @@ process_stream(vector_t *keywords_vec)
 	}
 
 	current_keywords = prev_keywords;
-	free(buf);
 	return;
 }
 
@@ -487,7 +1066,176 @@ init_data(char *conf_file, vector_t * (*init_keywords) (void))
 #endif
 
 	/* Stream handling */
+	freeze_keywords(keywords);
 	current_keywords = keywords;
-	read_conf_file((conf_file) ? conf_file : CONF);
+	if (!conf_file)
+		conf_file = CONF;
+	if (!conf_cache || !read_conf_cache(conf_cache, conf_file)) {
+		if (conf_cache)
+			cache_rec_start();
+		read_conf_file(conf_file);
+		if (conf_cache)
+			cache_rec_stop(conf_cache, conf_file);
+	}
+	thaw_keywords();
 	free_keywords(keywords);
+	free_strvec_stack();
+}
+
+/*
+ * Configuration checking. Walk the files with the keyword tree the way
+ * process_stream() does, without running any handler, so that a broken
+ * configuration is reported before a daemon drops its running one.
+ */
+static void check_conf_file(char *, vector_t *, int *);
+
+/* Skip a block whose content is not made of keywords (value block or
+ * unknown keyword). Returns 0 if the stream ends before the block. */
+static int
+skip_conf_block(conf_stream_t *stream)
+{
+	char buf[MAXBUF];
+	vector_t *strvec;
+	int depth = 1;
+
+	while (depth && conf_stream_getline(stream, buf, MAXBUF)) {
+		strvec = alloc_strvec(buf);
+		if (!strvec)
+			continue;
+
+		if (!strcmp(vector_slot(strvec, 0), EOB))
+			depth--;
+		else if (!strcmp(vector_slot(strvec, vector_size(strvec) - 1), "{"))
+			depth++;
+		free_strvec(strvec);
+	}
+
+	return !depth;
+}
+
+/* Check one block level. Returns 1 when the block is closed, 0 at end
+ * of stream and -1 once an unclosed block has been reported. */
+static int
+check_conf_stream(conf_stream_t *stream, vector_t *keywords_vec, int level, int *errors)
+{
+	keyword_t *keyword_vec;
+	vector_t *strvec;
+	char buf[MAXBUF];
+	char *str;
+	int lineno, ret;
+
+	while (conf_stream_getline(stream, buf, MAXBUF)) {
+		strvec = alloc_strvec(buf);
+		if (!strvec)
+			continue;
+
+		str = vector_slot(strvec, 0);
+		lineno = stream->lineno;
+
+		if (!strcmp(str, EOB)) {
+			free_strvec(strvec);
+			if (level > 0)
+				return 1;
+			log_message(LOG_INFO, "%s:%d: unexpected '}'", stream->name, lineno);
+			(*errors)++;
+			continue;
+		}
+
+		/* Included files are checked at the current keyword level */
+		if (!strcmp(str, "include") && vector_size(strvec) == 2) {
+			check_conf_file(vector_slot(strvec, 1), keywords_vec, errors);
+			free_strvec(strvec);
+			continue;
+		}
+
+		keyword_vec = find_keyword(keywords_vec, str);
+		if (!keyword_vec)
+			log_message(LOG_INFO, "%s:%d: unknown keyword '%s'"
+					    , stream->name, lineno, str);
+
+		ret = 1;
+		if (keyword_vec && keyword_vec->sub)
+			ret = check_conf_stream(stream, keyword_vec->sub, level + 1, errors);
+		else if (!strcmp(vector_slot(strvec, vector_size(strvec) - 1), "{"))
+			ret = skip_conf_block(stream);
+
+		if (ret == 0) {
+			log_message(LOG_INFO, "%s:%d: '%s' block is not closed"
+					    , stream->name, lineno, str);
+			(*errors)++;
+			ret = -1;
+		}
+		free_strvec(strvec);
+
+		if (ret < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void
+check_conf_file(char *conf_file, vector_t *keywords_vec, int *errors)
+{
+	conf_stream_t *stream;
+	char prev_path[MAXBUF];
+	char *confpath;
+	glob_t globbuf;
+	int i;
+
+	globbuf.gl_offs = 0;
+	if (glob(conf_file, 0, NULL, &globbuf) || !globbuf.gl_pathc) {
+		/* An include pattern may legitimately match nothing */
+		if (!strpbrk(conf_file, "*?[")) {
+			log_message(LOG_INFO, "Configuration file '%s' not found", conf_file);
+			(*errors)++;
+		}
+		globfree(&globbuf);
+		return;
+	}
+
+	for (i = 0; i < globbuf.gl_pathc; i++) {
+		stream = open_conf_stream(globbuf.gl_pathv[i]);
+		if (!stream) {
+			log_message(LOG_INFO, "Configuration file '%s' open problem (%s)"
+					    , globbuf.gl_pathv[i], strerror(errno));
+			(*errors)++;
+			continue;
+		}
+
+		/* Relative includes are resolved from the including file */
+		if (!getcwd(prev_path, MAXBUF))
+			*prev_path = '\0';
+		confpath = strdup(globbuf.gl_pathv[i]);
+		if (*prev_path && chdir(dirname(confpath)) < 0)
+			*prev_path = '\0';
+		free(confpath);
+
+		check_conf_stream(stream, keywords_vec, 0, errors);
+		close_conf_stream(stream);
+
+		if (*prev_path && chdir(prev_path) < 0)
+			log_message(LOG_INFO, "chdir(%s) error (%s)"
+					    , prev_path, strerror(errno));
+	}
+
+	globfree(&globbuf);
+}
+
+/* Configuration check. Returns the number of errors found */
+int
+validate_data(char *conf_file, vector_t * (*init_keywords) (void))
+{
+	int errors = 0;
+
+	keywords = vector_alloc();
+	(*init_keywords) ();
+
+	freeze_keywords(keywords);
+	check_conf_file((conf_file) ? conf_file : CONF, keywords, &errors);
+	thaw_keywords();
+	free_keywords(keywords);
+	free_strvec_stack();
+
+	return errors;
 }
@@ -39,6 +39,15 @@
 #define EOB  "}"
 #define MAXBUF	1024
 
+/* Configuration file loaded into memory */
+typedef struct _conf_stream {
+	char		*name;
+	char		*buf;		/* Whole file content */
+	size_t		len;
+	size_t		pos;		/* Offset of the next line */
+	int		lineno;		/* Number of the last line read */
+} conf_stream_t;
+
 /* ketword definition */
 typedef struct _keyword {
 	char *string;
@@ -54,7 +63,8 @@ typedef struct _keyword {
 
 /* global vars exported */
 extern vector_t *keywords;
-extern FILE *current_stream;
+extern conf_stream_t *current_stream;
+extern char *conf_cache;
 extern int reload;
 
 /* Prototypes */
@@ -68,11 +78,13 @@ extern void install_keyword(char *, void (*handler) (vector_t *));
 extern void dump_keywords(vector_t *, int);
 extern void free_keywords(vector_t *);
 extern vector_t *alloc_strvec(char *);
+extern void free_strvec(vector_t *);
 extern int read_line(char *, int);
 extern vector_t *read_value_block(void);
 extern void alloc_value_block(vector_t *, void (*alloc_func) (vector_t *));
 extern void *set_value(vector_t *);
 extern void process_stream(vector_t *);
 extern void init_data(char *, vector_t * (*init_keywords) (void));
+extern int validate_data(char *, vector_t * (*init_keywords) (void));
 
 #endif
@@ -41,6 +41,9 @@
 #include "signals.h"
 #include "logger.h"
 
+#undef MEM_CATEGORY
+#define MEM_CATEGORY MEM_CAT_SCHEDULER
+
 /* global vars */
 thread_master_t *master = NULL;
 
@@ -51,6 +54,7 @@ thread_make_master(void)
 	thread_master_t *new;
 
 	new = (thread_master_t *) MALLOC(sizeof (thread_master_t));
+	new->child_heap = alloc_array(sizeof (thread_t *), NULL, NULL);
 	return new;
 }
 
@@ -116,6 +120,100 @@ thread_list_delete(thread_list_t * list, thread_t * thread)
 	return thread;
 }
 
+/*
+ * Child threads timeout heap. Hundreds of scripts and MISC_CHECKs may
+ * be running at once, a binary heap keyed on the timeout keeps adding
+ * and removing a child O(log n) where the sorted list was O(n).
+ */
+#define CHILD_HEAP(h, i)	(*(thread_t **) ARRAY_ITEM(h, i))
+
+static void
+thread_child_heap_set(array_t *heap, unsigned int i, thread_t * thread)
+{
+	CHILD_HEAP(heap, i) = thread;
+	thread->heap_index = i;
+}
+
+static void
+thread_child_heap_up(array_t *heap, unsigned int i)
+{
+	thread_t *thread = CHILD_HEAP(heap, i);
+	unsigned int parent;
+
+	while (i) {
+		parent = (i - 1) / 2;
+		if (timer_cmp(CHILD_HEAP(heap, parent)->sands, thread->sands) <= 0)
+			break;
+		thread_child_heap_set(heap, i, CHILD_HEAP(heap, parent));
+		i = parent;
+	}
+	thread_child_heap_set(heap, i, thread);
+}
+
+static void
+thread_child_heap_down(array_t *heap, unsigned int i)
+{
+	thread_t *thread = CHILD_HEAP(heap, i);
+	unsigned int child;
+
+	while ((child = 2 * i + 1) < heap->count) {
+		if (child + 1 < heap->count &&
+		    timer_cmp(CHILD_HEAP(heap, child + 1)->sands, CHILD_HEAP(heap, child)->sands) < 0)
+			child++;
+		if (timer_cmp(thread->sands, CHILD_HEAP(heap, child)->sands) <= 0)
+			break;
+		thread_child_heap_set(heap, i, CHILD_HEAP(heap, child));
+		i = child;
+	}
+	thread_child_heap_set(heap, i, thread);
+}
+
+static void
+thread_child_heap_add(array_t *heap, thread_t * thread)
+{
+	array_add(heap);
+	thread_child_heap_set(heap, heap->count - 1, thread);
+	thread_child_heap_up(heap, heap->count - 1);
+}
+
+static void
+thread_child_heap_del(array_t *heap, thread_t * thread)
+{
+	unsigned int i = thread->heap_index;
+	thread_t *last;
+
+	last = CHILD_HEAP(heap, --heap->count);
+	if (last == thread)
+		return;
+
+	/* Move the last leaf in the hole, then restore the order */
+	thread_child_heap_set(heap, i, last);
+	if (i && timer_cmp(last->sands, CHILD_HEAP(heap, (i - 1) / 2)->sands) < 0)
+		thread_child_heap_up(heap, i);
+	else
+		thread_child_heap_down(heap, i);
+}
+
+/* Unlink a child thread from the child list, the pid hash and the
+ * timeout heap.
+ */
+static void
+thread_child_delete(thread_master_t * m, thread_t * thread)
+{
+	thread_t **tp;
+
+	for (tp = &m->child_pid[THREAD_CHILD_HASH(thread->u.c.pid)]; *tp; tp = &(*tp)->pid_next) {
+		if (*tp == thread) {
+			*tp = thread->pid_next;
+			break;
+		}
+	}
+	thread->pid_next = NULL;
+
+	thread_child_heap_del(m->child_heap, thread);
+	thread_list_delete(&m->child, thread);
+}
+
 /* Free all unused thread. */
 static void
 thread_clean_unuse(thread_master_t * m)
@@ -179,12 +277,19 @@ thread_destroy_list(thread_master_t * m, thread_list_t thread_list)
 static void
 thread_cleanup_master(thread_master_t * m)
 {
+	/* The signalfd belongs to the signal handlers */
+	if (m == master)
+		signal_thread_cancel();
+
 	/* Unuse current thread lists */
 	thread_destroy_list(m, m->read);
 	thread_destroy_list(m, m->write);
 	thread_destroy_list(m, m->timer);
 	thread_destroy_list(m, m->event);
 	thread_destroy_list(m, m->ready);
+	thread_destroy_list(m, m->child);
+	memset(m->child_pid, 0, sizeof(m->child_pid));
+	m->child_heap->count = 0;
 
 	/* Clear all FDs */
 	FD_ZERO(&m->readfd);
@@ -200,6 +305,7 @@ void
 thread_destroy_master(thread_master_t * m)
 {
 	thread_cleanup_master(m);
+	free_array(m->child_heap);
 	FREE(m);
 }
 
@@ -344,8 +450,13 @@ thread_add_child(thread_master_t * m, int (*func) (thread_t *)
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort by timeval. */
-	thread_list_add_timeval(&m->child, thread);
+	/* The list only tracks membership, the heap orders by timeout */
+	thread_list_add(&m->child, thread);
+	thread_child_heap_add(m->child_heap, thread);
+
+	/* Index by pid for the reaper */
+	thread->pid_next = m->child_pid[THREAD_CHILD_HASH(pid)];
+	m->child_pid[THREAD_CHILD_HASH(pid)] = thread;
 
 	return thread;
 }
@@ -417,13 +528,15 @@ thread_cancel(thread_t * thread)
 		 * caller's job?
 		 * This function is currently unused, so leave it for now.
 		 */
-		thread_list_delete(&thread->master->child, thread);
+		thread_child_delete(thread->master, thread);
 		break;
 	case THREAD_EVENT:
 		thread_list_delete(&thread->master->event, thread);
 		break;
 	case THREAD_READY:
 	case THREAD_READY_FD:
+	case THREAD_READ_TIMEOUT:
+	case THREAD_WRITE_TIMEOUT:
 		thread_list_delete(&thread->master->ready, thread);
 		break;
 	default:
@@ -456,6 +569,68 @@ thread_cancel_event(thread_master_t * m, void *arg)
 	}
 }
 
+/* Unlink every pending thread, whatever its kind, which has argument
+ * value arg, optionally closing the fd of I/O threads.
+ */
+static void
+thread_release_arg(thread_master_t * m, void *arg, int close_fd)
+{
+	thread_list_t *lists[] = { &m->read, &m->write, &m->timer,
+				   &m->child, &m->event, &m->ready };
+	thread_t *thread;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+		thread = lists[i]->head;
+		while (thread) {
+			thread_t *t;
+
+			t = thread;
+			thread = t->next;
+
+			if (t->arg != arg)
+				continue;
+
+			if (lists[i] == &m->read)
+				FD_CLR(t->u.fd, &m->readfd);
+			else if (lists[i] == &m->write)
+				FD_CLR(t->u.fd, &m->writefd);
+			if (close_fd &&
+			    (t->type == THREAD_READY_FD ||
+			     t->type == THREAD_READ ||
+			     t->type == THREAD_WRITE ||
+			     t->type == THREAD_READ_TIMEOUT ||
+			     t->type == THREAD_WRITE_TIMEOUT))
+				close(t->u.fd);
+			if (lists[i] == &m->child)
+				thread_child_delete(m, t);
+			else
+				thread_list_delete(lists[i], t);
+			t->type = THREAD_UNUSED;
+			thread_add_unuse(m, t);
+		}
+	}
+}
+
+/* Cancel every pending thread, whatever its kind, which has argument
+ * value arg. Used to drop threads referring to released data while
+ * keeping the scheduler running.
+ */
+void
+thread_cancel_arg(thread_master_t * m, void *arg)
+{
+	thread_release_arg(m, arg, 0);
+}
+
+/* Same as thread_cancel_arg() but also close the fd of pending I/O
+ * threads, as thread_destroy_master() does.
+ */
+void
+thread_destroy_arg(thread_master_t * m, void *arg)
+{
+	thread_release_arg(m, arg, 1);
+}
+
 /* Update timer value */
 static void
 thread_update_timer(thread_list_t *list, timeval_t *timer_min)
@@ -482,7 +657,14 @@ thread_compute_timer(thread_master_t * m, timeval_t * timer_wait)
 	thread_update_timer(&m->timer, &timer_min);
 	thread_update_timer(&m->write, &timer_min);
 	thread_update_timer(&m->read, &timer_min);
-	thread_update_timer(&m->child, &timer_min);
+
+	/* The root of the child heap times out first */
+	if (!ARRAY_ISEMPTY(m->child_heap)) {
+		thread_t *child = CHILD_HEAP(m->child_heap, 0);
+
+		if (timer_isnull(timer_min) || timer_cmp(child->sands, timer_min) <= 0)
+			timer_min = child->sands;
+	}
 
 	/* Take care about monothonic clock */
 	if (!timer_isnull(timer_min)) {
@@ -512,7 +694,6 @@ thread_fetch(thread_master_t * m, thread_t * fetch)
 	fd_set writefd;
 	fd_set exceptfd;
 	timeval_t timer_wait;
-	int signal_fd;
 #ifdef _WITH_SNMP_
 	timeval_t snmp_timer_wait;
 	int snmpblock = 0;
@@ -561,9 +742,6 @@ retry:	/* When thread can't fetch try to find next thread again. */
 	writefd = m->writefd;
 	exceptfd = m->exceptfd;
 
-	signal_fd = signal_rfd();
-	FD_SET(signal_fd, &readfd);
-
 #ifdef _WITH_SNMP_
 	/* When SNMP is enabled, we may have to select() on additional
 	 * FD. snmp_select_info() will add them to `readfd'. The trick
@@ -591,10 +769,6 @@ retry:	/* When thread can't fetch try to find next thread again. */
 		snmp_timeout();
 #endif
 
-	/* handle signals synchronously, including child reaping */
-	if (FD_ISSET(signal_fd, &readfd))
-		signal_run_callback();
-
 	/* Update current time */
 	set_time_now();
 
@@ -607,19 +781,15 @@ retry:	/* When thread can't fetch try to find next thread again. */
 	}
 
 	/* Timeout children */
-	thread = m->child.head;
-	while (thread) {
-		thread_t *t;
-
-		t = thread;
-		thread = t->next;
+	while (!ARRAY_ISEMPTY(m->child_heap)) {
+		thread = CHILD_HEAP(m->child_heap, 0);
 
-		if (timer_cmp(time_now, t->sands) >= 0) {
-			thread_list_delete(&m->child, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_CHILD_TIMEOUT;
-		} else
+		if (timer_cmp(time_now, thread->sands) < 0)
 			break;
+
+		thread_child_delete(m, thread);
+		thread_list_add(&m->ready, thread);
+		thread->type = THREAD_CHILD_TIMEOUT;
 	}
 
 	/* Read thead. */
@@ -707,40 +877,63 @@ retry:	/* When thread can't fetch try to find next thread again. */
 	return fetch;
 }
 
-/* Synchronous signal handler to reap child processes */
+/* Hand the exit status of a child over to the thread waiting for it */
+void
+thread_child_status(thread_master_t * m, pid_t pid, int status)
+{
+	thread_t *thread;
+
+	for (thread = m->child_pid[THREAD_CHILD_HASH(pid)]; thread; thread = thread->pid_next) {
+		if (pid == thread->u.c.pid) {
+			thread_child_delete(m, thread);
+			thread->u.c.status = status;
+			thread->type = THREAD_READY;
+			thread_list_add(&m->ready, thread);
+			break;
+		}
+	}
+}
+
+/* Move the child threads waiting on a placeholder pid over to the real
+ * one once it is known. Their timeout is left unchanged.
+ */
+void
+thread_child_rekey(thread_master_t * m, pid_t old_pid, pid_t pid)
+{
+	thread_t **tp, *thread;
+
+	tp = &m->child_pid[THREAD_CHILD_HASH(old_pid)];
+	while ((thread = *tp)) {
+		if (thread->u.c.pid != old_pid) {
+			tp = &thread->pid_next;
+			continue;
+		}
+		*tp = thread->pid_next;
+		thread->u.c.pid = pid;
+		thread->pid_next = m->child_pid[THREAD_CHILD_HASH(pid)];
+		m->child_pid[THREAD_CHILD_HASH(pid)] = thread;
+	}
+}
+
+/* Synchronous signal handler to reap child processes. SIGCHLD is not
+ * queued, so a single notification may stand for several exits: reap
+ * every exited child in one go.
+ */
 void
 thread_child_handler(void * v, int sig)
 {
 	thread_master_t * m = v;
-
-	/*
-	 * This is O(n^2), but there will only be a few entries on
-	 * this list.
-	 */
-	thread_t *thread;
 	pid_t pid;
 	int status;
+
 	while ((pid = waitpid(-1, &status, WNOHANG))) {
 		if (pid == -1) {
 			if (errno == ECHILD)
 				return;
 			DBG("waitpid error: %s", strerror(errno));
 			assert(0);
-		} else {
-			thread = m->child.head;
-			while (thread) {
-				thread_t *t;
-				t = thread;
-				thread = t->next;
-				if (pid == t->u.c.pid) {
-					thread_list_delete(&m->child, t);
-					t->u.c.status = status;
-					t->type = THREAD_READY;
-					thread_list_add(&m->ready, t);
-					break;
-				}
-			}
-		}
+		} else
+			thread_child_status(m, pid, status);
 	}
 }
 
@@ -768,6 +961,7 @@ launch_scheduler(void)
 	thread_t thread;
 
 	signal_set(SIGCHLD, thread_child_handler, master);
+	signal_thread_add(master);
 
 	/*
 	 * Processing the master thread queues,
@@ -32,6 +32,7 @@
 #include <errno.h>
 #include <syslog.h>
 #include "timer.h"
+#include "array.h"
 
 /* Thread itself. */
 typedef struct _thread {
@@ -43,6 +44,8 @@ typedef struct _thread {
 	int (*func) (struct _thread *);	/* event function */
 	void *arg;			/* event argument */
 	timeval_t sands;		/* rest of time sands value. */
+	struct _thread *pid_next;	/* child pid hash chain */
+	unsigned int heap_index;	/* slot in the child timeout heap */
 	union {
 		int val;		/* second argument of the event. */
 		int fd;			/* file descriptor in case of read/write. */
@@ -60,6 +63,10 @@ typedef struct _thread_list {
 	int count;
 } thread_list_t;
 
+/* Child threads indexed by pid */
+#define THREAD_CHILD_HASH_SIZE	64	/* power of 2 */
+#define THREAD_CHILD_HASH(pid)	((unsigned) (pid) & (THREAD_CHILD_HASH_SIZE - 1))
+
 /* Master of the theads. */
 typedef struct _thread_master {
 	thread_list_t read;
@@ -69,6 +76,8 @@ typedef struct _thread_master {
 	thread_list_t event;
 	thread_list_t ready;
 	thread_list_t unuse;
+	thread_t *child_pid[THREAD_CHILD_HASH_SIZE];
+	array_t *child_heap;		/* child threads, soonest timeout first */
 	fd_set readfd;
 	fd_set writefd;
 	fd_set exceptfd;
@@ -114,7 +123,11 @@ extern thread_t *thread_add_child(thread_master_t *, int (*func) (thread_t *), v
 extern thread_t *thread_add_event(thread_master_t *, int (*func) (thread_t *), void *, int);
 extern int thread_cancel(thread_t *);
 extern void thread_cancel_event(thread_master_t *, void *);
+extern void thread_cancel_arg(thread_master_t *, void *);
+extern void thread_destroy_arg(thread_master_t *, void *);
 extern thread_t *thread_fetch(thread_master_t *, thread_t *);
+extern void thread_child_status(thread_master_t *, pid_t, int);
+extern void thread_child_rekey(thread_master_t *, pid_t, pid_t);
 extern void thread_child_handler(void *, int);
 extern void thread_call(thread_t *);
 extern void launch_scheduler(void);
@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/signalfd.h>
 #include <errno.h>
 #include <assert.h>
 #include <syslog.h>
@@ -48,40 +49,25 @@ void *signal_SIGUSR1_v;
 void (*signal_SIGUSR2_handler) (void *, int sig);
 void *signal_SIGUSR2_v;
 
-static int signal_pipe[2] = { -1, -1 };
+/* Handled signals are blocked and read from a signalfd by a read
+ * thread of the scheduler, so no code ever runs in signal context.
+ */
+static int signal_fd = -1;
+static sigset_t signal_mask;
+static thread_t *signal_thread;
 
 /* Remember our initial signal disposition */
 int initialised_default_signals;
 sigset_t ign_sig;
 sigset_t dfl_sig;
 
-/* Local signal test */
-/* Currently unused
-int
-signal_pending(void)
-{
-	fd_set readset;
-	int rc;
-	struct timeval timeout = { 0, 0 };
-
-	FD_ZERO(&readset);
-	FD_SET(signal_pipe[0], &readset);
-
-	rc = select(signal_pipe[0] + 1, &readset, NULL, NULL, &timeout);
-
-	return rc>0?1:0;
-}
-*/
-
-/* Signal flag */
+/* Only installed so that a handled SIGCHLD is not auto-reaped as it
+ * would be with SIG_IGN. Never runs since handled signals are blocked.
+ */
 static void
 signal_handler(int sig)
 {
-	if (write(signal_pipe[1], &sig, sizeof(int)) != sizeof(int)) {
-		DBG("signal_pipe write error %s", strerror(errno));
-		assert(0);
-	}
-}	
+}
 
 /* Signal wrapper */
 void *
@@ -109,12 +95,14 @@ signal_set(int signo, void (*func) (void *, int), void *v)
 	sig.sa_flags |= SA_RESTART;
 #endif				/* SA_RESTART */
 
-	/* Block the signal we are about to configure, to avoid
-	 * any race conditions while setting the handler and
-	 * parameter */
+	/* A handled signal is blocked before its disposition changes, so
+	 * that it stays pending until the signalfd is updated. A signal no
+	 * longer handled is unblocked once its disposition is restored.
+	 */
+	sigemptyset(&sset);
+	sigaddset(&sset, signo);
 	if (func != NULL) {
-		sigemptyset(&sset);
-		sigaddset(&sset, signo);
+		sigaddset(&signal_mask, signo);
 		sigprocmask(SIG_BLOCK, &sset, NULL);
 	}
 
@@ -147,13 +135,17 @@ signal_set(int signo, void (*func) (void *, int), void *v)
 		break;
 	}
 
+	if (func == NULL && sigismember(&signal_mask, signo)) {
+		sigdelset(&signal_mask, signo);
+		sigprocmask(SIG_UNBLOCK, &sset, NULL);
+	}
+
+	if (signal_fd >= 0)
+		signalfd(signal_fd, &signal_mask, 0);
+
 	if (ret < 0)
 		return (SIG_ERR);
 
-	/* Release the signal */
-	if (func != NULL)
-		sigprocmask(SIG_UNBLOCK, &sset, NULL);
-
 	return ((osig.sa_flags & SA_SIGINFO) ? (void*)osig.sa_sigaction : (void*)osig.sa_handler);
 }
 
@@ -171,20 +163,10 @@ signal_handler_init(void)
 	sigset_t sset;
 	int sig;
 	struct sigaction act, oact;
-	int n;
-
-#ifdef HAVE_PIPE2
-	n = pipe2(signal_pipe, O_CLOEXEC | O_NONBLOCK);
-#else
-	n = pipe(signal_pipe);
-
-	fcntl(signal_pipe[0], F_SETFL, O_NONBLOCK | fcntl(signal_pipe[0], F_GETFL));
-	fcntl(signal_pipe[1], F_SETFL, O_NONBLOCK | fcntl(signal_pipe[1], F_GETFL));
 
-	fcntl(signal_pipe[0], F_SETFD, FD_CLOEXEC | fcntl(signal_pipe[0], F_GETFD));
-	fcntl(signal_pipe[1], F_SETFD, FD_CLOEXEC | fcntl(signal_pipe[1], F_GETFD));
-#endif
-	assert(!n);
+	sigemptyset(&signal_mask);
+	signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	assert(signal_fd >= 0);
 
 	signal_SIGHUP_handler = NULL;
 	signal_SIGINT_handler = NULL;
@@ -251,11 +233,13 @@ signal_handler_reset(void)
 void
 signal_handler_destroy(void)
 {
+	/* The signalfd mask is shared with any process we forked off
+	 * while it was open, so let go of it before changing the mask.
+	 */
+	signal_thread_cancel();
+	close(signal_fd);
+	signal_fd = -1;
 	signal_handlers_clear(SIG_IGN);
-	close(signal_pipe[1]);
-	close(signal_pipe[0]);
-	signal_pipe[1] = -1;
-	signal_pipe[0] = -1;
 }
 
 /* Called prior to exec'ing a script. The script can reasonably
@@ -266,6 +250,11 @@ signal_handler_script(void)
 	struct sigaction ign, dfl;
 	int sig;
 
+	/* Leave our parent's signalfd alone */
+	signal_thread_cancel();
+	close(signal_fd);
+	signal_fd = -1;
+
 	ign.sa_handler = SIG_IGN;
 	ign.sa_flags = 0;
 	sigemptyset(&ign.sa_mask);
@@ -279,48 +268,88 @@ signal_handler_script(void)
 		else if (sigismember(&dfl_sig, sig))
 			sigaction(sig, &dfl, NULL);
 	}
+
+	/* The signal mask survives exec */
+	sigprocmask(SIG_UNBLOCK, &signal_mask, NULL);
 }
 
-int
-signal_rfd(void)
+/* Handlers callback. A single read returns every pending signal, and
+ * a standard signal is pending at most once, so each handler runs at
+ * most once per batch whatever the number of signals sent meanwhile.
+ */
+void
+signal_run_callback(void)
 {
-	return(signal_pipe[0]);
+	struct signalfd_siginfo siginfo[SIGNAL_BATCH];
+	ssize_t len;
+	int i, n;
+
+	while ((len = read(signal_fd, siginfo, sizeof(siginfo))) > 0) {
+		n = len / sizeof(struct signalfd_siginfo);
+		for (i = 0; i < n; i++) {
+			switch(siginfo[i].ssi_signo) {
+			case SIGHUP:
+				if (signal_SIGHUP_handler)
+					signal_SIGHUP_handler(signal_SIGHUP_v, SIGHUP);
+				break;
+			case SIGINT:
+				if (signal_SIGINT_handler)
+					signal_SIGINT_handler(signal_SIGINT_v, SIGINT);
+				break;
+			case SIGTERM:
+				if (signal_SIGTERM_handler)
+					signal_SIGTERM_handler(signal_SIGTERM_v, SIGTERM);
+				break;
+			case SIGCHLD:
+				if (signal_SIGCHLD_handler)
+					signal_SIGCHLD_handler(signal_SIGCHLD_v, SIGCHLD);
+				break;
+			case SIGUSR1:
+				if (signal_SIGUSR1_handler)
+					signal_SIGUSR1_handler(signal_SIGUSR1_v, SIGUSR1);
+				break;
+			case SIGUSR2:
+				if (signal_SIGUSR2_handler)
+					signal_SIGUSR2_handler(signal_SIGUSR2_v, SIGUSR2);
+				break;
+			default:
+				break;
+			}
+		}
+	}
 }
 
-/* Handlers callback  */
+static int
+signal_read_thread(thread_t * thread)
+{
+	signal_thread = NULL;
+
+	if (signal_fd < 0)
+		return 0;
+
+	if (thread->type == THREAD_READY_FD)
+		signal_run_callback();
+
+	signal_thread = thread_add_read(thread->master, signal_read_thread, NULL,
+					signal_fd, SIGNAL_TIMER);
+	return 0;
+}
+
+/* Have the scheduler read the signalfd like any other fd */
 void
-signal_run_callback(void)
+signal_thread_add(thread_master_t * m)
 {
-	int sig;
+	if (signal_fd < 0 || signal_thread)
+		return;
 
-	while(read(signal_pipe[0], &sig, sizeof(int)) == sizeof(int)) {
-		switch(sig) {
-		case SIGHUP:
-			if (signal_SIGHUP_handler)
-				signal_SIGHUP_handler(signal_SIGHUP_v, SIGHUP);
-			break;
-		case SIGINT:
-			if (signal_SIGINT_handler)
-				signal_SIGINT_handler(signal_SIGINT_v, SIGINT);
-			break;
-		case SIGTERM:
-			if (signal_SIGTERM_handler)
-				signal_SIGTERM_handler(signal_SIGTERM_v, SIGTERM);
-			break;	
-		case SIGCHLD:	
-			if (signal_SIGCHLD_handler)
-				signal_SIGCHLD_handler(signal_SIGCHLD_v, SIGCHLD);
-			break;
-		case SIGUSR1:
-			if (signal_SIGUSR1_handler)
-				signal_SIGUSR1_handler(signal_SIGUSR1_v, SIGUSR1);
-			break;
-		case SIGUSR2:
-			if (signal_SIGUSR2_handler)
-				signal_SIGUSR2_handler(signal_SIGUSR2_v, SIGUSR2);
-			break;
-		default:
-			break;
-		}	
-	}
+	signal_thread = thread_add_read(m, signal_read_thread, NULL,
+					signal_fd, SIGNAL_TIMER);
+}
+
+/* Drop the read thread, leaving the signalfd open */
+void
+signal_thread_cancel(void)
+{
+	thread_cancel(signal_thread);
+	signal_thread = NULL;
 }
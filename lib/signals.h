@@ -24,6 +24,12 @@
 #ifndef _SIGNALS_H
 #define _SIGNALS_H
 
+#include "scheduler.h"
+
+/* Signals read from the signalfd per read() */
+#define SIGNAL_BATCH	8
+#define SIGNAL_TIMER	(60 * TIMER_HZ)
+
 /* Prototypes */
 /* Currently unused extern int signal_pending(void); */
 extern void *signal_set(int signo, void (*func) (void *, int), void *);
@@ -33,7 +39,7 @@ extern void signal_handler_destroy(void);
 extern void signal_handler_reset(void);
 extern void signal_handler_script(void);
 extern void signal_run_callback(void);
-
-extern int signal_rfd(void);
+extern void signal_thread_add(thread_master_t *);
+extern void signal_thread_cancel(void);
 
 #endif
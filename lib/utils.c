@@ -519,6 +519,40 @@ string_equal(const char *str1, const char *str2)
 	return (*str1 == 0 && *str2 == 0);
 }
 
+/* FNV-1a hash, chained through the hash argument so composite keys
+ * can be hashed field by field.
+ */
+uint32_t
+hash_fnv1a(const void *data, size_t len, uint32_t hash)
+{
+	const unsigned char *p = data;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+uint32_t
+hash_string(const char *str, uint32_t hash)
+{
+	return (str) ? hash_fnv1a(str, strlen(str), hash) : hash;
+}
+
+/* Number of buckets, a power of 2, for an index of n entries */
+unsigned int
+hash_index_size(unsigned int n)
+{
+	unsigned int size = 16;
+
+	while (size < n)
+		size <<= 1;
+
+	return size;
+}
+
 void
 set_std_fd(int force)
 {
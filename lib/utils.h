@@ -45,6 +45,9 @@
 
 #define STR(x)  #x
 
+/* Seed for hash_fnv1a() and hash_string() */
+#define HASH_FNV1A_INIT	2166136261U
+
 /* global vars exported */
 extern unsigned long debug;
 
@@ -73,6 +76,9 @@ uint32_t inet_broadcast(uint32_t, uint32_t);
 uint32_t inet_cidrtomask(uint8_t);
 extern char *get_local_name(void);
 extern int string_equal(const char *, const char *);
+extern uint32_t hash_fnv1a(const void *, size_t, uint32_t);
+extern uint32_t hash_string(const char *, uint32_t);
+extern unsigned int hash_index_size(unsigned int);
 extern void set_std_fd(int);
 extern int fork_exec(char **argv);
 
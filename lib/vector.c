@@ -44,31 +44,48 @@ vector_init(unsigned int size)
 		size = 1;
 
 	v->allocated = size;
+	v->capacity = size;
 	v->active = 0;
 	v->slot = (void *) MALLOC(sizeof(void *) * size);
 	return v;
 }
 
-/* allocated one slot */
+/* Make room for at least 'size' slots. Room doubles so that
+ * appending n slots costs O(n) overall. */
 void
-vector_alloc_slot(vector_t *v)
+vector_reserve(vector_t *v, unsigned int size)
 {
-	v->allocated += VECTOR_DEFAULT_SIZE;
+	unsigned int capacity;
+
+	if (v->capacity >= size)
+		return;
+
+	capacity = (v->capacity) ? v->capacity : VECTOR_DEFAULT_SIZE;
+	while (capacity < size)
+		capacity *= 2;
+
 	if (v->slot)
-		v->slot = REALLOC(v->slot, sizeof (void *) * v->allocated);
+		v->slot = REALLOC(v->slot, sizeof (void *) * capacity);
 	else
-		v->slot = (void *) MALLOC(sizeof (void *) * v->allocated);
+		v->slot = (void *) MALLOC(sizeof (void *) * capacity);
+	v->capacity = capacity;
+}
+
+/* allocated one slot */
+void
+vector_alloc_slot(vector_t *v)
+{
+	vector_reserve(v, v->allocated + 1);
+	v->slot[v->allocated++] = NULL;
 }
 
 /* Insert a value into a specific slot */
 void
 vector_insert_slot(vector_t *v, int index, void *value)
 {
-	int i;
-
 	vector_alloc_slot(v);
-	for (i = (v->allocated / VECTOR_DEFAULT_SIZE) - 2; i >= index; i--)
-		v->slot[i + 1] = v->slot[i];
+	memmove(&v->slot[index + 1], &v->slot[index]
+		, sizeof (void *) * (v->allocated - 1 - index));
 	v->slot[index] = value;
 }
 
@@ -81,6 +98,7 @@ vector_copy(vector_t *v)
 
 	new->active = v->active;
 	new->allocated = v->allocated;
+	new->capacity = v->allocated;
 
 	size = sizeof(void *) * (v->allocated);
 	new->slot = (void *) MALLOC(size);
@@ -93,15 +111,18 @@ vector_copy(vector_t *v)
 void
 vector_ensure(vector_t *v, unsigned int num)
 {
+	unsigned int size;
+
 	if (v->allocated > num)
 		return;
 
-	v->slot = REALLOC(v->slot, sizeof(void *) * (v->allocated * 2));
-	memset(&v->slot[v->allocated], 0, sizeof (void *) * v->allocated);
-	v->allocated *= 2;
+	size = (v->allocated) ? v->allocated : 1;
+	while (size <= num)
+		size *= 2;
 
-	if (v->allocated <= num)
-		vector_ensure(v, num);
+	vector_reserve(v, size);
+	memset(&v->slot[v->allocated], 0, sizeof (void *) * (size - v->allocated));
+	v->allocated = size;
 }
 
 /* This function only returns next empty slot index.  It dose not mean
@@ -256,24 +277,6 @@ vector_dump(vector_t *v)
 }
 
 /* String vector related */
-void
-free_strvec(vector_t *strvec)
-{
-	int i;
-	char *str;
-
-	if (!strvec)
-		return;
-
-	for (i = 0; i < vector_size(strvec); i++) {
-		if ((str = vector_slot(strvec, i)) != NULL) {
-			FREE(str);
-		}
-	}
-
-	vector_free(strvec);
-}
-
 void
 dump_strvec(vector_t *strvec)
 {
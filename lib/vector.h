@@ -26,12 +26,13 @@
 /* vector definition */
 typedef struct _vector {
 	unsigned int	active;
-	unsigned int	allocated;
+	unsigned int	allocated;	/* Slots in use, see vector_size() */
+	unsigned int	capacity;	/* Slots room */
 	void		**slot;
 } vector_t;
 
 /* Some defines */
-#define VECTOR_DEFAULT_SIZE 1
+#define VECTOR_DEFAULT_SIZE 4		/* Initial slots room */
 
 /* Some usefull macros */
 #define vector_slot(V,E) ((V)->slot[(E)])
@@ -44,6 +45,7 @@ typedef struct _vector {
 /* Prototypes */
 extern vector_t *vector_alloc(void);
 extern vector_t *vector_init(unsigned int);
+extern void vector_reserve(vector_t *, unsigned int);
 extern void vector_alloc_slot(vector_t *);
 extern void vector_insert_slot(vector_t *, int, void *);
 extern vector_t *vector_copy(vector_t *);
@@ -61,7 +63,6 @@ extern void vector_only_index_free(void *);
 extern void vector_only_slot_free(void *);
 extern void vector_free(vector_t *);
 extern void vector_dump(vector_t *);
-extern void free_strvec(vector_t *);
 extern void dump_strvec(vector_t *);
 
 #endif